@@ -0,0 +1,108 @@
+/**
+ * @file alloc_check.cpp
+ * @brief Implementation of the allocation check of hot loops
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "alloc_check.h"
+
+#include <array>
+#include <cstddef>
+#include <fstream>
+#include <memory_resource>
+#include <vector>
+
+#include "alloc_tracker.h"
+#include "geometry.h"
+#include "segment_buffer.h"
+#include "svg_writer.h"
+
+namespace
+{
+
+/// Repetitions of every loop inside its guard
+constexpr size_t ROUNDS = 100;
+
+/**
+ * @brief Hatches a shape repeatedly with allocations forbidden
+ * @param out Stream for the report
+ * @param name Loop name for the report
+ * @param rect Rectangle to hatch
+ * @param angle Hatch angle
+ */
+void hatchLoop(std::ostream &out, const char *name, const geometry::Rectangle &rect, double angle)
+{
+    geometry::PreparedShape shape(rect);
+    // Intersection scratch from a fixed buffer, anything more would fail instead of allocating
+    std::array<std::byte, 1024> storage;
+    std::pmr::monotonic_buffer_resource scratch(storage.data(), storage.size(), std::pmr::null_memory_resource());
+    size_t segments = 0;
+    geometry::SegmentSink sink = [&segments](const geometry::Segment &) { ++segments; };
+
+    // The first call sets up per-thread metrics and kernel dispatch
+    geometry::generateHatch(shape, angle, 0.5, sink, {}, {}, nullptr, &scratch);
+    scratch.release();
+    {
+        alloc_tracker::AllocationGuard guard("verify-alloc generateHatch", alloc_tracker::FORBID);
+        for (size_t round = 0; round < ROUNDS; ++round)
+        {
+            geometry::generateHatch(shape, angle, 0.5, sink, {}, {}, nullptr, &scratch);
+            scratch.release();
+        }
+    }
+    out << name << ": " << segments << " segments, no allocations\n";
+}
+
+/**
+ * @brief Draws segments repeatedly to a streaming writer with allocations forbidden
+ * @param out Stream for the report
+ * @param rect Rectangle whose hatch is drawn
+ */
+void drawLoop(std::ostream &out, const geometry::Rectangle &rect)
+{
+    auto hatch = geometry::generateHatch(rect, 30, 0.5);
+    geometry::SegmentBuffer buffer;
+    buffer.append(hatch);
+
+    std::ofstream sinkFile("/dev/null");
+    svg::SVGWriter writer(sinkFile, 400, 400);
+    writer.setBounds(svg::boundsOf(rect));
+    // The first lines set up the stream locale and number formatting
+    writer.drawSegments(hatch, svg::HATCH);
+    writer.drawSegments(buffer, svg::HATCH);
+    {
+        alloc_tracker::AllocationGuard guard("verify-alloc drawSegments", alloc_tracker::FORBID);
+        for (size_t round = 0; round < ROUNDS; ++round)
+        {
+            writer.drawSegments(hatch, svg::HATCH);
+            writer.drawSegments(buffer, svg::HATCH);
+        }
+    }
+    out << "drawSegments: " << 2 * ROUNDS * hatch.size() << " segments, no allocations\n";
+}
+
+} // namespace
+
+namespace bench
+{
+
+bool verifyAllocations(std::ostream &out)
+{
+    if (!alloc_tracker::ENABLED)
+    {
+        out << "allocation tracking is off, configure with -DHATCH_ALLOC_TRACKING=ON\n";
+        return false;
+    }
+
+    geometry::Rectangle box{{geometry::Point(0, 0), geometry::Point(100, 0), geometry::Point(100, 50),
+                             geometry::Point(0, 50)}};
+    geometry::Rectangle rotated{{geometry::Point(0, 0), geometry::Point(30, 40), geometry::Point(-10, 70),
+                                 geometry::Point(-40, 30)}};
+    hatchLoop(out, "generateHatch, fast path", box, 30);
+    hatchLoop(out, "generateHatch, general path", rotated, 30);
+    drawLoop(out, rotated);
+    return true;
+}
+
+} // namespace bench
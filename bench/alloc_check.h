@@ -0,0 +1,29 @@
+/**
+ * @file alloc_check.h
+ * @brief Check that the hatch and SVG hot loops don't allocate
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <ostream>
+
+namespace bench
+{
+
+/**
+ * @brief Runs the steady-state hot loops under a FORBID allocation guard
+ * @param out Stream for the report, one line per loop
+ * @return true if the loops ran, false if allocation tracking is off in this build
+ *
+ * generateHatch() into a sink, on the fast and on the general path, and
+ * SVGWriter::drawSegments() of a span and of a SegmentBuffer to a streaming
+ * writer are repeated inside alloc_tracker::FORBID guards after one warm-up
+ * call each. Scratch storage comes from a fixed buffer. An allocation in a
+ * loop aborts the process with the loop tag, so the check is only
+ * meaningful in a build configured with -DHATCH_ALLOC_TRACKING=ON.
+ */
+bool verifyAllocations(std::ostream &out);
+
+} // namespace bench
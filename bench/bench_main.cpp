@@ -0,0 +1,526 @@
+/**
+ * @file bench_main.cpp
+ * @brief Benchmarks of hatch generation and SVG output
+ * @author Alsu Khabibulina
+ * @date 2025
+ *
+ * Usage:
+ * @code
+ * ./hatch_bench [--filter <substring>] [--min-time <seconds>] [--perf] [--isa <name>]
+ * ./hatch_bench --scaling [--threads 1,2,4] [--sizes 1000,10000] [--lines <n>]
+ * ./hatch_bench --verify-isa
+ * ./hatch_bench --verify-fast-path
+ * ./hatch_bench --verify-validation
+ * ./hatch_bench --verify-alloc
+ * @endcode
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <latch>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "alloc_check.h"
+#include "benchmark.h"
+#include "fast_path_check.h"
+#include "isa_check.h"
+#include "scaling.h"
+#include "validation_check.h"
+#include "angle_search.h"
+#include "coalescer.h"
+#include "cpu_dispatch.h"
+#include "geometry.h"
+#include "segment_arena.h"
+#include "segment_buffer.h"
+#include "svg_writer.h"
+
+namespace
+{
+
+/**
+ * @struct BenchOptions
+ * @brief Parsed command line of the benchmark tool
+ */
+struct BenchOptions
+{
+    bench::Options runner;             ///< Regular benchmark settings
+    bool scaling = false;              ///< Run scaling benchmark instead
+    bench::ScalingOptions scalingGrid; ///< Scaling benchmark grid
+    bool verifyIsa = false;            ///< Check kernel variants instead
+    bool verifyFastPath = false;       ///< Check the axis-aligned fast path instead
+    bool verifyValidation = false;     ///< Check input validation instead
+    bool verifyAlloc = false;          ///< Check that hot loops don't allocate instead
+};
+
+/**
+ * @brief Parses a comma separated list of integers
+ * @param list List text, e.g. "1,2,4"
+ * @return Parsed values
+ * @throw std::invalid_argument if an item is not a number
+ */
+template <typename T> std::vector<T> parseList(const std::string &list)
+{
+    std::vector<T> values;
+    for (size_t begin = 0; begin <= list.size();)
+    {
+        size_t end = std::min(list.find(',', begin), list.size());
+        values.push_back(static_cast<T>(std::stoull(list.substr(begin, end - begin))));
+        begin = end + 1;
+    }
+    return values;
+}
+
+/**
+ * @brief Parses benchmark command line arguments
+ * @param argc Argument count from main()
+ * @param argv Argument values from main()
+ * @return Parsed options
+ * @throw std::invalid_argument if arguments are invalid
+ */
+BenchOptions parseOptions(int argc, char **argv)
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg == "--perf")
+        {
+            options.runner.perf = true;
+        }
+        else if (arg == "--filter" && i + 1 < argc)
+        {
+            options.runner.filter = argv[++i];
+        }
+        else if (arg == "--min-time" && i + 1 < argc)
+        {
+            options.runner.minTime = std::stod(argv[++i]);
+        }
+        else if (arg == "--scaling")
+        {
+            options.scaling = true;
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            options.scalingGrid.threads = parseList<unsigned>(argv[++i]);
+        }
+        else if (arg == "--sizes" && i + 1 < argc)
+        {
+            options.scalingGrid.sizes = parseList<size_t>(argv[++i]);
+        }
+        else if (arg == "--lines" && i + 1 < argc)
+        {
+            options.scalingGrid.linesPerShape = std::stod(argv[++i]);
+        }
+        else if (arg == "--isa" && i + 1 < argc)
+        {
+            cpu_dispatch::selectIsa(cpu_dispatch::parseIsa(argv[++i]));
+        }
+        else if (arg == "--verify-isa")
+        {
+            options.verifyIsa = true;
+        }
+        else if (arg == "--verify-fast-path")
+        {
+            options.verifyFastPath = true;
+        }
+        else if (arg == "--verify-validation")
+        {
+            options.verifyValidation = true;
+        }
+        else if (arg == "--verify-alloc")
+        {
+            options.verifyAlloc = true;
+        }
+        else
+        {
+            throw std::invalid_argument("Unexpected argument: " + arg);
+        }
+    }
+    return options;
+}
+
+/**
+ * @brief Builds an axis-aligned rectangle
+ * @param w Width
+ * @param h Height
+ * @return Rectangle with a corner at the origin
+ */
+geometry::Rectangle makeRect(double w, double h)
+{
+    return {{{{0, 0}, {w, 0}, {w, h}, {0, h}}}};
+}
+
+/**
+ * @brief Registers hatch generation benchmarks
+ * @param runner Benchmark runner
+ */
+void addHatchBenchmarks(bench::Runner &runner)
+{
+    for (size_t lines : {100, 10000, 1000000})
+    {
+        runner.add("generateHatch/30deg/" + std::to_string(lines), [lines] {
+            return geometry::generateHatch(makeRect(1000, 1000), 30, 1000.0 / lines).size();
+        });
+    }
+
+    // Canonical angles on an axis-aligned rectangle, general path against the fast one
+    for (int angle : {0, 45, 90})
+    {
+        for (bool fast : {false, true})
+        {
+            std::string name = "generateHatch/axis/" + std::to_string(angle) + "deg/" + (fast ? "fast" : "general");
+            runner.add(name, [angle, fast] {
+                geometry::setFastPath(fast);
+                size_t size = geometry::generateHatch(makeRect(1000, 1000), angle, 0.1).size();
+                geometry::setFastPath(true);
+                return size;
+            });
+        }
+    }
+}
+
+/**
+ * @brief Registers SVG serialization benchmarks
+ * @param runner Benchmark runner
+ */
+void addSVGBenchmarks(bench::Runner &runner)
+{
+    for (size_t lines : {100, 10000, 1000000})
+    {
+        // Input is generated on the warm-up call, so filtered out benchmarks cost nothing
+        auto hatch = std::make_shared<std::vector<geometry::Segment>>();
+        runner.add("SVGWriter/30deg/" + std::to_string(lines), [hatch, lines] {
+            if (hatch->empty())
+            {
+                *hatch = geometry::generateHatch(makeRect(1000, 1000), 30, 1000.0 / lines);
+            }
+            svg::SVGWriter writer("/dev/null", 400, 400);
+            writer.drawSegments(*hatch, svg::HATCH);
+            return hatch->size();
+        });
+    }
+}
+
+/**
+ * @brief Registers memory resource comparison benchmarks
+ * @param runner Benchmark runner
+ *
+ * Hatching plus SVG serialization (to a discarding stream) with all buffers
+ * taken from the default resource or from a monotonic arena released after
+ * every job, as the batch workers do.
+ */
+void addPMRBenchmarks(bench::Runner &runner)
+{
+    auto job = [](size_t lines, std::pmr::memory_resource *mr) {
+        auto rect = makeRect(1000, 1000);
+        auto hatch = geometry::generateHatch(rect, 30, 1000.0 / lines, mr);
+        bench::NullBuffer buffer;
+        std::ostream sink(&buffer);
+        {
+            svg::SVGWriter writer(sink, 400, 400, mr);
+            writer.drawSegments(hatch, svg::HATCH);
+            writer.drawSegments(rect.toSegments(mr), svg::CONTOUR);
+        }
+        return hatch.size();
+    };
+
+    for (size_t lines : {100, 10000})
+    {
+        runner.add("PMR/default/" + std::to_string(lines),
+                   [job, lines] { return job(lines, std::pmr::get_default_resource()); });
+        runner.add("PMR/monotonic/" + std::to_string(lines), [job, lines] {
+            std::pmr::monotonic_buffer_resource arena;
+            return job(lines, &arena);
+        });
+    }
+}
+
+/**
+ * @brief Sums coordinates of all segments, a walk over the whole buffer
+ * @param segments Segments to walk
+ * @return Number of segments
+ */
+size_t walk(std::span<const geometry::Segment> segments)
+{
+    double sum = 0;
+    for (const auto &s : segments)
+    {
+        sum += s.a.x + s.a.y + s.b.x + s.b.y;
+    }
+    // Hatch coordinates are finite, so the sum is never NaN; the result depends on it all the same
+    return segments.size() + size_t(std::isnan(sum));
+}
+
+/**
+ * @brief Registers huge-page arena benchmarks
+ * @param runner Benchmark runner
+ *
+ * Compares filling and walking a std::vector against a SegmentArena.
+ */
+void addArenaBenchmarks(bench::Runner &runner)
+{
+    constexpr size_t LINES = 10000000;
+    const auto rect = makeRect(1000, 1000);
+    const double step = 1000.0 / LINES;
+    const size_t capacity = geometry::hatchSegmentBound(rect, 30, step);
+
+    runner.add("Fill/vector/10000000", [=] { return geometry::generateHatch(rect, 30, step).size(); });
+    runner.add("Fill/arena/10000000", [=] {
+        geometry::SegmentArena arena(capacity);
+        geometry::generateHatch(rect, 30, step, arena);
+        return arena.size();
+    });
+
+    auto vector = std::make_shared<std::vector<geometry::Segment>>();
+    runner.add("Walk/vector/10000000", [=] {
+        if (vector->empty())
+        {
+            *vector = geometry::generateHatch(rect, 30, step);
+        }
+        return walk(*vector);
+    });
+
+    auto arena = std::make_shared<std::unique_ptr<geometry::SegmentArena>>();
+    runner.add("Walk/arena/10000000", [=] {
+        if (!*arena)
+        {
+            *arena = std::make_unique<geometry::SegmentArena>(capacity);
+            geometry::generateHatch(rect, 30, step, **arena);
+        }
+        return walk((*arena)->segments());
+    });
+}
+
+/**
+ * @brief Registers segment layout benchmarks
+ * @param runner Benchmark runner
+ *
+ * Compares the SVG pass (bounding box, then transform of every endpoint)
+ * over std::vector<Segment> against the columns of a SegmentBuffer.
+ */
+void addLayoutBenchmarks(bench::Runner &runner)
+{
+    constexpr size_t LINES = 1000000;
+    const auto rect = makeRect(1000, 1000);
+    const double step = 1000.0 / LINES;
+
+    // Unit scale keeps repeatedly transformed data out of subnormal range
+    constexpr double SCALE = 1.0;
+
+    auto vector = std::make_shared<std::vector<geometry::Segment>>();
+    runner.add("Layout/aos/1000000", [=] {
+        if (vector->empty())
+        {
+            *vector = geometry::generateHatch(rect, 30, step);
+        }
+        double minX = std::numeric_limits<double>::max();
+        double maxY = std::numeric_limits<double>::lowest();
+        for (const auto &s : *vector)
+        {
+            minX = std::min({minX, s.a.x, s.b.x});
+            maxY = std::max({maxY, s.a.y, s.b.y});
+        }
+        for (auto &s : *vector)
+        {
+            s.a.x = (s.a.x - minX) * SCALE;
+            s.b.x = (s.b.x - minX) * SCALE;
+            s.a.y = (maxY - s.a.y) * SCALE;
+            s.b.y = (maxY - s.b.y) * SCALE;
+        }
+        return vector->size();
+    });
+
+    auto buffer = std::make_shared<geometry::SegmentBuffer>();
+    runner.add("Layout/soa/1000000", [=] {
+        if (buffer->empty())
+        {
+            geometry::generateHatch(rect, 30, step, *buffer);
+        }
+        auto box = buffer->bbox();
+        buffer->transform(-box.min.x, box.max.y, SCALE, SCALE, true);
+        return buffer->size();
+    });
+}
+
+/**
+ * @brief Registers request burst benchmarks
+ * @param runner Benchmark runner
+ *
+ * Threads request the same 10000-line hatch at once, each generating it or
+ * all going through one coalescing::Coalescer. Items are requests.
+ */
+void addBurstBenchmarks(bench::Runner &runner)
+{
+    constexpr size_t REQUESTS = 16;
+    cmdline_parser::Config job;
+    job.rect = makeRect(1000, 1000);
+    job.angle = 30;
+    job.step = 0.1;
+
+    auto burst = [](const auto &request) {
+        std::latch start(REQUESTS);
+        std::vector<std::jthread> threads;
+        for (size_t t = 0; t < REQUESTS; ++t)
+        {
+            threads.emplace_back([&] {
+                start.arrive_and_wait();
+                request();
+            });
+        }
+        return REQUESTS;
+    };
+
+    runner.add("Burst/direct/16", [=] {
+        return burst([&] { geometry::generateHatch(job.rect, job.angle, job.step); });
+    });
+    runner.add("Burst/coalesced/16", [=] {
+        coalescing::Coalescer coalescer;
+        return burst([&] { coalescer.hatch(job); });
+    });
+}
+
+/**
+ * @brief Registers parameter sweep benchmarks
+ * @param runner Benchmark runner
+ *
+ * One small rectangle hatched at every whole degree, and at one angle with
+ * a hundred steps, prepared on every call or once for the sweep. Items are
+ * hatch calls.
+ */
+void addSweepBenchmarks(bench::Runner &runner)
+{
+    constexpr int ANGLES = 360;
+    constexpr int STEPS = 100;
+    geometry::Rectangle rect = makeRect(10, 10);
+
+    runner.add("Sweep/angles/rect", [=] {
+        size_t segments = 0;
+        for (int angle = 0; angle < ANGLES; ++angle)
+        {
+            segments += geometry::generateHatch(rect, angle, 1).size();
+        }
+        return segments != 0 ? ANGLES : 0;
+    });
+    runner.add("Sweep/angles/prepared", [=] {
+        geometry::PreparedShape shape(rect);
+        size_t segments = 0;
+        for (int angle = 0; angle < ANGLES; ++angle)
+        {
+            segments += geometry::generateHatch(shape, angle, 1).size();
+        }
+        return segments != 0 ? ANGLES : 0;
+    });
+    runner.add("Sweep/steps/rect", [=] {
+        size_t segments = 0;
+        for (int i = 1; i <= STEPS; ++i)
+        {
+            segments += geometry::generateHatch(rect, 30, 0.1 * i).size();
+        }
+        return segments != 0 ? STEPS : 0;
+    });
+    runner.add("Sweep/steps/prepared", [=] {
+        constexpr double angle = 30;
+        geometry::PreparedShape shape(rect, {&angle, 1});
+        size_t segments = 0;
+        for (int i = 1; i <= STEPS; ++i)
+        {
+            segments += geometry::generateHatch(shape, angle, 0.1 * i).size();
+        }
+        return segments != 0 ? STEPS : 0;
+    });
+}
+
+/**
+ * @brief Registers hatch angle search benchmarks
+ * @param runner Benchmark runner
+ *
+ * The search over all directions against hatching at every whole degree
+ * and keeping the angle with the fewest segments. Items are searches.
+ */
+void addAngleSearchBenchmarks(bench::Runner &runner)
+{
+    geometry::Rectangle rect{{{{0, 0}, {600, 800}, {440, 920}, {-160, 120}}}};
+    constexpr double step = 1;
+
+    runner.add("AngleSearch/calipers", [=] {
+        return angle_search::bestAngle(rect, step, 0, 180).lines != 0 ? 1 : 0;
+    });
+    runner.add("AngleSearch/sweep/180", [=] {
+        size_t fewest = std::numeric_limits<size_t>::max();
+        for (int angle = 0; angle < 180; ++angle)
+        {
+            fewest = std::min(fewest, geometry::generateHatch(rect, angle, step).size());
+        }
+        return fewest != 0 ? 1 : 0;
+    });
+}
+
+} // namespace
+
+/**
+ * @brief Benchmark entry point
+ * @param argc Number of command line arguments
+ * @param argv Array of command line argument strings
+ * @return Exit status (0 for success, 1 for error)
+ */
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    try
+    {
+        options = parseOptions(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << e.what() << '\n';
+        return 1;
+    }
+
+    if (options.verifyIsa)
+    {
+        return bench::verifyIsa(std::cout) ? 0 : 1;
+    }
+    if (options.verifyFastPath)
+    {
+        return bench::verifyFastPath(std::cout) ? 0 : 1;
+    }
+    if (options.verifyValidation)
+    {
+        return bench::verifyValidation(std::cout) ? 0 : 1;
+    }
+    if (options.verifyAlloc)
+    {
+        return bench::verifyAllocations(std::cout) ? 0 : 1;
+    }
+
+    // Kernel variant the numbers below were measured with
+    std::cout << "isa: " << cpu_dispatch::isaName(cpu_dispatch::activeIsa()) << '\n';
+
+    if (options.scaling)
+    {
+        bench::runScaling(options.scalingGrid, std::cout);
+        return 0;
+    }
+
+    bench::Runner runner(options.runner);
+    addHatchBenchmarks(runner);
+    addSVGBenchmarks(runner);
+    addPMRBenchmarks(runner);
+    addArenaBenchmarks(runner);
+    addLayoutBenchmarks(runner);
+    addBurstBenchmarks(runner);
+    addSweepBenchmarks(runner);
+    addAngleSearchBenchmarks(runner);
+    runner.run(std::cout);
+
+    return 0;
+}
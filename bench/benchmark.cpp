@@ -0,0 +1,132 @@
+/**
+ * @file benchmark.cpp
+ * @brief Implementation of the benchmark harness
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "benchmark.h"
+
+#include <chrono>
+#include <iomanip>
+#include <memory>
+
+namespace
+{
+
+/**
+ * @brief Prints one report row
+ * @param out Output stream
+ * @param r Measurement to print
+ * @param perfColumns Whether counter columns are printed
+ */
+void printResult(std::ostream &out, const bench::Result &r, bool perfColumns)
+{
+    double items = r.items ? double(r.items) : 1.0;
+
+    out << std::left << std::setw(32) << r.name << std::right << std::setw(10) << r.iterations << std::setw(14)
+        << std::fixed << std::setprecision(1) << r.seconds * 1e9 / r.iterations << std::setw(12)
+        << std::setprecision(2) << r.seconds * 1e9 / items;
+
+    if (perfColumns)
+    {
+        for (const auto &value : r.events)
+        {
+            out << std::setw(15);
+            if (value.has_value())
+            {
+                out << double(value.value()) / items;
+            }
+            else
+            {
+                out << "-";
+            }
+        }
+        if (r.events[perf::CYCLES] && r.events[perf::INSTRUCTIONS] && r.events[perf::CYCLES].value() != 0)
+        {
+            out << std::setw(8) << double(r.events[perf::INSTRUCTIONS].value()) / r.events[perf::CYCLES].value();
+        }
+        else
+        {
+            out << std::setw(8) << "-";
+        }
+    }
+    out << std::defaultfloat << '\n';
+}
+
+} // namespace
+
+namespace bench
+{
+
+Runner::Runner(const Options &options) : options(options)
+{
+}
+
+void Runner::add(const std::string &name, Body body)
+{
+    entries.emplace_back(name, std::move(body));
+}
+
+std::vector<Result> Runner::run(std::ostream &out)
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::unique_ptr<perf::Counters> counters;
+    if (options.perf)
+    {
+        counters = std::make_unique<perf::Counters>();
+        if (!counters->available())
+        {
+            out << "perf events unavailable (" << counters->error() << "), timing only\n";
+            counters.reset();
+        }
+    }
+
+    out << std::left << std::setw(32) << "benchmark" << std::right << std::setw(10) << "iters" << std::setw(14)
+        << "ns/op" << std::setw(12) << "ns/item";
+    if (counters)
+    {
+        for (const char *name : perf::EVENT_NAMES)
+        {
+            out << std::setw(15) << (std::string(name) + "/item");
+        }
+        out << std::setw(8) << "IPC";
+    }
+    out << '\n';
+
+    std::vector<Result> results;
+    for (auto &[name, body] : entries)
+    {
+        if (name.find(options.filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        // Warm up caches and allocator
+        body();
+
+        Result r{.name = name, .iterations = 0, .items = 0, .seconds = 0, .events = {}};
+        if (counters)
+        {
+            counters->start();
+        }
+        auto begin = Clock::now();
+        do
+        {
+            r.items += body();
+            r.iterations++;
+            r.seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+        } while (r.seconds < options.minTime);
+        if (counters)
+        {
+            r.events = counters->stop();
+        }
+
+        printResult(out, r, counters != nullptr);
+        results.push_back(std::move(r));
+    }
+    return results;
+}
+
+} // namespace bench
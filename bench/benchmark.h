@@ -0,0 +1,105 @@
+/**
+ * @file benchmark.h
+ * @brief Minimal benchmark harness with optional hardware counters
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "perf_counters.h"
+
+namespace bench
+{
+
+/**
+ * @struct Options
+ * @brief Benchmark run settings
+ */
+struct Options
+{
+    std::string filter;    ///< Run only benchmarks whose name contains this string
+    double minTime = 0.5;  ///< Minimal measured time per benchmark in seconds
+    bool perf = false;     ///< Collect hardware counters with perf_event_open
+};
+
+/**
+ * @struct Result
+ * @brief Measurement of one benchmark
+ */
+struct Result
+{
+    std::string name;    ///< Benchmark name
+    size_t iterations;   ///< Number of body calls measured
+    size_t items;        ///< Total items processed by all calls
+    double seconds;      ///< Total measured time
+    perf::Values events; ///< Hardware counters, empty when not collected
+};
+
+/**
+ * @brief Benchmark body, returns number of items (e.g. segments) it processed
+ */
+using Body = std::function<size_t()>;
+
+/**
+ * @class NullBuffer
+ * @brief Stream buffer that discards output, so serialization cost excludes I/O
+ */
+class NullBuffer : public std::streambuf
+{
+  protected:
+    int_type overflow(int_type c) override
+    {
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char *, std::streamsize n) override
+    {
+        return n;
+    }
+};
+
+/**
+ * @class Runner
+ * @brief Runs registered benchmarks and prints per-operation and per-item costs
+ *
+ * Each body is called once for warm-up and then repeatedly until minTime
+ * elapses. With Options::perf the counters are enabled around the measured
+ * loop only; if the kernel refuses perf events the runner reports the reason
+ * once and continues with timing only.
+ */
+class Runner
+{
+  public:
+    /**
+     * @brief Constructs a runner
+     * @param options Run settings
+     */
+    explicit Runner(const Options &options);
+
+    /**
+     * @brief Registers a benchmark
+     * @param name Unique benchmark name
+     * @param body Function to measure
+     */
+    void add(const std::string &name, Body body);
+
+    /**
+     * @brief Runs all benchmarks matching the filter
+     * @param out Stream for the report
+     * @return Measurements in registration order
+     */
+    std::vector<Result> run(std::ostream &out);
+
+  private:
+    Options options;                                   ///< Run settings
+    std::vector<std::pair<std::string, Body>> entries; ///< Registered benchmarks
+};
+
+} // namespace bench
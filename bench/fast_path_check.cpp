@@ -0,0 +1,141 @@
+/**
+ * @file fast_path_check.cpp
+ * @brief Implementation of the axis-aligned fast path check
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "fast_path_check.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "geometry.h"
+
+namespace
+{
+
+/// Rectangles hatched per angle
+constexpr size_t CASES_PER_ANGLE = 300;
+
+/// Angles checked, canonical ones first
+constexpr std::array<double, 14> ANGLES = {0, 45, 90, 135, 180, 225, 270, 315, 360, -45, -90, 30, 60, 1e-9};
+
+/**
+ * @struct Outcome
+ * @brief Result of one hatch run
+ */
+struct Outcome
+{
+    std::vector<uint64_t> bits; ///< Coordinates of all segments as bits
+    std::string error;          ///< Error text, empty if none
+};
+
+/**
+ * @brief Hatches a rectangle
+ * @param rect Rectangle
+ * @param angle Hatch angle
+ * @param step Hatch step
+ * @param fast Whether the fast path may be used
+ * @return Segment coordinates or the error
+ */
+Outcome hatch(const geometry::Rectangle &rect, double angle, double step, bool fast)
+{
+    geometry::setFastPath(fast);
+    Outcome outcome;
+    try
+    {
+        geometry::generateHatch(rect, angle, step, [&](const geometry::Segment &s) {
+            for (double v : {s.a.x, s.a.y, s.b.x, s.b.y})
+            {
+                outcome.bits.push_back(std::bit_cast<uint64_t>(v));
+            }
+        });
+    }
+    catch (const std::exception &e)
+    {
+        outcome.error = e.what();
+    }
+    return outcome;
+}
+
+/**
+ * @brief Builds a random axis-aligned rectangle
+ * @param engine Random engine
+ * @return Rectangle with corners in random order and orientation
+ */
+geometry::Rectangle randomRect(std::mt19937_64 &engine)
+{
+    std::uniform_real_distribution<double> unit(0, 1);
+    // Smaller rectangles would be parallel to every hatch line by the EPS test
+    double scale = std::pow(10.0, std::uniform_int_distribution<int>(-1, 8)(engine));
+    double x = (unit(engine) - 0.5) * scale * 10, y = (unit(engine) - 0.5) * scale * 10;
+    double w = (unit(engine) + 0.01) * scale, h = (unit(engine) + 0.01) * scale;
+    // Whole-number corners now and then, as most real jobs have
+    if (engine() % 2 == 0)
+    {
+        x = std::round(x), y = std::round(y), w = std::ceil(w), h = std::ceil(h);
+    }
+
+    std::array<geometry::Point, 4> corners = {geometry::Point(x, y), geometry::Point(x + w, y),
+                                              geometry::Point(x + w, y + h), geometry::Point(x, y + h)};
+    if (engine() % 2 == 0)
+    {
+        std::swap(corners[1], corners[3]);
+    }
+    std::rotate(corners.begin(), corners.begin() + static_cast<std::ptrdiff_t>(engine() % 4), corners.end());
+    return {corners};
+}
+
+} // namespace
+
+namespace bench
+{
+
+bool verifyFastPath(std::ostream &out)
+{
+    bool enabled = geometry::fastPathEnabled();
+    std::mt19937_64 engine(11);
+
+    bool ok = true;
+    for (double angle : ANGLES)
+    {
+        size_t segments = 0, mismatch = 0;
+        for (size_t i = 0; i < CASES_PER_ANGLE; ++i)
+        {
+            auto rect = randomRect(engine);
+            double width = std::abs(rect.points[2].x - rect.points[0].x);
+            // From no lines to a few thousand
+            double step = width / std::uniform_real_distribution<double>(0.5, 3000)(engine);
+            auto general = hatch(rect, angle, step, false);
+            auto fast = hatch(rect, angle, step, true);
+            segments += general.bits.size() / 4;
+            if (general.bits != fast.bits || general.error != fast.error)
+            {
+                ++mismatch;
+            }
+        }
+        out << "angle " << angle << ": ";
+        if (mismatch != 0)
+        {
+            out << mismatch << " of " << CASES_PER_ANGLE << " rectangles differ\n";
+            ok = false;
+            continue;
+        }
+        out << segments << " segments identical\n";
+    }
+
+    geometry::setFastPath(enabled);
+    return ok;
+}
+
+} // namespace bench
@@ -0,0 +1,28 @@
+/**
+ * @file fast_path_check.h
+ * @brief Check that the axis-aligned fast path of hatch generation matches the general one
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <ostream>
+
+namespace bench
+{
+
+/**
+ * @brief Hatches axis-aligned rectangles with and without the fast path
+ * @param out Stream for the report, one line per angle
+ * @return true if every case gave bit-identical segments
+ *
+ * Rectangles of random size, position and corner order, including tiny
+ * and far-away ones, are hatched at the canonical angles and some others,
+ * once through geometry::setFastPath(false) and once through the fast
+ * path. Segments must match bit for bit, errors must have the same text.
+ * The previous setting is restored afterwards.
+ */
+bool verifyFastPath(std::ostream &out);
+
+} // namespace bench
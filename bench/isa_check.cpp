@@ -0,0 +1,251 @@
+/**
+ * @file isa_check.cpp
+ * @brief Implementation of the instruction set variant check
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "isa_check.h"
+
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cpu_dispatch.h"
+#include "geometry.h"
+#include "segment_buffer.h"
+#include "svg_writer.h"
+#include "workload.h"
+
+namespace
+{
+
+/// Elements of the random kernel inputs, not a multiple of any vector width
+constexpr size_t KERNEL_ELEMENTS = 4099;
+
+/// Random batches given to intersectLines()
+constexpr size_t INTERSECT_ROUNDS = 20000;
+
+/**
+ * @brief Checks whether two doubles have the same bits
+ * @param l Left value
+ * @param r Right value
+ * @return true if identical, including the sign of zero; any two NaN are the same
+ *
+ * Which NaN payload an operation on two NaN returns depends on the operand
+ * order the compiler picked, not on the instruction set.
+ */
+bool same(double l, double r) noexcept
+{
+    return std::bit_cast<uint64_t>(l) == std::bit_cast<uint64_t>(r) || (std::isnan(l) && std::isnan(r));
+}
+
+/**
+ * @class Inputs
+ * @brief Source of random doubles with special values mixed in
+ */
+class Inputs
+{
+  public:
+    /**
+     * @brief Returns the next value
+     * @return Mostly a value in [-1000, 1000], sometimes a special or tiny one
+     */
+    double next()
+    {
+        constexpr std::array<double, 7> special = {0.0,
+                                                   -0.0,
+                                                   std::numeric_limits<double>::infinity(),
+                                                   -std::numeric_limits<double>::infinity(),
+                                                   std::numeric_limits<double>::quiet_NaN(),
+                                                   std::numeric_limits<double>::denorm_min(),
+                                                   1e-300};
+        uint64_t r = engine();
+        if (r % 64 == 0)
+        {
+            return special[(r >> 8) % special.size()];
+        }
+        return std::ldexp(static_cast<double>(r >> 11), -53) * 2000 - 1000;
+    }
+
+    /**
+     * @brief Returns a column of random values
+     * @param n Number of values
+     * @return n values and SegmentBuffer::LANES more, which kernels may read
+     */
+    std::vector<double> column(size_t n)
+    {
+        std::vector<double> values(n + geometry::SegmentBuffer::LANES);
+        for (auto &v : values)
+        {
+            v = next();
+        }
+        return values;
+    }
+
+  private:
+    std::mt19937_64 engine{42}; ///< Fixed seed, every run checks the same values
+};
+
+/**
+ * @brief Compares the kernels of one instruction set against SCALAR on random columns
+ * @param isa Instruction set to check
+ * @return Name of the first differing kernel, empty if all agree
+ */
+std::string compareKernels(cpu_dispatch::Isa isa)
+{
+    const auto &scalar = cpu_dispatch::kernelsFor(cpu_dispatch::SCALAR);
+    const auto &variant = cpu_dispatch::kernelsFor(isa);
+    Inputs inputs;
+
+    // Columns of a SegmentBuffer are 64-byte aligned, copies into one are too
+    geometry::SegmentBuffer columns;
+    auto a = inputs.column(KERNEL_ELEMENTS), b = inputs.column(KERNEL_ELEMENTS);
+    for (size_t i = 0; i < KERNEL_ELEMENTS; ++i)
+    {
+        columns.push_back(geometry::Segment({a[i], b[i]}, {b[i], a[i]}));
+    }
+    for (size_t begin : {size_t(0), size_t(8), size_t(64)})
+    {
+        for (size_t end : {begin, begin + 3, begin + 17, KERNEL_ELEMENTS})
+        {
+            auto l = scalar.columnRange(columns.x1(), columns.y1(), begin, end);
+            auto r = variant.columnRange(columns.x1(), columns.y1(), begin, end);
+            // Either zero may be kept at a tie, see Kernels::columnRange
+            if (l.min != r.min || l.max != r.max)
+            {
+                return "columnRange";
+            }
+        }
+    }
+
+    constexpr size_t lanes = geometry::SegmentBuffer::LANES;
+    size_t padded = (KERNEL_ELEMENTS + lanes - 1) / lanes * lanes;
+    for (double m : {1.0, -1.0})
+    {
+        geometry::SegmentBuffer left = columns, right = columns;
+        double t = inputs.next(), s = inputs.next();
+        scalar.transformColumn(left.x1(), 0, padded, m, t, s);
+        variant.transformColumn(right.x1(), 0, padded, m, t, s);
+        for (size_t i = 0; i < KERNEL_ELEMENTS; ++i)
+        {
+            if (!same(left.x1()[i], right.x1()[i]))
+            {
+                return "transformColumn";
+            }
+        }
+    }
+
+    for (size_t round = 0; round < INTERSECT_ROUNDS; ++round)
+    {
+        size_t n = round % cpu_dispatch::MAX_BATCH_LINES + 1;
+        size_t padding = (n + cpu_dispatch::BATCH_PADDING - 1) / cpu_dispatch::BATCH_PADDING *
+                         cpu_dispatch::BATCH_PADDING;
+        auto la = inputs.column(padding), lb = inputs.column(padding), lc = inputs.column(padding);
+        // Some lines parallel to the probe line, or nearly so
+        double pa = inputs.next(), pb = inputs.next(), pc = inputs.next();
+        for (size_t i = 0; i < n; i += 3)
+        {
+            la[i] = pa * (1 + 1e-12 * static_cast<double>(i));
+            lb[i] = pb;
+        }
+        std::vector<double> tol(padding);
+        geometry::Point origin(0, 0);
+        geometry::Line probe(geometry::Vector(pa, pb), origin);
+        for (size_t i = 0; i < n; ++i)
+        {
+            tol[i] = geometry::parallelTolerance(geometry::Line(geometry::Vector(la[i], lb[i]), origin), probe);
+        }
+        std::vector<double> lx(padding), ly(padding), rx(padding), ry(padding);
+        uint32_t l = scalar.intersectLines(la.data(), lb.data(), lc.data(), tol.data(), n, pa, pb, pc, lx.data(),
+                                           ly.data());
+        uint32_t r = variant.intersectLines(la.data(), lb.data(), lc.data(), tol.data(), n, pa, pb, pc, rx.data(),
+                                            ry.data());
+        if (l != r)
+        {
+            return "intersectLines";
+        }
+        for (size_t i = 0; i < n; ++i)
+        {
+            if ((l & (uint32_t(1) << i)) != 0 && (!same(lx[i], rx[i]) || !same(ly[i], ry[i])))
+            {
+                return "intersectLines";
+            }
+        }
+    }
+    return {};
+}
+
+/**
+ * @brief Hatches a workload and renders it with the selected kernels
+ * @return SVG text of all jobs, segments buffered and scaled by SegmentBuffer
+ */
+std::string renderWorkload()
+{
+    auto jobs = workload::generate({.kind = workload::MIXED, .count = 200, .seed = 7, .linesPerShape = 300});
+    std::ostringstream out;
+    for (const auto &job : jobs)
+    {
+        try
+        {
+            auto hatch = geometry::generateHatch(job.rect, job.angle, job.step);
+            svg::SVGWriter writer(out, 400, 400);
+            writer.drawSegments(hatch, svg::HATCH);
+            writer.drawSegments(job.rect.toSegments(), svg::CONTOUR);
+        }
+        catch (const std::exception &e)
+        {
+            out << e.what() << '\n';
+        }
+    }
+    return out.str();
+}
+
+} // namespace
+
+namespace bench
+{
+
+bool verifyIsa(std::ostream &out)
+{
+    auto selected = cpu_dispatch::activeIsa();
+    cpu_dispatch::selectIsa(cpu_dispatch::SCALAR);
+    auto reference = renderWorkload();
+
+    bool ok = true;
+    for (size_t i = 0; i < cpu_dispatch::ISA_COUNT; ++i)
+    {
+        auto isa = static_cast<cpu_dispatch::Isa>(i);
+        out << cpu_dispatch::isaName(isa) << ": ";
+        if (!cpu_dispatch::supported(isa))
+        {
+            out << "not supported\n";
+            continue;
+        }
+        if (auto kernel = compareKernels(isa); !kernel.empty())
+        {
+            out << kernel << " differs from scalar\n";
+            ok = false;
+            continue;
+        }
+        cpu_dispatch::selectIsa(isa);
+        if (renderWorkload() != reference)
+        {
+            out << "SVG output differs from scalar\n";
+            ok = false;
+            continue;
+        }
+        out << "ok\n";
+    }
+
+    cpu_dispatch::selectIsa(selected);
+    return ok;
+}
+
+} // namespace bench
@@ -0,0 +1,28 @@
+/**
+ * @file isa_check.h
+ * @brief Check that all instruction set variants of the kernels agree
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <ostream>
+
+namespace bench
+{
+
+/**
+ * @brief Compares every supported kernel variant against the SCALAR one
+ * @param out Stream for the report, one line per instruction set
+ * @return true if all variants gave bit-identical results
+ *
+ * Kernels are called directly on random columns with zeros of both signs,
+ * infinities, NaN and subnormal values mixed in. Then a mixed workload is
+ * hatched and rendered to SVG text with each variant selected, and the
+ * texts must match byte for byte. The previously selected variant is
+ * restored afterwards.
+ */
+bool verifyIsa(std::ostream &out);
+
+} // namespace bench
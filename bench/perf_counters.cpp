@@ -0,0 +1,176 @@
+/**
+ * @file perf_counters.cpp
+ * @brief Implementation of perf_event_open counters
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "perf_counters.h"
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+#ifdef __linux__
+
+/**
+ * @brief Builds perf_event_attr type and config for an event
+ * @param event Event to describe
+ * @param attr Attribute structure to fill
+ */
+void describe(perf::Event event, perf_event_attr &attr)
+{
+    constexpr uint64_t CACHE_READ_MISS = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+    switch (event)
+    {
+    case perf::CYCLES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case perf::INSTRUCTIONS:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case perf::L1D_MISSES:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D | CACHE_READ_MISS;
+        break;
+    case perf::LLC_MISSES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case perf::BRANCH_MISSES:
+    default:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    }
+}
+
+/**
+ * @brief Opens one disabled user-space counter for the calling thread
+ *
+ * Threads created while the counter exists inherit it, and their counts are
+ * added when they exit, so benchmarks that join their workers are counted whole.
+ * @param event Event to count
+ * @return File descriptor or -1 with errno set
+ */
+int openCounter(perf::Event event)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    describe(event, attr);
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+#endif
+
+} // namespace
+
+namespace perf
+{
+
+Counters::Counters() noexcept
+{
+    fds.fill(-1);
+#ifdef __linux__
+    for (int e = 0; e < EVENT_COUNT; ++e)
+    {
+        fds[e] = openCounter(static_cast<Event>(e));
+        if (fds[e] < 0 && openError.empty())
+        {
+            openError = std::string(EVENT_NAMES[e]) + ": " + std::strerror(errno);
+        }
+    }
+#else
+    openError = "perf_event_open is only available on Linux";
+#endif
+}
+
+Counters::~Counters()
+{
+#ifdef __linux__
+    for (int fd : fds)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+#endif
+}
+
+bool Counters::available() const noexcept
+{
+    for (int fd : fds)
+    {
+        if (fd >= 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+const std::string &Counters::error() const noexcept
+{
+    return openError;
+}
+
+void Counters::start() noexcept
+{
+#ifdef __linux__
+    for (int fd : fds)
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+Values Counters::stop() noexcept
+{
+    Values values;
+#ifdef __linux__
+    for (int fd : fds)
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (int e = 0; e < EVENT_COUNT; ++e)
+    {
+        uint64_t data[3]; // value, time enabled, time running
+        if (fds[e] < 0 || read(fds[e], data, sizeof(data)) != sizeof(data) || data[2] == 0)
+        {
+            continue;
+        }
+        // Scale the value if the counter was multiplexed with other events
+        values[e] = data[1] == data[2] ? data[0] : static_cast<uint64_t>(double(data[0]) * data[1] / data[2]);
+    }
+#endif
+    return values;
+}
+
+} // namespace perf
@@ -0,0 +1,93 @@
+/**
+ * @file perf_counters.h
+ * @brief Linux hardware performance counters for benchmarks
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace perf
+{
+
+/**
+ * @enum Event
+ * @brief Hardware events collected around a benchmark
+ */
+enum Event
+{
+    CYCLES,        ///< CPU cycles
+    INSTRUCTIONS,  ///< Retired instructions
+    L1D_MISSES,    ///< L1 data cache read misses
+    LLC_MISSES,    ///< Last level cache misses
+    BRANCH_MISSES, ///< Mispredicted branches
+    EVENT_COUNT    ///< Number of events
+};
+
+/// Short event names for reports, indexed by Event
+constexpr std::array<const char *, EVENT_COUNT> EVENT_NAMES = {"cycles", "instructions", "L1d-misses",
+                                                               "LLC-misses", "branch-misses"};
+
+/// Counter values of one measurement, empty if the event is not supported
+using Values = std::array<std::optional<uint64_t>, EVENT_COUNT>;
+
+/**
+ * @class Counters
+ * @brief Set of perf_event_open counters for the calling thread and its children
+ *
+ * Threads started after construction are counted too, once they are joined.
+ * Each event is opened separately, so a missing event (common for cache
+ * events in virtual machines) does not disable the others. Only user space
+ * is counted, which is allowed with the default perf_event_paranoid level.
+ * If no event can be opened, available() is false and measurements are empty.
+ */
+class Counters
+{
+  public:
+    /**
+     * @brief Opens all supported counters in disabled state
+     */
+    Counters() noexcept;
+
+    /**
+     * @brief Closes the counters
+     */
+    ~Counters();
+
+    Counters(const Counters &) = delete;
+    Counters &operator=(const Counters &) = delete;
+
+    /**
+     * @brief Checks if at least one counter is open
+     * @return true if hardware counters can be read
+     */
+    bool available() const noexcept;
+
+    /**
+     * @brief Explains why counters are unavailable
+     * @return Error description of the first failed perf_event_open call
+     */
+    const std::string &error() const noexcept;
+
+    /**
+     * @brief Resets and enables all counters
+     */
+    void start() noexcept;
+
+    /**
+     * @brief Disables counters and reads their values
+     * @return Counter values scaled for multiplexing
+     */
+    Values stop() noexcept;
+
+  private:
+    std::array<int, EVENT_COUNT> fds; ///< Counter file descriptors, -1 if not opened
+    std::string openError;            ///< First open error
+};
+
+} // namespace perf
@@ -0,0 +1,95 @@
+/**
+ * @file scaling.cpp
+ * @brief Implementation of the scaling benchmark
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "scaling.h"
+
+#include <chrono>
+#include <map>
+
+#include "batch.h"
+#include "benchmark.h"
+#include "process_memory.h"
+#include "svg_writer.h"
+#include "workload.h"
+
+namespace
+{
+
+/// Memory growth ratio over job count ratio that is reported as super-linear
+constexpr double SUPERLINEAR_FACTOR = 1.5;
+
+} // namespace
+
+namespace bench
+{
+
+void runScaling(const ScalingOptions &options, std::ostream &out)
+{
+    using Clock = std::chrono::steady_clock;
+
+    out << "threads,jobs,segments,seconds,speedup,efficiency,peak_rss_delta,memory_flag\n";
+
+    // Per thread count: previous size and its memory growth
+    std::map<unsigned, std::pair<size_t, size_t>> previous;
+
+    for (size_t size : options.sizes)
+    {
+        auto jobs = workload::generate({.kind = workload::RANDOM, .count = size, .seed = 1,
+                                        .linesPerShape = options.linesPerShape});
+        double baseSeconds = 0;
+
+        for (unsigned threads : options.threads)
+        {
+            bool peakReset = process_memory::resetPeakResident();
+            size_t before = process_memory::residentBytes().value_or(0);
+
+            auto begin = Clock::now();
+            auto results = batch::run(jobs, threads, [](const auto &job, auto hatch, auto *arena, auto *) {
+                NullBuffer buffer;
+                std::ostream sink(&buffer);
+                svg::SVGWriter writer(sink, 400, 400, arena);
+                writer.drawSegments(hatch, svg::HATCH);
+                writer.drawSegments(job.rect.toSegments(arena), svg::CONTOUR);
+            });
+            double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+            size_t segments = 0;
+            for (const auto &r : results)
+            {
+                segments += r.segments;
+            }
+
+            size_t peak = process_memory::peakResidentBytes().value_or(0);
+            size_t delta = peak > before ? peak - before : 0;
+
+            // Single thread time, extrapolated if the grid does not start with one thread
+            if (baseSeconds == 0)
+            {
+                baseSeconds = seconds * threads;
+            }
+            double speedup = baseSeconds / seconds;
+
+            const char *flag = peakReset ? "ok" : "no_reset";
+            auto prev = previous.find(threads);
+            if (peakReset && prev != previous.end() && prev->second.second != 0)
+            {
+                double memoryRatio = double(delta) / prev->second.second;
+                double sizeRatio = double(size) / prev->second.first;
+                if (memoryRatio > SUPERLINEAR_FACTOR * sizeRatio)
+                {
+                    flag = "superlinear";
+                }
+            }
+            previous[threads] = {size, delta};
+
+            out << threads << ',' << size << ',' << segments << ',' << seconds << ',' << speedup << ','
+                << speedup / threads << ',' << delta << ',' << flag << '\n';
+        }
+    }
+}
+
+} // namespace bench
@@ -0,0 +1,40 @@
+/**
+ * @file scaling.h
+ * @brief Scaling benchmark of batch hatching across thread counts and sizes
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+namespace bench
+{
+
+/**
+ * @struct ScalingOptions
+ * @brief Grid of the scaling benchmark
+ */
+struct ScalingOptions
+{
+    std::vector<unsigned> threads = {1, 2, 4, 8};       ///< Thread counts
+    std::vector<size_t> sizes = {1000, 10000, 100000}; ///< Numbers of jobs
+    double linesPerShape = 100;                         ///< Hatch lines per job
+};
+
+/**
+ * @brief Runs batch hatching and SVG serialization for every grid point
+ * @param options Benchmark grid
+ * @param out Stream for CSV output
+ *
+ * Columns: threads, jobs, segments, seconds, speedup (relative to the first
+ * thread count of the grid times that count), efficiency (speedup per thread),
+ * peak_rss_delta (VmHWM growth over the resident size before the run) and
+ * memory_flag. The flag is "superlinear" when memory grows more than 1.5
+ * times faster than the number of jobs compared to the previous size.
+ */
+void runScaling(const ScalingOptions &options, std::ostream &out);
+
+} // namespace bench
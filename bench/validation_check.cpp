@@ -0,0 +1,152 @@
+/**
+ * @file validation_check.cpp
+ * @brief Implementation of the hatch validation check
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "validation_check.h"
+
+#include <array>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "geometry.h"
+#include "segment_buffer.h"
+
+namespace
+{
+
+/**
+ * @struct Case
+ * @brief Hatch input and the expected outcome
+ */
+struct Case
+{
+    const char *name;             ///< Case name for the report
+    geometry::Rectangle rect;     ///< Rectangle to hatch
+    double angle;                 ///< Hatch angle
+    double step;                  ///< Hatch step
+    geometry::HatchLimits limits; ///< Work limits
+    std::string error;            ///< Part of the expected error, empty if the input is valid
+    bool buffer = false;          ///< Generate into a SegmentBuffer instead of a vector
+};
+
+/**
+ * @brief Builds an axis-aligned rectangle
+ * @param x Left side
+ * @param y Bottom side
+ * @param w Width
+ * @param h Height
+ * @return Rectangle
+ */
+geometry::Rectangle box(double x, double y, double w, double h)
+{
+    return {{geometry::Point(x, y), geometry::Point(x + w, y), geometry::Point(x + w, y + h),
+             geometry::Point(x, y + h)}};
+}
+
+/**
+ * @brief Lists the checked cases
+ * @return Cases
+ */
+std::vector<Case> cases()
+{
+    return {
+        {"near origin", box(0, 0, 10, 5), 0, 1, {}, ""},
+        {"far from origin", box(1e9, 1e9, 10, 5), 0, 1, {}, ""},
+        {"far from origin, negative", box(-1e9, -1e9, 10, 5), 90, 1, {}, ""},
+        {"far from origin, tilted", box(1e6, -1e6, 10, 5), 30, 0.5, {}, ""},
+        {"far from origin, flat", box(1e9, 1e9, 10, 0.5), 90, 1, {}, ""},
+        {"far from origin, rotated",
+         {{geometry::Point(1e9, 1e9), geometry::Point(1e9 + 30, 1e9 + 40), geometry::Point(1e9 - 10, 1e9 + 70),
+           geometry::Point(1e9 - 40, 1e9 + 30)}},
+         0,
+         0.45,
+         {},
+         ""},
+        {"far from origin, rotated, tilted hatch",
+         {{geometry::Point(-1e9, 1e9), geometry::Point(-1e9 + 30, 1e9 + 40), geometry::Point(-1e9 - 10, 1e9 + 70),
+           geometry::Point(-1e9 - 40, 1e9 + 30)}},
+         75,
+         0.5,
+         {},
+         ""},
+        {"degenerate near origin",
+         {{geometry::Point(0, 0), geometry::Point(10, 0), geometry::Point(20, 0), geometry::Point(5, 0)}},
+         0,
+         1,
+         {},
+         "Rectangle is degenerate"},
+        {"degenerate far from origin",
+         {{geometry::Point(1e9, 1e9), geometry::Point(1e9 + 10, 1e9), geometry::Point(1e9 + 20, 1e9),
+           geometry::Point(1e9 + 5, 1e9)}},
+         0,
+         1,
+         {},
+         "Rectangle is degenerate"},
+        // Coefficients of the hatch lines are scaled by the step, far below EPS here
+        {"small, fine step", box(0, 0, 0.01, 0.01), 0, 1e-6, {}, ""},
+        {"small, fine step, tilted", box(0, 0, 0.01, 0.01), 30, 1e-6, {}, ""},
+        {"small, step 1e-5, tilted", box(0, 0, 0.01, 0.01), 30, 1e-5, {}, ""},
+        {"step below coordinate precision", box(0, 0, 100, 50), 0, 1e-15, {}, "step is too small"},
+        {"step below coordinate precision, far from origin", box(1e9, 1e9, 10, 5), 0, 1e-4, {}, "step is too small"},
+        // Nothing but memory bounds the result without maxSegments
+        {"tiny step, unlimited", box(0, 0, 100, 50), 0, 1e-9, {}, "don't fit in memory"},
+        {"tiny step, limited", box(0, 0, 100, 50), 0, 1e-9, {.maxSegments = 1000000}, "limit is 1000000"},
+        {"tiny step into a buffer, unlimited", box(0, 0, 100, 50), 0, 1e-9, {}, "don't fit in memory", true},
+        {"tiny step into a buffer, limited", box(0, 0, 100, 50), 0, 1e-9, {.maxSegments = 1000000},
+         "limit is 1000000", true},
+        {"small step into a buffer", box(0, 0, 100, 50), 30, 0.01, {}, "", true},
+    };
+}
+
+} // namespace
+
+namespace bench
+{
+
+bool verifyValidation(std::ostream &out)
+{
+    bool ok = true;
+    for (const auto &c : cases())
+    {
+        std::string error;
+        size_t segments = 0, lines = 0;
+        try
+        {
+            if (c.buffer)
+            {
+                geometry::SegmentBuffer out;
+                geometry::generateHatch(c.rect, c.angle, c.step, out, {}, c.limits);
+                segments = out.size();
+            }
+            else
+            {
+                segments = geometry::generateHatch(c.rect, c.angle, c.step, c.limits).size();
+            }
+            lines = geometry::hatchLineCount(c.rect, c.angle, c.step);
+        }
+        catch (const std::exception &e)
+        {
+            error = e.what();
+        }
+
+        out << c.name << ": ";
+        // A valid rectangle must give about as many lines as hatchLineCount() predicts
+        bool expected = c.error.empty() ? error.empty() && segments != 0 && segments + 2 >= lines
+                                        : error.find(c.error) != std::string::npos;
+        if (!expected)
+        {
+            out << "expected " << (c.error.empty() ? std::to_string(lines) + " segments" : "\"" + c.error + "\"")
+                << ", got " << (error.empty() ? std::to_string(segments) + " segments" : "\"" + error + "\"") << '\n';
+            ok = false;
+            continue;
+        }
+        out << (error.empty() ? std::to_string(segments) + " segments" : "rejected") << '\n';
+    }
+    return ok;
+}
+
+} // namespace bench
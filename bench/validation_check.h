@@ -0,0 +1,29 @@
+/**
+ * @file validation_check.h
+ * @brief Check of hatch input validation and work limits
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <ostream>
+
+namespace bench
+{
+
+/**
+ * @brief Runs hatch generation on inputs with a known validation outcome
+ * @param out Stream for the report, one line per case
+ * @return true if every case was accepted or rejected as expected
+ *
+ * Rectangles far from the origin or much smaller than 1 must be accepted
+ * and hatched with the predicted number of lines, degenerate ones must be
+ * rejected with the same text wherever they are. A step below the precision
+ * of the coordinates must be rejected, a step too small for the result to
+ * fit in memory must give HatchLimitExceeded, not std::bad_alloc, whether
+ * the segments go to a vector or to a SegmentBuffer.
+ */
+bool verifyValidation(std::ostream &out);
+
+} // namespace bench
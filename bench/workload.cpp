@@ -0,0 +1,192 @@
+/**
+ * @file workload.cpp
+ * @brief Implementation of the synthetic workload generator
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "workload.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace
+{
+
+/// Number of shape families mixed by workload::MIXED
+constexpr int PURE_KINDS = workload::MIXED;
+
+/**
+ * @brief Returns a uniformly distributed double
+ * @param rng Random engine
+ * @param lo Lower bound
+ * @param hi Upper bound
+ * @return Value in [lo, hi)
+ */
+double uniform(std::mt19937_64 &rng, double lo, double hi)
+{
+    return lo + (hi - lo) * double(rng() >> 11) * 0x1.0p-53;
+}
+
+/**
+ * @brief Returns a uniformly distributed integer
+ * @param rng Random engine
+ * @param lo Lower bound
+ * @param hi Upper bound
+ * @return Value in [lo, hi]
+ */
+int uniformInt(std::mt19937_64 &rng, int lo, int hi)
+{
+    return lo + static_cast<int>(rng() % uint64_t(hi - lo + 1));
+}
+
+/**
+ * @struct Shape
+ * @brief Rotated rectangle description used before conversion to points
+ */
+struct Shape
+{
+    geometry::Point center; ///< Rectangle center
+    double w;               ///< Size along the rotated x axis
+    double h;               ///< Size along the rotated y axis
+    double theta;           ///< Rotation in degrees
+};
+
+/**
+ * @brief Converts a shape to rectangle corners
+ * @param s Shape description
+ * @return Rectangle with counter-clockwise corners
+ */
+geometry::Rectangle toRectangle(const Shape &s)
+{
+    double rad = s.theta * M_PI / 180.0;
+    geometry::Vector u = geometry::Vector(std::cos(rad), std::sin(rad)) * (s.w / 2);
+    geometry::Vector v = geometry::Vector(-std::sin(rad), std::cos(rad)) * (s.h / 2);
+    geometry::Vector mu = u * (-1);
+    geometry::Vector mv = v * (-1);
+
+    return {{{s.center + mu + mv, s.center + u + mv, s.center + u + v, s.center + mu + v}}};
+}
+
+/**
+ * @brief Computes the width of a shape across hatch lines
+ * @param s Shape description
+ * @param angle Hatch angle in degrees
+ * @return Distance between the outermost hatch lines touching the shape
+ */
+double hatchWidth(const Shape &s, double angle)
+{
+    double rad = angle * M_PI / 180.0;
+    double theta = s.theta * M_PI / 180.0;
+    // Hatch line normal is (sin, cos), see geometry::generateHatch
+    geometry::Vector norm(std::sin(rad), std::cos(rad));
+    double uDot = geometry::dotProduct(geometry::Vector(std::cos(theta), std::sin(theta)), norm);
+    double vDot = geometry::dotProduct(geometry::Vector(-std::sin(theta), std::cos(theta)), norm);
+    return std::abs(s.w * uDot) + std::abs(s.h * vDot);
+}
+
+/**
+ * @brief Generates one job of a pure kind
+ * @param kind Shape family, not MIXED
+ * @param rng Random engine
+ * @param lines Approximate number of hatch lines
+ * @return Job without output file
+ */
+cmdline_parser::Config makeJob(workload::Kind kind, std::mt19937_64 &rng, int lines)
+{
+    Shape s{};
+    double angle = 0;
+    double step = 0;
+
+    switch (kind)
+    {
+    case workload::SLIVER:
+        s = {{uniform(rng, -1000, 1000), uniform(rng, -1000, 1000)}, uniform(rng, 10, 100), 0, uniform(rng, 0, 180)};
+        s.h = s.w * std::pow(10.0, uniform(rng, -6, -3));
+        angle = uniform(rng, 0, 180);
+        break;
+    case workload::HUGE_COORDS:
+        s = {{uniform(rng, -1e9, 1e9), uniform(rng, -1e9, 1e9)}, uniform(rng, 1, 100), uniform(rng, 1, 100),
+             uniform(rng, 0, 180)};
+        angle = uniform(rng, 0, 180);
+        break;
+    case workload::THROUGH_VERTEX:
+    {
+        // Integer sizes keep axis-aligned corners exact; the hatch runs along a diagonal
+        s = {{double(uniformInt(rng, -1000, 1000)), double(uniformInt(rng, -1000, 1000))},
+             double(uniformInt(rng, 1, 100)), double(uniformInt(rng, 1, 100)), 0};
+        if (rng() % 2)
+        {
+            s.theta = uniform(rng, 0, 180);
+        }
+        angle = -(s.theta + std::atan2(s.h, s.w) * 180.0 / M_PI);
+        // The other two corners are the outermost lines, hit them exactly
+        step = hatchWidth(s, angle) / 2 / std::max(1, lines / 2);
+        break;
+    }
+    case workload::PARALLEL_EDGE:
+    {
+        const double thetas[] = {0, 90, 45, 30};
+        s = {{double(uniformInt(rng, -1000, 1000)), double(uniformInt(rng, -1000, 1000))},
+             double(uniformInt(rng, 1, 100)), double(uniformInt(rng, 1, 100)), thetas[rng() % 4]};
+        // Hatch direction along the w edge or along the h edge
+        angle = rng() % 2 ? -s.theta : -s.theta - 90;
+        step = hatchWidth(s, angle) / lines;
+        break;
+    }
+    case workload::RANDOM:
+    default:
+        s = {{uniform(rng, -1000, 1000), uniform(rng, -1000, 1000)}, uniform(rng, 1, 100), uniform(rng, 1, 100),
+             uniform(rng, 0, 180)};
+        angle = uniform(rng, 0, 180);
+        break;
+    }
+
+    if (step == 0)
+    {
+        step = hatchWidth(s, angle) / lines;
+    }
+    cmdline_parser::Config job;
+    job.rect = toRectangle(s);
+    job.angle = angle;
+    job.step = step;
+    return job;
+}
+
+} // namespace
+
+namespace workload
+{
+
+std::optional<Kind> kindFromName(const std::string &name)
+{
+    const std::pair<const char *, Kind> names[] = {{"random", RANDOM},         {"sliver", SLIVER},
+                                                   {"huge", HUGE_COORDS},      {"vertex", THROUGH_VERTEX},
+                                                   {"parallel", PARALLEL_EDGE}, {"mixed", MIXED}};
+    for (const auto &[n, kind] : names)
+    {
+        if (name == n)
+        {
+            return kind;
+        }
+    }
+    return {};
+}
+
+std::vector<cmdline_parser::Config> generate(const Params &params)
+{
+    std::mt19937_64 rng(params.seed);
+    int lines = std::max(1, static_cast<int>(std::lround(params.linesPerShape)));
+
+    std::vector<cmdline_parser::Config> jobs;
+    jobs.reserve(params.count);
+    for (size_t i = 0; i < params.count; ++i)
+    {
+        Kind kind = params.kind == MIXED ? static_cast<Kind>(i % PURE_KINDS) : params.kind;
+        jobs.push_back(makeJob(kind, rng, lines));
+    }
+    return jobs;
+}
+
+} // namespace workload
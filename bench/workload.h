@@ -0,0 +1,63 @@
+/**
+ * @file workload.h
+ * @brief Reproducible synthetic hatch jobs for benchmarks and scale testing
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "cmdline_parser.h"
+
+namespace workload
+{
+
+/**
+ * @enum Kind
+ * @brief Family of generated shapes
+ */
+enum Kind
+{
+    RANDOM,         ///< Randomly rotated rectangles of moderate size
+    SLIVER,         ///< Degenerate rectangles with aspect ratio up to 1e6
+    HUGE_COORDS,    ///< Rectangles far from the origin (coordinates around 1e9)
+    THROUGH_VERTEX, ///< Hatch lines passing exactly through the corners
+    PARALLEL_EDGE,  ///< Hatch lines parallel to edges and landing on them
+    MIXED           ///< All of the above, interleaved
+};
+
+/**
+ * @struct Params
+ * @brief Workload generation settings
+ */
+struct Params
+{
+    Kind kind = MIXED;           ///< Shape family
+    size_t count = 1000;         ///< Number of jobs
+    uint64_t seed = 1;           ///< Random seed, equal seeds give equal workloads
+    double linesPerShape = 100;  ///< Approximate number of hatch lines per job
+};
+
+/**
+ * @brief Parses a workload kind name
+ * @param name One of random, sliver, huge, vertex, parallel, mixed
+ * @return Kind or empty optional for unknown names
+ */
+std::optional<Kind> kindFromName(const std::string &name);
+
+/**
+ * @brief Generates jobs
+ * @param params Generation settings
+ * @return Jobs without output files
+ *
+ * The generator uses its own conversion of mt19937_64 output to doubles, so
+ * a seed gives the same workload with every standard library.
+ */
+std::vector<cmdline_parser::Config> generate(const Params &params);
+
+} // namespace workload
@@ -0,0 +1,166 @@
+/**
+ * @file workload_main.cpp
+ * @brief Command line tool writing synthetic job files and shape sets
+ * @author Alsu Khabibulina
+ * @date 2025
+ *
+ * Usage:
+ * @code
+ * ./hatch_workload [--kind random|sliver|huge|vertex|parallel|mixed] [--count <n>] [--seed <n>]
+ *                  [--lines <n>] [--jobs <filename>] [--shapes <filename>]
+ * @endcode
+ */
+
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "job_file.h"
+#include "workload.h"
+
+namespace
+{
+
+/**
+ * @struct ToolOptions
+ * @brief Parsed command line of the tool
+ */
+struct ToolOptions
+{
+    workload::Params params;                      ///< Generation settings
+    std::optional<std::filesystem::path> jobs;   ///< Job file to write
+    std::optional<std::filesystem::path> shapes; ///< Binary shape set to write
+};
+
+/**
+ * @brief Parses tool arguments
+ * @param argc Argument count from main()
+ * @param argv Argument values from main()
+ * @return Parsed options
+ * @throw std::invalid_argument if arguments are invalid
+ */
+ToolOptions parseOptions(int argc, char **argv)
+{
+    ToolOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (i + 1 >= argc)
+        {
+            throw std::invalid_argument("Expected value after " + arg);
+        }
+        std::string value(argv[++i]);
+
+        if (arg == "--kind")
+        {
+            auto kind = workload::kindFromName(value);
+            if (!kind.has_value())
+            {
+                throw std::invalid_argument("Unknown workload kind: " + value);
+            }
+            options.params.kind = kind.value();
+        }
+        else if (arg == "--count")
+        {
+            options.params.count = std::stoull(value);
+        }
+        else if (arg == "--seed")
+        {
+            options.params.seed = std::stoull(value);
+        }
+        else if (arg == "--lines")
+        {
+            options.params.linesPerShape = std::stod(value);
+        }
+        else if (arg == "--jobs")
+        {
+            options.jobs.emplace(value);
+        }
+        else if (arg == "--shapes")
+        {
+            options.shapes.emplace(value);
+        }
+        else
+        {
+            throw std::invalid_argument("Unexpected argument: " + arg);
+        }
+    }
+
+    if (!options.jobs.has_value() && !options.shapes.has_value())
+    {
+        throw std::invalid_argument("Expected --jobs and/or --shapes output");
+    }
+    return options;
+}
+
+/**
+ * @brief Opens an output file
+ * @param path File path
+ * @param mode Open mode
+ * @return Opened stream
+ * @throw std::runtime_error if the file cannot be opened
+ */
+std::ofstream openOutput(const std::filesystem::path &path, std::ios::openmode mode)
+{
+    std::ofstream out(path, mode);
+    if (!out)
+    {
+        throw std::runtime_error("Failed to open file: " + path.string());
+    }
+    return out;
+}
+
+} // namespace
+
+/**
+ * @brief Tool entry point
+ * @param argc Number of command line arguments
+ * @param argv Array of command line argument strings
+ * @return Exit status (0 for success, 1 for error)
+ */
+int main(int argc, char **argv)
+{
+    try
+    {
+        ToolOptions options = parseOptions(argc, argv);
+        auto jobs = workload::generate(options.params);
+
+        if (options.jobs.has_value())
+        {
+            auto out = openOutput(options.jobs.value(), std::ios::out);
+            for (const auto &job : jobs)
+            {
+                job_file::writeJob(out, job);
+            }
+            if (!out.flush())
+            {
+                throw std::runtime_error("Failed to write file: " + options.jobs.value().string());
+            }
+        }
+
+        if (options.shapes.has_value())
+        {
+            std::vector<geometry::Rectangle> shapes;
+            shapes.reserve(jobs.size());
+            for (const auto &job : jobs)
+            {
+                shapes.push_back(job.rect);
+            }
+            auto out = openOutput(options.shapes.value(), std::ios::out | std::ios::binary);
+            job_file::writeShapeSet(out, shapes);
+            if (!out.flush())
+            {
+                throw std::runtime_error("Failed to write file: " + options.shapes.value().string());
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
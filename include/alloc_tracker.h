@@ -0,0 +1,142 @@
+/**
+ * @file alloc_tracker.h
+ * @brief Optional heap allocation instrumentation
+ * @author Alsu Khabibulina
+ * @date 2025
+ *
+ * When the project is configured with -DHATCH_ALLOC_TRACKING=ON the global
+ * operator new/delete are replaced with counting versions. Otherwise every
+ * type and function here compiles to a no-op, so call sites need no #ifdefs.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+
+namespace alloc_tracker
+{
+
+/// true if global operator new/delete are instrumented in this build
+#ifdef HATCH_ALLOC_TRACKING
+constexpr bool ENABLED = true;
+#else
+constexpr bool ENABLED = false;
+#endif
+
+/**
+ * @struct Stats
+ * @brief Allocation counters for the whole process or a single scope
+ */
+struct Stats
+{
+    size_t calls = 0;     ///< Number of allocations
+    size_t frees = 0;     ///< Number of deallocations
+    size_t bytes = 0;     ///< Total bytes allocated
+    long long live = 0;   ///< Bytes allocated minus bytes freed
+    long long peak = 0;   ///< Maximum value reached by live
+};
+
+/**
+ * @enum GuardMode
+ * @brief Behaviour of an AllocationGuard when its scope allocates
+ */
+enum GuardMode
+{
+    COUNT, ///< Only count allocations
+    FORBID ///< Abort the process on the first allocation inside the scope
+};
+
+/**
+ * @class AllocationGuard
+ * @brief Scoped allocation counter attributed to a call site tag
+ *
+ * Counts allocations made by the current thread while the guard is alive.
+ * Guards nest: an allocation is charged to every enclosing guard, and to the
+ * tag of the innermost one in the hot spot report. In FORBID mode the first
+ * allocation prints the tag and aborts, which gives a stack trace pointing at
+ * the offending call in a debugger or core dump.
+ *
+ * @code
+ * alloc_tracker::AllocationGuard guard("generateHatch", alloc_tracker::FORBID);
+ * geometry::generateHatch(rect, angle, step);
+ * @endcode
+ */
+class AllocationGuard
+{
+  public:
+    /**
+     * @brief Opens an instrumented scope
+     * @param tag Call site tag, must outlive the program (string literal)
+     * @param mode Whether allocations are counted or forbidden
+     */
+    explicit AllocationGuard(const char *tag, GuardMode mode = COUNT) noexcept;
+
+    /**
+     * @brief Closes the scope
+     */
+    ~AllocationGuard();
+
+    AllocationGuard(const AllocationGuard &) = delete;
+    AllocationGuard &operator=(const AllocationGuard &) = delete;
+
+    /**
+     * @brief Returns allocations made in this scope so far
+     * @return Scope counters (all zero when tracking is disabled)
+     */
+    Stats stats() const noexcept;
+
+#ifdef HATCH_ALLOC_TRACKING
+    /// @cond INTERNAL
+    void onAllocate(size_t size) noexcept;
+    void onFree(size_t size) noexcept;
+
+    AllocationGuard *outer; ///< Enclosing guard of the same thread
+    const char *tag;        ///< Call site tag
+    GuardMode mode;         ///< Guard mode
+    size_t slot;            ///< Index of the tag in the hot spot table
+    Stats counters;         ///< Scope counters
+    /// @endcond
+#endif
+};
+
+/**
+ * @brief Returns process-wide allocation counters
+ * @return Global counters (all zero when tracking is disabled)
+ */
+Stats globalStats() noexcept;
+
+/**
+ * @brief Writes allocation hot spots grouped by call site tag
+ * @param out Output stream
+ *
+ * Tags are sorted by allocated bytes. Allocations made outside any guard
+ * are reported under "<untagged>".
+ */
+void report(std::ostream &out);
+
+#ifndef HATCH_ALLOC_TRACKING
+inline AllocationGuard::AllocationGuard(const char *, GuardMode) noexcept
+{
+}
+
+inline AllocationGuard::~AllocationGuard()
+{
+}
+
+inline Stats AllocationGuard::stats() const noexcept
+{
+    return {};
+}
+
+inline Stats globalStats() noexcept
+{
+    return {};
+}
+
+inline void report(std::ostream &)
+{
+}
+#endif
+
+} // namespace alloc_tracker
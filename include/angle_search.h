@@ -0,0 +1,96 @@
+/**
+ * @file angle_search.h
+ * @brief Choice of the hatch angle with the fewest lines, without hatching
+ * @author Alsu Khabibulina
+ * @date 2025
+ *
+ * The number of hatch lines is the width of the shape across the lines
+ * divided by the step. Width as a function of the hatch angle is made of
+ * pieces where the same pair of hull vertices is extreme; on every piece it
+ * is a positive part of a sinusoid, so its minimum over any interval is at
+ * the interval ends. The ends of the pieces are the angles at which the
+ * hatch is parallel to a hull edge, and rotating calipers find the width
+ * at all of them in one pass around the hull.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "geometry.h"
+
+namespace angle_search
+{
+
+/**
+ * @struct WidthBreak
+ * @brief Width of a shape with the hatch parallel to one of its hull edges
+ */
+struct WidthBreak
+{
+    double angle; ///< Hatch angle in degrees, in [0, 180)
+    double width; ///< Extent of the shape across the hatch lines
+};
+
+/**
+ * @struct BestAngle
+ * @brief Result of the angle search
+ */
+struct BestAngle
+{
+    double angle; ///< Hatch angle in degrees, within the permitted range
+    double width; ///< Extent of the rectangle across the hatch lines
+    size_t lines; ///< Hatch lines at this angle, see geometry::hatchLineCount()
+};
+
+/**
+ * @brief Builds the convex hull of points
+ * @param points Points in any order
+ * @return Hull vertices counterclockwise from the lowest-leftmost one, without
+ *         collinear vertices; fewer than three if the points are collinear
+ *
+ * Monotone chain, O(n log n).
+ */
+std::vector<geometry::Point> convexHull(std::vector<geometry::Point> points);
+
+/**
+ * @brief Computes the width of a convex polygon across hatch lines
+ * @param hull Polygon vertices, e.g. from convexHull()
+ * @param angle Hatch angle in degrees
+ * @return Difference of the largest and smallest projection of the
+ *         vertices onto the hatch normal, O(n)
+ */
+double width(std::span<const geometry::Point> hull, double angle) noexcept;
+
+/**
+ * @brief Computes the width function of a convex polygon at its breaks
+ * @param hull Vertices from convexHull()
+ * @return One break per hull edge, sorted by angle; empty for fewer than
+ *         two vertices
+ *
+ * Rotating calipers: the vertex farthest from each edge only moves forward
+ * as the edge does, so all widths take O(n). Between two neighbouring
+ * breaks the width is larger than at either of them.
+ */
+std::vector<WidthBreak> widthBreaks(std::span<const geometry::Point> hull);
+
+/**
+ * @brief Finds the hatch angle with the fewest lines within a range
+ * @param rect Rectangle to fill with hatch
+ * @param step Distance between hatch lines
+ * @param minAngle Smallest permitted angle in degrees
+ * @param maxAngle Largest permitted angle in degrees
+ * @return Angle with the fewest lines; among equal counts the narrowest,
+ *         then the smallest angle
+ * @throw std::invalid_argument if the rectangle or step are invalid, see
+ *        geometry::validateHatch(), or the range is not finite or empty
+ *
+ * Candidates are the breaks shifted into the range by multiples of 180
+ * degrees, the width having that period, and both range ends. No segments
+ * are generated.
+ */
+BestAngle bestAngle(const geometry::Rectangle &rect, double step, double minAngle, double maxAngle);
+
+} // namespace angle_search
@@ -0,0 +1,155 @@
+/**
+ * @file batch.h
+ * @brief Parallel execution of batch hatch jobs
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "cmdline_parser.h"
+#include "geometry.h"
+#include "job_queue.h"
+#include "memory_budget.h"
+#include "progress.h"
+#include "result_cache.h"
+
+namespace batch
+{
+
+/**
+ * @struct JobResult
+ * @brief Outcome of one batch job
+ */
+struct JobResult
+{
+    size_t segments = 0;                             ///< Number of generated hatch segments
+    bool streamed = false;                           ///< true if the job was over budget and streamed
+    bool spilled = false;                            ///< true if the job was over budget and spilled to disk
+    size_t spilledBytes = 0;                         ///< Bytes of the hatch written to temporary files
+    bool cached = false;                             ///< true if the SVG file was copied from the result cache
+    bool ok = true;                                  ///< false if the job was refused or the job handler threw
+    std::string error{};                             ///< Error message of a failed job
+    geometry::RunStatus status = geometry::COMPLETE; ///< Why the job stopped early, its output is then partial
+};
+
+/**
+ * @brief Consumes the hatch of a finished job
+ *
+ * Called from worker threads, concurrently for different jobs, with the
+ * job arena that also holds the hatch. Everything allocated from the arena is
+ * released in one shot after the handler returns. Exceptions mark the job as
+ * failed and do not stop the batch. The progress reporter of the batch, if
+ * any, is passed on for the serialization stage.
+ */
+using JobHandler = std::function<void(const cmdline_parser::Config &job, std::span<const geometry::Segment> hatch,
+                                      std::pmr::memory_resource *arena, progress::Reporter *progress)>;
+
+/**
+ * @brief Writes hatch and rectangle contour to the job SVG file, if any
+ * @param job Job configuration
+ * @param hatch Generated hatch segments
+ * @param mr Memory resource for the writer buffers
+ * @param progress Receiver of written lines and bytes, may be null
+ * @throw std::runtime_error if the file cannot be written
+ */
+void writeJobSVG(const cmdline_parser::Config &job, std::span<const geometry::Segment> hatch,
+                 std::pmr::memory_resource *mr = std::pmr::get_default_resource(),
+                 progress::Reporter *progress = nullptr);
+
+/**
+ * @brief Hatches a job in constant memory, writing its SVG file on the fly
+ * @param job Job configuration
+ * @param sink Additional consumer of every segment, may be empty
+ * @param cancel Stop request and deadline of the caller
+ * @param progress Receiver of progress of both stages, may be null
+ * @return Number of hatch segments and status, the SVG file of a stopped
+ *         job holds the segments generated so far
+ * @throw std::invalid_argument if the job is invalid, before the SVG file is opened
+ * @throw geometry::HatchLimitExceeded if the job runs out of its work budget
+ * @throw std::runtime_error if the SVG file cannot be opened
+ *
+ * With job.pipelineChunk set, the SVG file is formatted and written by
+ * pipeline::SvgPipeline on two more threads, generation only fills chunks.
+ */
+JobResult streamJob(const cmdline_parser::Config &job, const geometry::SegmentSink &sink = {},
+                    const geometry::Cancellation &cancel = {}, progress::Reporter *progress = nullptr);
+
+/**
+ * @brief Hatches a job within a memory budget, spilling the hatch to disk
+ * @param job Job configuration
+ * @param budget Memory limit and spill directory
+ * @param sink Additional consumer of every segment, may be empty
+ * @param cancel Stop request and deadline of the caller
+ * @param progress Receiver of progress of both stages, may be null
+ * @return Number of hatch segments, spilled bytes and status
+ * @throw std::invalid_argument if the job is invalid
+ * @throw geometry::HatchLimitExceeded if the job runs out of its work budget
+ * @throw std::runtime_error if a temporary file or the SVG file cannot be written
+ *
+ * Unlike streamJob(), nothing is written until generation is complete: the
+ * hatch goes to a geometry::SpillSink first and is then merged back into
+ * the sink and the SVG file. A stopped or failed job leaves no output, as
+ * with the buffered handler path.
+ */
+JobResult spillJob(const cmdline_parser::Config &job, const memory_budget::Budget &budget,
+                   const geometry::SegmentSink &sink = {}, const geometry::Cancellation &cancel = {},
+                   progress::Reporter *progress = nullptr);
+
+/**
+ * @brief Hatches all jobs on a pool of threads
+ * @param jobs Jobs to run
+ * @param threads Number of worker threads, 0 for hardware concurrency
+ * @param handler Consumer of each job hatch
+ * @param budget Memory budget of the whole batch
+ * @param cancel Stop request and deadline of the whole batch
+ * @param progress Receiver of progress of all jobs, may be null
+ * @param cache Result cache of SVG files, may be null
+ * @param policy Class limits and aging of the job queue
+ * @return Results in job order
+ *
+ * Jobs are taken from a job_queue::JobQueue by Config::priority, then by
+ * Config::deadline, both counted from the call, and are not taken before
+ * their Config::delay. Jobs without a deadline are taken longest first, by
+ * geometry::hatchSegmentBound(): greedy list scheduling of sorted jobs (LPT)
+ * keeps the makespan within 4/3 of optimal, and the short jobs left at the
+ * end fill the gaps between workers. Results stay in job order.
+ *
+ * A running BATCH job is preempted at its generation checks, every
+ * TIME_CHECK_INTERVAL lines: if an INTERACTIVE job is waiting and its
+ * class has a free slot, the worker
+ * runs it to completion and then resumes the preempted job, one such job per
+ * check, until the preempted job has been paused for job_queue::Policy::maxPaused
+ * in total. Serialization is not preempted. Each worker owns a monotonic
+ * arena for the job memory, so workers never contend in the global allocator
+ * and a job costs a few arena blocks instead of an allocation per buffer.
+ *
+ * Every worker gets an equal share of the budget. A job predicted to exceed
+ * the share is refused (memory_budget::FAIL), or run instead of the handler
+ * with streamJob() (memory_budget::STREAM) or spillJob() (memory_budget::SPILL). A job that is invalid or
+ * exceeds its Config::limits fails alone, the worker moves on to the next one.
+ *
+ * On a stop request or at the deadline running jobs stop within
+ * TIME_CHECK_INTERVAL lines, without calling the handler, and the jobs not
+ * started yet are skipped. Their results carry the status.
+ *
+ * Workers report to the shared progress reporter as they go; the expected
+ * total grows as jobs start, so early snapshots under-count it.
+ *
+ * With a cache, a job with an SVG file is looked up before generation and
+ * a hit only copies the file. A completed job stores its file afterwards.
+ * The cache holds whatever the handler wrote to Config::outSVG, so it must
+ * only be used with handlers that write the job SVG file, like writeJobSVG().
+ */
+std::vector<JobResult> run(const std::vector<cmdline_parser::Config> &jobs, unsigned threads,
+                           const JobHandler &handler = writeJobSVG, const memory_budget::Budget &budget = {},
+                           const geometry::Cancellation &cancel = {}, progress::Reporter *progress = nullptr,
+                           const result_cache::Cache *cache = nullptr, const job_queue::Policy &policy = {});
+
+} // namespace batch
@@ -7,9 +7,13 @@
 
 #pragma once
 
+#include "cpu_dispatch.h"
 #include "geometry.h"
+#include "job_queue.h"
+#include "memory_budget.h"
 
 #include <filesystem>
+#include <optional>
 #include <string>
 
 namespace cmdline_parser
@@ -29,6 +33,14 @@ const std::string POINTS_ARG_NAME = "--points";
  */
 const std::string ANGLE_ARG_NAME = "--angle";
 
+/**
+ * @brief Argument name for the range the hatch angle is chosen from
+ *
+ * Expected format: --angle-range <min degrees> <max degrees>, instead of
+ * --angle; the angle with the fewest lines is used, see angle_search.h
+ */
+const std::string ANGLE_RANGE_ARG_NAME = "--angle-range";
+
 /**
  * @brief Argument name for hatch step
  *
@@ -43,16 +55,194 @@ const std::string STEP_ARG_NAME = "--step";
  */
 const std::string SVG_ARG_NAME = "--svg";
 
+/**
+ * @brief Argument name for batch job file
+ *
+ * Expected format: --jobs <filename>
+ */
+const std::string JOBS_ARG_NAME = "--jobs";
+
+/**
+ * @brief Argument name for batch worker thread count
+ *
+ * Expected format: --threads <count>, 0 means hardware concurrency
+ */
+const std::string THREADS_ARG_NAME = "--threads";
+
+/**
+ * @brief Argument name for the batch worker process count
+ *
+ * Expected format: --processes <count>
+ */
+const std::string PROCESSES_ARG_NAME = "--processes";
+
+/**
+ * @brief Argument name for memory budget
+ *
+ * Expected format: --max-memory <bytes>[K|M|G]
+ */
+const std::string MAX_MEMORY_ARG_NAME = "--max-memory";
+
+/**
+ * @brief Argument name for over-budget policy
+ *
+ * Expected format: --over-budget stream|fail|spill
+ */
+const std::string OVER_BUDGET_ARG_NAME = "--over-budget";
+
+/**
+ * @brief Argument name for the directory of spill files
+ *
+ * Expected format: --spill-dir <path>
+ */
+const std::string SPILL_DIR_ARG_NAME = "--spill-dir";
+
+/**
+ * @brief Argument name for the segment limit of a job
+ *
+ * Expected format: --max-segments <count>
+ */
+const std::string MAX_SEGMENTS_ARG_NAME = "--max-segments";
+
+/**
+ * @brief Argument name for the generation time budget of a job
+ *
+ * Expected format: --time-budget <milliseconds>
+ */
+const std::string TIME_BUDGET_ARG_NAME = "--time-budget";
+
+/**
+ * @brief Argument name for progress output
+ *
+ * Expected format: --progress, a flag without value
+ */
+const std::string PROGRESS_ARG_NAME = "--progress";
+
+/**
+ * @brief Argument name for the result cache directory
+ *
+ * Expected format: --cache-dir <path>
+ */
+const std::string CACHE_DIR_ARG_NAME = "--cache-dir";
+
+/**
+ * @brief Argument name for the result cache size limit
+ *
+ * Expected format: --cache-size <bytes>[K|M|G]
+ */
+const std::string CACHE_SIZE_ARG_NAME = "--cache-size";
+
+/**
+ * @brief Argument name for the metrics socket
+ *
+ * Expected format: --metrics-socket <path>
+ */
+const std::string METRICS_SOCKET_ARG_NAME = "--metrics-socket";
+
+/**
+ * @brief Argument name for the metrics file
+ *
+ * Expected format: --metrics-file <path>
+ */
+const std::string METRICS_FILE_ARG_NAME = "--metrics-file";
+
+/**
+ * @brief Argument name for the shared memory ring
+ *
+ * Expected format: --shm <name>
+ */
+const std::string SHM_ARG_NAME = "--shm";
+
+/**
+ * @brief Argument name for the queue class of a job
+ *
+ * Expected format: --priority interactive|batch
+ */
+const std::string PRIORITY_ARG_NAME = "--priority";
+
+/**
+ * @brief Argument name for the deadline of a job, counted from the batch start
+ *
+ * Expected format: --deadline <milliseconds>
+ */
+const std::string DEADLINE_ARG_NAME = "--deadline";
+
+/**
+ * @brief Argument name for the time a job is queued at, counted from the batch start
+ *
+ * Expected format: --delay <milliseconds>
+ */
+const std::string DELAY_ARG_NAME = "--delay";
+
+/**
+ * @brief Argument name for the limit of running interactive jobs
+ *
+ * Expected format: --interactive-limit <count>
+ */
+const std::string INTERACTIVE_LIMIT_ARG_NAME = "--interactive-limit";
+
+/**
+ * @brief Argument name for the limit of running batch jobs
+ *
+ * Expected format: --batch-limit <count>
+ */
+const std::string BATCH_LIMIT_ARG_NAME = "--batch-limit";
+
+/**
+ * @brief Argument name for the wait after which a batch job counts as interactive
+ *
+ * Expected format: --aging <milliseconds>
+ */
+const std::string AGING_ARG_NAME = "--aging";
+
+/**
+ * @brief Argument name for the pause after which a running batch job is not preempted
+ *
+ * Expected format: --max-paused <milliseconds>
+ */
+const std::string MAX_PAUSED_ARG_NAME = "--max-paused";
+
+/**
+ * @brief Argument name for the segments per chunk of the streamed SVG pipeline
+ *
+ * Expected format: --chunk-size <segments>
+ */
+const std::string CHUNK_SIZE_ARG_NAME = "--chunk-size";
+
+/**
+ * @brief Argument name for the instruction set of geometry kernels
+ *
+ * Expected format: --isa scalar|sse2|avx2|avx512
+ */
+const std::string ISA_ARG_NAME = "--isa";
+
 /**
  * @struct Config
  * @brief Configuration parameters parsed from command line
  */
 struct Config
 {
-    geometry::Rectangle rect;                    ///< Rectangle defined by four points
-    double angle;                                ///< Hatch angle in degrees
-    double step;                                 ///< Distance between hatch lines
-    std::optional<std::filesystem::path> outSVG; ///< Optional SVG output file path
+    geometry::Rectangle rect;                           ///< Rectangle defined by four points
+    double angle;                                       ///< Hatch angle in degrees
+    double step;                                        ///< Distance between hatch lines
+    std::optional<std::filesystem::path> outSVG;        ///< Optional SVG output file path
+    std::optional<std::filesystem::path> jobs;          ///< Optional batch job file, replaces the single job
+    unsigned threads = 1;                               ///< Batch worker threads, 0 for hardware concurrency
+    unsigned processes = 1;                             ///< Batch worker processes, 0 for hardware concurrency
+    memory_budget::Budget memory;                       ///< Memory budget of the process
+    geometry::HatchLimits limits;                       ///< Work budget, default for every job in batch mode
+    bool progress = false;                              ///< Print throttled progress to stderr
+    std::optional<std::filesystem::path> cache;         ///< Result cache directory, batch mode only
+    size_t cacheBytes = 0;                              ///< Result cache size limit, 0 for unlimited
+    std::optional<std::filesystem::path> metricsSocket; ///< Unix socket serving Prometheus metrics
+    std::optional<std::filesystem::path> metricsFile;   ///< File of metrics dumped on SIGUSR1 and at exit
+    std::optional<std::string> shm;                     ///< Shared memory ring receiving the segments, single job only
+    job_queue::Priority priority = job_queue::BATCH;    ///< Queue class of the job
+    std::chrono::milliseconds deadline{0};              ///< Deadline after the batch start, 0 for none
+    std::chrono::milliseconds delay{0};                 ///< Time after the batch start the job is queued at
+    job_queue::Policy queue;                            ///< Class limits, aging and pauses of the batch queue
+    size_t pipelineChunk = 0;                           ///< Segments per chunk of streamed SVG output, 0 for no pipeline
+    std::optional<cpu_dispatch::Isa> isa;               ///< Instruction set of geometry kernels, best supported if empty
 };
 
 /**
@@ -65,8 +255,32 @@ struct Config
  * Supported arguments:
  * - --points x1 y1 x2 y2 x3 y3 x4 y4 (required)
  * - --angle <degrees> (required)
+ * - --angle-range <min degrees> <max degrees> (instead of --angle)
  * - --step <distance> (required)
  * - --svg <filename> (optional)
+ * - --jobs <filename> (instead of the four above, see job_file.h)
+ * - --threads <count> (optional, with --jobs only)
+ * - --processes <count> (optional, with --jobs only)
+ * - --max-memory <bytes>[K|M|G] (optional)
+ * - --over-budget stream|fail|spill (optional, default stream)
+ * - --spill-dir <path> (optional, system temporary directory by default)
+ * - --max-segments <count> (optional)
+ * - --time-budget <milliseconds> (optional)
+ * - --progress (optional)
+ * - --cache-dir <path> (optional, with --jobs only)
+ * - --cache-size <bytes>[K|M|G] (optional, with --cache-dir only)
+ * - --metrics-socket <path> (optional)
+ * - --metrics-file <path> (optional)
+ * - --shm <name> (optional, without --jobs only)
+ * - --priority interactive|batch (optional, default batch)
+ * - --deadline <milliseconds> (optional)
+ * - --delay <milliseconds> (optional)
+ * - --interactive-limit <count> (optional, with --jobs only)
+ * - --batch-limit <count> (optional, with --jobs only)
+ * - --aging <milliseconds> (optional, with --jobs only, default 1000, 0 never)
+ * - --max-paused <milliseconds> (optional, with --jobs only, default 1000, 0 no limit)
+ * - --chunk-size <segments> (optional)
+ * - --isa scalar|sse2|avx2|avx512 (optional)
  */
 Config parse(int argc, char *argv[]);
 
@@ -0,0 +1,88 @@
+/**
+ * @file coalescer.h
+ * @brief Coalescing of concurrent identical hatch requests
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cmdline_parser.h"
+#include "geometry.h"
+
+namespace coalescing
+{
+
+/**
+ * @brief Hatch of one computation, shared by all requests coalesced into it
+ */
+using SharedHatch = std::shared_ptr<const std::vector<geometry::Segment>>;
+
+/**
+ * @struct Stats
+ * @brief Request counters of a Coalescer
+ */
+struct Stats
+{
+    size_t requests;     ///< Calls of Coalescer::hatch()
+    size_t computations; ///< Hatches actually generated, the rest were shared
+};
+
+/**
+ * @brief Builds the key under which requests are coalesced
+ * @param job Job configuration
+ * @return Job line of job_file::writeJob() without the SVG path and scheduling fields
+ *
+ * Points, angle and step are written with full precision, so only requests
+ * with bit-identical parameters and equal limits share a computation.
+ */
+std::string requestKey(const cmdline_parser::Config &job);
+
+/**
+ * @class Coalescer
+ * @brief Library front end that generates each in-flight hatch once
+ *
+ * The first request for a key generates the hatch on its own thread.
+ * Requests for the same key arriving meanwhile block on a shared future and
+ * receive the same immutable result, or the same exception. The key is
+ * dropped once the result is ready: a Coalescer removes duplicate work
+ * under concurrent bursts and is not a cache, finished hatches are owned by
+ * their callers only.
+ *
+ * All member functions are thread-safe.
+ */
+class Coalescer
+{
+  public:
+    /**
+     * @brief Returns the hatch of a job, sharing a running computation
+     * @param job Job configuration, its SVG path is ignored
+     * @return Hatch segments
+     * @throw std::invalid_argument if parameters are invalid
+     * @throw geometry::HatchLimitExceeded if the job exceeds its work budget
+     */
+    SharedHatch hatch(const cmdline_parser::Config &job);
+
+    /**
+     * @brief Returns request counters
+     * @return Requests and computations so far
+     */
+    Stats stats() const noexcept;
+
+  private:
+    std::mutex mutex;                                                          ///< Guards inFlight
+    std::unordered_map<std::string, std::shared_future<SharedHatch>> inFlight; ///< Running computations by key
+    std::atomic<size_t> requests{0};                                           ///< Calls of hatch()
+    std::atomic<size_t> computations{0};                                       ///< Hatches generated
+};
+
+} // namespace coalescing
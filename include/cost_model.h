@@ -0,0 +1,48 @@
+/**
+ * @file cost_model.h
+ * @brief Closed-form cost prediction of hatch jobs for admission and scheduling
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "geometry.h"
+#include "memory_budget.h"
+
+namespace cost_model
+{
+
+/**
+ * @struct HatchCost
+ * @brief Predicted cost of one hatch job
+ */
+struct HatchCost
+{
+    size_t lines;                   ///< Hatch lines crossing the rectangle, see geometry::hatchLineCount()
+    size_t maxSegments;             ///< Upper bound of generated segments, see geometry::hatchSegmentBound()
+    double totalLength;             ///< Total length of the hatch lines
+    size_t textBytes;               ///< Console output, one "Line: ..." row per line
+    size_t svgHatchBytes;           ///< SVG line elements of the hatch
+    size_t svgContourBytes;         ///< SVG line elements of the contour
+    size_t svgBytes;                ///< Whole SVG file, elements with header and tail
+    memory_budget::Estimate memory; ///< Memory of a buffered run with SVG output
+};
+
+/**
+ * @brief Predicts cost of a hatch job without running it
+ * @param rect Rectangle to fill with hatch
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @return Prediction, O(1); all zero except memory for invalid parameters
+ *
+ * Line counts and length are exact for convex rectangles. Output sizes
+ * format one representative hatch segment and contour edge with the real
+ * writers and scale them by the counts, so they hold up to the varying
+ * number of digits.
+ */
+HatchCost estimateHatch(const geometry::Rectangle &rect, double angle, double step);
+
+} // namespace cost_model
@@ -0,0 +1,152 @@
+/**
+ * @file cpu_dispatch.h
+ * @brief Geometry kernels compiled for several instruction sets, selected at run time
+ * @author Alsu Khabibulina
+ * @date 2025
+ *
+ * Every kernel exists as a portable SCALAR variant and, on x86, as SSE2, AVX2
+ * and AVX-512 variants built with target attributes, so one binary runs on
+ * any x86-64 machine and uses the widest vectors the CPU has. The best
+ * supported variant is chosen via cpuid on first use; selectIsa() overrides
+ * it, e.g. for benchmarks. All variants give bit-identical results: they
+ * perform the same IEEE operations per element and are compiled without
+ * FMA contraction.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cpu_dispatch
+{
+
+/**
+ * @enum Isa
+ * @brief Instruction set of a kernel variant, from narrowest to widest
+ */
+enum Isa
+{
+    SCALAR, ///< Portable C++, no explicit vectors
+    SSE2,   ///< 128-bit vectors, every x86-64 CPU
+    AVX2,   ///< 256-bit vectors
+    AVX512  ///< 512-bit vectors, AVX-512F
+};
+
+/// Number of instruction sets
+constexpr size_t ISA_COUNT = 4;
+
+/// Lines intersectLines() takes at most
+constexpr size_t MAX_BATCH_LINES = 32;
+
+/// Elements the arrays passed to intersectLines() are padded to a multiple of
+constexpr size_t BATCH_PADDING = 8;
+
+/**
+ * @struct Range
+ * @brief Minimum and maximum of some values
+ */
+struct Range
+{
+    double min; ///< Smallest value
+    double max; ///< Largest value
+};
+
+/**
+ * @struct Kernels
+ * @brief Entry points of one instruction set variant
+ */
+struct Kernels
+{
+    /**
+     * @brief Finds range of two columns over [begin, end)
+     *
+     * Parameters: first column, second column, first index (a multiple of
+     * 8, columns 64-byte aligned), index past the last one. NaN values are
+     * ignored. A zero bound may be either +0 or -0 depending on the order
+     * values are visited in, callers that need a definite sign normalize it.
+     */
+    Range (*columnRange)(const double *a, const double *b, size_t begin, size_t end) noexcept;
+
+    /**
+     * @brief Applies x' = (m * x + t) * s to a column over [begin, end)
+     *
+     * Parameters: column transformed in place (64-byte aligned), first
+     * index and index past the last one (both multiples of 8), mirror factor
+     * m, translation t, scale s.
+     */
+    void (*transformColumn)(double *column, size_t begin, size_t end, double m, double t, double s) noexcept;
+
+    /**
+     * @brief Intersects a line with a batch of lines
+     *
+     * Parameters: coefficient columns a, b, c of the batch (ax + by + c = 0),
+     * column tol of geometry::parallelTolerance() of each line and the line,
+     * number of lines n (at most MAX_BATCH_LINES), coefficients la, lb, lc of
+     * the line, output columns x and y. Input and output arrays hold n rounded
+     * up to BATCH_PADDING elements. Returns a mask with bit i set if line i
+     * is not parallel to the line, as decided by geometry::isLinesSameOrParallel();
+     * x[i] and y[i] then hold the point geometry::linesIntersection() computes.
+     */
+    uint32_t (*intersectLines)(const double *a, const double *b, const double *c, const double *tol, size_t n,
+                               double la, double lb, double lc, double *x, double *y) noexcept;
+};
+
+/**
+ * @brief Checks whether the CPU and the build support an instruction set
+ * @param isa Instruction set
+ * @return true if its kernels can run here
+ */
+bool supported(Isa isa) noexcept;
+
+/**
+ * @brief Returns the widest supported instruction set
+ * @return Instruction set selected by default
+ */
+Isa bestIsa() noexcept;
+
+/**
+ * @brief Returns the instruction set of the kernels in use
+ * @return Selected instruction set
+ */
+Isa activeIsa() noexcept;
+
+/**
+ * @brief Switches all kernels to an instruction set
+ * @param isa Instruction set
+ * @throw std::invalid_argument if the instruction set is not supported
+ *
+ * Meant to be called at startup, kernels already running keep their variant.
+ */
+void selectIsa(Isa isa);
+
+/**
+ * @brief Returns the kernels in use
+ * @return Kernels of activeIsa()
+ */
+const Kernels &kernels() noexcept;
+
+/**
+ * @brief Returns the kernels of an instruction set
+ * @param isa Supported instruction set
+ * @return Kernels of the instruction set
+ */
+const Kernels &kernelsFor(Isa isa) noexcept;
+
+/**
+ * @brief Returns the name of an instruction set
+ * @param isa Instruction set
+ * @return Name accepted by parseIsa(), e.g. "avx2"
+ */
+std::string isaName(Isa isa);
+
+/**
+ * @brief Parses an instruction set name
+ * @param name One of scalar, sse2, avx2, avx512
+ * @return Instruction set
+ * @throw std::invalid_argument if the name is unknown
+ */
+Isa parseIsa(const std::string &name);
+
+} // namespace cpu_dispatch
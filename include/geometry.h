@@ -8,15 +8,31 @@
 #pragma once
 
 #include <array>
+#include <chrono>
+#include <functional>
+#include <memory_resource>
+#include <optional>
 #include <ostream>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
 #include <vector>
 
+#include "cpu_dispatch.h"
+#include "progress.h"
+
 namespace geometry
 {
 
 /// Epsilon value for floating point comparisons
 constexpr double EPS = 1e-7;
 
+/// Epsilon relative to the magnitude of coordinates, some thousands of ulps
+constexpr double RELATIVE_EPS = 1e-12;
+
+/// Lines generated or written between checks of time budgets, deadlines and stop requests
+constexpr size_t TIME_CHECK_INTERVAL = 4096;
+
 struct Vector;
 
 /**
@@ -88,7 +104,7 @@ struct Line
      * @param p1 First point on the line
      * @param p2 Second point on the line
      */
-    Line(const Point &p1, const Point &p2) noexcept : a(p1.y - p2.y), b(p2.x - p1.x), c(p1.x * p2.y - p2.x * p1.y)
+    Line(const Point &p1, const Point &p2) noexcept : a(p1.y - p2.y), b(p2.x - p1.x), c(-a * p1.x - b * p1.y)
     {
     }
 
@@ -137,6 +153,150 @@ struct Rectangle
      * @return Vector containing the four segments of the rectangle
      */
     std::vector<Segment> toSegments() const noexcept;
+
+    /**
+     * @brief Converts rectangle to its four boundary segments
+     * @param mr Memory resource for the result
+     * @return Vector containing the four segments of the rectangle
+     */
+    std::pmr::vector<Segment> toSegments(std::pmr::memory_resource *mr) const;
+};
+
+/**
+ * @class PreparedShape
+ * @brief Rectangle with everything hatching derives from it computed once
+ *
+ * generateHatch() on a Rectangle prepares it on every call. Sweeps over
+ * many angles or steps of one rectangle prepare it once and hatch the
+ * PreparedShape, paying only per-line costs and no allocation for the
+ * edges. Immutable after construction, one instance may be shared between
+ * threads.
+ */
+class PreparedShape
+{
+  public:
+    /**
+     * @struct Projection
+     * @brief Corners projected onto the hatch normal of one angle
+     */
+    struct Projection
+    {
+        double angle; ///< Hatch angle in degrees
+        double sin;   ///< Sine of the angle, first normal coordinate
+        double cos;   ///< Cosine of the angle, second normal coordinate
+        double lo;    ///< Smallest projection relative to the first corner
+        double hi;    ///< Largest projection relative to the first corner
+    };
+
+    /**
+     * @struct Columns
+     * @brief Side line coefficients laid out for cpu_dispatch::Kernels::intersectLines()
+     */
+    struct Columns
+    {
+        alignas(64) std::array<double, cpu_dispatch::BATCH_PADDING> a{}; ///< First coefficients
+        alignas(64) std::array<double, cpu_dispatch::BATCH_PADDING> b{}; ///< Second coefficients
+        alignas(64) std::array<double, cpu_dispatch::BATCH_PADDING> c{}; ///< Constant terms
+    };
+
+    /**
+     * @brief Prepares a rectangle
+     * @param rect Rectangle to fill with hatch
+     * @param angles Angles in degrees to cache corner projections for
+     *
+     * An invalid rectangle is accepted, its error is thrown by validate()
+     * so that errors keep the order of validateHatch().
+     */
+    explicit PreparedShape(const Rectangle &rect, std::span<const double> angles = {});
+
+    /**
+     * @brief Returns the prepared rectangle
+     * @return Rectangle as given
+     */
+    const Rectangle &rect() const noexcept
+    {
+        return shape;
+    }
+
+    /**
+     * @brief Returns the boundary segments
+     * @return Segments in the order of Rectangle::toSegments()
+     */
+    std::span<const Segment> edges() const noexcept
+    {
+        return sides;
+    }
+
+    /**
+     * @brief Returns the side line coefficients as columns
+     * @return Coefficients of edges(), zero padded
+     */
+    const Columns &columns() const noexcept
+    {
+        return lines;
+    }
+
+    /**
+     * @brief Checks whether all sides are parallel to the axes
+     * @return true if every side line has a == 0 or b == 0
+     */
+    bool axisAligned() const noexcept
+    {
+        return aligned;
+    }
+
+    /**
+     * @brief Checks whether the corners are a convex polygon in their order
+     * @return true if no corner turns against the others
+     */
+    bool convex() const noexcept
+    {
+        return isConvex;
+    }
+
+    /**
+     * @brief Returns the lower left corner of the bounding box
+     * @return Smallest coordinates of the corners
+     */
+    const Point &boundsMin() const noexcept
+    {
+        return lower;
+    }
+
+    /**
+     * @brief Returns the upper right corner of the bounding box
+     * @return Largest coordinates of the corners
+     */
+    const Point &boundsMax() const noexcept
+    {
+        return upper;
+    }
+
+    /**
+     * @brief Projects the corners onto the hatch normal of an angle
+     * @param angle Hatch angle in degrees
+     * @return Projection, cached if the angle was given to the constructor
+     */
+    Projection project(double angle) const noexcept;
+
+    /**
+     * @brief Validates hatch parameters, as validateHatch() on rect()
+     * @param angle Angle of hatch lines in degrees
+     * @param step Distance between hatch lines
+     * @throw std::invalid_argument if parameters are invalid
+     */
+    void validate(double angle, double step) const;
+
+  private:
+    Rectangle shape;                     ///< Prepared rectangle
+    std::array<Segment, 4> sides;        ///< Boundary segments
+    Columns lines;                       ///< Side line coefficients
+    bool aligned;                        ///< All sides axis-parallel
+    bool isConvex;                       ///< Corners form a convex polygon
+    Point lower;                         ///< Bounding box minimum
+    Point upper;                         ///< Bounding box maximum
+    const char *invalid;                 ///< Why the rectangle can't be hatched, null if it can
+    std::vector<Projection> projections; ///< Cached projections, sorted by angle
 };
 
 /**
@@ -175,11 +335,24 @@ double distance2(const Point &p1, const Point &p2) noexcept;
  */
 Vector normOf(const Line &l) noexcept;
 
+/**
+ * @brief Returns the largest cross product of normals of two parallel lines
+ * @param l1 First line
+ * @param l2 Second line
+ * @return EPS scaled by the largest coefficients a, b of both lines
+ *
+ * Coefficients grow with the side length and the hatch step, the tolerance
+ * grows with them so that it bounds the angle between the lines.
+ */
+double parallelTolerance(const Line &l1, const Line &l2) noexcept;
+
 /**
  * @brief Checks if two lines are the same or parallel
  * @param l1 First line
  * @param l2 Second line
  * @return true if lines are same or parallel, false otherwise
+ *
+ * Lines are parallel if the cross product of their normals is within parallelTolerance().
  */
 bool isLinesSameOrParallel(const Line &l1, const Line &l2) noexcept;
 
@@ -199,21 +372,316 @@ Point linesIntersection(const Line &l1, const Line &l2) noexcept;
  * @param s Segment to check against
  * @return true if point lies on the segment, false otherwise
  *
- * Uses epsilon comparison for floating point precision.
+ * Uses epsilon comparison for floating point precision: the distance to the
+ * line is within EPS for segments of length 1 and longer, shrinks with shorter
+ * ones, and is at least RELATIVE_EPS of the endpoint coordinates, which bounds
+ * the rounding of points far from the origin.
  */
 bool isInSegment(const Point &p, const Segment &s) noexcept;
 
+/**
+ * @struct HatchLimits
+ * @brief Work budget of one hatch generation, zero means unlimited
+ */
+struct HatchLimits
+{
+    size_t maxSegments = 0;                  ///< Maximal number of hatch lines
+    std::chrono::milliseconds timeBudget{0}; ///< Maximal generation time
+};
+
+/**
+ * @class HatchLimitExceeded
+ * @brief Thrown when a hatch generation runs out of its work budget
+ */
+class HatchLimitExceeded : public std::runtime_error
+{
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * @enum RunStatus
+ * @brief How a cancellable operation ended
+ */
+enum RunStatus
+{
+    COMPLETE,         ///< All work is done
+    CANCELLED,        ///< Stopped on a stop request, output is partial
+    DEADLINE_EXCEEDED ///< Stopped at the deadline, output is partial
+};
+
+/**
+ * @struct Cancellation
+ * @brief Means for the caller to stop a long operation early
+ *
+ * Unlike HatchLimits, which make a job fail, cancellation is a normal
+ * outcome: the operation stops at its next check and keeps what it has done.
+ * The same checks are preemption points: yield, if set, may run a more
+ * urgent job on the calling thread before the operation goes on. Time spent
+ * in yield does not count against HatchLimits::timeBudget.
+ */
+struct Cancellation
+{
+    std::stop_token stop;                                          ///< Stop request, a default token never stops
+    std::optional<std::chrono::steady_clock::time_point> deadline; ///< Time to stop at
+    std::function<void()> yield;                                   ///< Called at every check, may run other work
+
+    /**
+     * @brief Checks whether the operation should stop
+     * @return COMPLETE to go on, otherwise the reason to stop
+     */
+    RunStatus poll() const noexcept
+    {
+        if (stop.stop_requested())
+        {
+            return CANCELLED;
+        }
+        if (deadline.has_value() && std::chrono::steady_clock::now() >= deadline.value())
+        {
+            return DEADLINE_EXCEEDED;
+        }
+        return COMPLETE;
+    }
+};
+
+/**
+ * @brief Validates hatch parameters
+ * @param rect Rectangle to fill with hatch
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @throw std::invalid_argument if step is not a positive finite number, angle
+ *        or a coordinate is not finite, the rectangle is degenerate, or step
+ *        is below RELATIVE_EPS of the largest coordinate magnitude, where
+ *        consecutive lines would round to the same one
+ */
+void validateHatch(const Rectangle &rect, double angle, double step);
+
+/**
+ * @brief Validates hatch parameters and computes the line count under limits
+ * @param rect Rectangle to fill with hatch
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @param limits Work budget
+ * @return Upper bound of the number of segments, see hatchSegmentBound()
+ * @throw std::invalid_argument if parameters are invalid
+ * @throw HatchLimitExceeded if hatchLineCount() is over limits.maxSegments
+ *
+ * O(1), so a job can be refused before anything is allocated or generated.
+ */
+size_t checkHatch(const Rectangle &rect, double angle, double step, const HatchLimits &limits = {});
+
+/**
+ * @brief Validates hatch parameters and computes the line count under limits
+ * @param shape Prepared rectangle to fill with hatch
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @param limits Work budget
+ * @return Upper bound of the number of segments, see hatchSegmentBound()
+ * @throw std::invalid_argument if parameters are invalid
+ * @throw HatchLimitExceeded if hatchLineCount() is over limits.maxSegments
+ */
+size_t checkHatch(const PreparedShape &shape, double angle, double step, const HatchLimits &limits = {});
+
+/**
+ * @brief Reserves room for the segments of a hatch
+ * @param bound Upper bound of the number of segments, see checkHatch()
+ * @param segmentBytes Bytes one segment takes in the result
+ * @param room Most segments the result can take besides those it holds
+ * @param reserve Reserves room for bound more segments in the result
+ * @throw HatchLimitExceeded if bound is over room, the segments take more
+ *        than physical memory, or reserve throws std::bad_alloc
+ *
+ * Without limits.maxSegments nothing else stops a tiny step before the
+ * reserve, and std::bad_alloc wouldn't tell what went wrong.
+ */
+void reserveSegments(size_t bound, size_t segmentBytes, size_t room, const std::function<void()> &reserve);
+
 /**
  * @brief Generates hatch lines for a rectangle
  * @param rect Rectangle to fill with hatch
  * @param angle Angle of hatch lines in degrees
  * @param step Distance between hatch lines
+ * @param limits Work budget
+ * @param progress Receiver of progress, may be null
  * @return Vector of hatch segments
+ * @throw std::invalid_argument if parameters are invalid
+ * @throw HatchLimitExceeded if the work budget is exceeded or the segments
+ *        don't fit in memory
  *
  * Creates a series of parallel lines at given angle that intersect
  * with the rectangle, commonly used for shading or cross-hatching.
  */
-std::vector<Segment> generateHatch(const Rectangle &rect, double angle, double step) noexcept;
+std::vector<Segment> generateHatch(const Rectangle &rect, double angle, double step,
+                                   const HatchLimits &limits = {}, progress::Reporter *progress = nullptr);
+
+/**
+ * @brief Generates hatch lines for a rectangle using given memory resource
+ * @param rect Rectangle to fill with hatch
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @param mr Memory resource for the result and the intersection scratch storage
+ * @param limits Work budget
+ * @return Vector of hatch segments
+ * @throw std::invalid_argument if parameters are invalid
+ * @throw HatchLimitExceeded if the work budget is exceeded or the segments
+ *        don't fit in memory
+ *
+ * With a std::pmr::monotonic_buffer_resource all memory of a job is one or
+ * a few arena blocks, released at once when the arena is released.
+ */
+std::pmr::vector<Segment> generateHatch(const Rectangle &rect, double angle, double step,
+                                        std::pmr::memory_resource *mr, const HatchLimits &limits = {});
+
+/**
+ * @brief Receives hatch segments one by one as they are generated
+ */
+using SegmentSink = std::function<void(const Segment &)>;
+
+/**
+ * @brief Generates hatch lines for a rectangle without storing them
+ * @param rect Rectangle to fill with hatch
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @param sink Called for every hatch segment, in the same order as
+ *             generateHatch() returns them
+ * @param limits Work budget
+ * @param cancel Stop request and deadline of the caller
+ * @param progress Receiver of progress, may be null
+ * @param scratch Memory resource for the intersection scratch storage
+ * @return COMPLETE, or why generation stopped early
+ * @throw std::invalid_argument if parameters are invalid
+ * @throw HatchLimitExceeded if the work budget is exceeded, segments
+ *        already passed to the sink stay there
+ *
+ * Uses constant memory, so output of any size can be streamed to a file.
+ * Never runs more iterations than the computed line count allows, the
+ * time budget and cancellation are checked and progress is reported every
+ * TIME_CHECK_INTERVAL lines. Rectangles with axis-parallel sides take a
+ * fast path, see setFastPath().
+ */
+RunStatus generateHatch(const Rectangle &rect, double angle, double step, const SegmentSink &sink,
+                        const HatchLimits &limits = {}, const Cancellation &cancel = {},
+                        progress::Reporter *progress = nullptr,
+                        std::pmr::memory_resource *scratch = std::pmr::get_default_resource());
+
+/**
+ * @brief Generates hatch lines until done or stopped
+ * @param rect Rectangle to fill with hatch
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @param out Vector to append segments to, its memory resource is also
+ *            used for the scratch storage
+ * @param cancel Stop request and deadline of the caller
+ * @param limits Work budget
+ * @param progress Receiver of progress, may be null
+ * @return COMPLETE, or why generation stopped early; out then holds the
+ *         segments generated so far
+ * @throw std::invalid_argument if parameters are invalid
+ * @throw HatchLimitExceeded if the work budget is exceeded or the segments
+ *        don't fit in memory
+ */
+RunStatus generateHatch(const Rectangle &rect, double angle, double step, std::pmr::vector<Segment> &out,
+                        const Cancellation &cancel, const HatchLimits &limits = {},
+                        progress::Reporter *progress = nullptr);
+
+/**
+ * @brief Generates hatch lines for a prepared rectangle
+ * @param shape Prepared rectangle to fill with hatch
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @param limits Work budget
+ * @param progress Receiver of progress, may be null
+ * @return Vector of hatch segments, the same as for shape.rect()
+ * @throw std::invalid_argument if parameters are invalid
+ * @throw HatchLimitExceeded if the work budget is exceeded or the segments
+ *        don't fit in memory
+ */
+std::vector<Segment> generateHatch(const PreparedShape &shape, double angle, double step,
+                                   const HatchLimits &limits = {}, progress::Reporter *progress = nullptr);
+
+/**
+ * @brief Generates hatch lines for a prepared rectangle without storing them
+ * @param shape Prepared rectangle to fill with hatch
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @param sink Called for every hatch segment, the same as for shape.rect()
+ * @param limits Work budget
+ * @param cancel Stop request and deadline of the caller
+ * @param progress Receiver of progress, may be null
+ * @param scratch Memory resource for the intersection scratch storage
+ * @return COMPLETE, or why generation stopped early
+ * @throw std::invalid_argument if parameters are invalid
+ * @throw HatchLimitExceeded if the work budget is exceeded
+ *
+ * The overloads taking a Rectangle prepare it and call this one.
+ */
+RunStatus generateHatch(const PreparedShape &shape, double angle, double step, const SegmentSink &sink,
+                        const HatchLimits &limits = {}, const Cancellation &cancel = {},
+                        progress::Reporter *progress = nullptr,
+                        std::pmr::memory_resource *scratch = std::pmr::get_default_resource());
+
+/**
+ * @brief Enables or disables the fast path for axis-aligned rectangles
+ * @param enabled false to intersect every hatch line with all four sides
+ *
+ * The fast path skips sides parallel to the hatch, which at 0 and 90
+ * degrees are half of them, and divides the coordinate fixed by an
+ * axis-parallel side once per direction instead of once per line. It
+ * performs the remaining operations of the general path in the same order,
+ * so segments are bit-identical; switching it off is meant for benchmarks
+ * and checks. Enabled by default.
+ */
+void setFastPath(bool enabled) noexcept;
+
+/**
+ * @brief Checks whether the fast path for axis-aligned rectangles is used
+ * @return Value last passed to setFastPath(), true by default
+ */
+bool fastPathEnabled() noexcept;
+
+/**
+ * @brief Computes the number of hatch lines crossing a rectangle
+ * @param rect Rectangle to fill with hatch
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @return Number of lines strictly crossing the rectangle interior
+ *
+ * Closed form over the projections of the corners onto the hatch normal,
+ * O(1). generateHatch() may also emit the lines through the two extreme
+ * corners, as zero-length or edge-long segments, see hatchSegmentBound().
+ */
+size_t hatchLineCount(const Rectangle &rect, double angle, double step) noexcept;
+
+/**
+ * @brief Computes the number of hatch lines crossing a prepared rectangle
+ * @param shape Prepared rectangle to fill with hatch
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @return The same as for shape.rect(), see PreparedShape::project()
+ */
+size_t hatchLineCount(const PreparedShape &shape, double angle, double step) noexcept;
+
+/**
+ * @brief Computes an upper bound of generateHatch() result size
+ * @param rect Rectangle to fill with hatch
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @return hatchLineCount() plus the two lines touching the extreme corners,
+ *         saturated at SIZE_MAX
+ */
+size_t hatchSegmentBound(const Rectangle &rect, double angle, double step) noexcept;
+
+/**
+ * @brief Computes the total length of hatch lines crossing a rectangle
+ * @param rect Convex rectangle to fill with hatch
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @return Sum of lengths of the lines counted by hatchLineCount()
+ *
+ * The chord length is piecewise linear in the line offset, with breaks at
+ * the corners, so the sum over each piece is an arithmetic series. O(1).
+ */
+double hatchTotalLength(const Rectangle &rect, double angle, double step) noexcept;
 
 /**
  * @brief Output stream operator for Point
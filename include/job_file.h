@@ -0,0 +1,119 @@
+/**
+ * @file job_file.h
+ * @brief Reading and writing of batch job files and binary shape sets
+ * @author Alsu Khabibulina
+ * @date 2025
+ *
+ * A job file is a text file with one job per line. A job line holds the same
+ * arguments as the command line (see cmdline_parser::parse), blank lines and
+ * lines starting with '#' are ignored. Paths must not contain whitespace:
+ * @code
+ * # rect, 30 degrees, step 0.5
+ * --points 0 0 10 0 10 5 0 5 --angle 30 --step 0.5 --svg out.svg
+ * @endcode
+ *
+ * A shape set is a binary file of rectangles in native byte order:
+ * 8-byte magic "HATCHSHP", uint32 version, uint32 reserved, uint64 count,
+ * then count records of 8 doubles (x1 y1 x2 y2 x3 y3 x4 y4).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "cmdline_parser.h"
+#include "geometry.h"
+
+namespace job_file
+{
+
+/// Shape set format version
+constexpr uint32_t SHAPE_SET_VERSION = 1;
+
+/**
+ * @brief Parses one job line
+ * @param line Job arguments separated by whitespace
+ * @return Parsed job
+ * @throw std::invalid_argument if the line is not a valid job
+ */
+cmdline_parser::Config parseJob(const std::string &line);
+
+/**
+ * @brief Reads all jobs from a stream
+ * @param in Input stream with job file content
+ * @return Jobs in file order
+ * @throw std::invalid_argument with line number if a line is invalid
+ */
+std::vector<cmdline_parser::Config> readJobs(std::istream &in);
+
+/**
+ * @struct ByteRange
+ * @brief Part of a job file between two line starts
+ */
+struct ByteRange
+{
+    uint64_t begin = 0; ///< Offset of the first line
+    uint64_t end = 0;   ///< Offset past the last line
+};
+
+/**
+ * @brief Splits a job file into parts of about equal size
+ * @param path Path to the job file
+ * @param count Number of parts
+ * @return count adjacent ranges covering the file, each boundary moved to the
+ *         next line start; parts of a short file may be empty
+ * @throw std::runtime_error if the file cannot be opened
+ *
+ * Only the bytes around the boundaries are read, jobs are not parsed.
+ */
+std::vector<ByteRange> splitJobs(const std::filesystem::path &path, size_t count);
+
+/**
+ * @brief Reads the jobs of a part of a job file
+ * @param path Path to the job file
+ * @param range Part to read, as returned by splitJobs()
+ * @return Jobs of the part in file order
+ * @throw std::runtime_error if the file cannot be opened
+ * @throw std::invalid_argument with the line number in the whole file if a line is invalid
+ */
+std::vector<cmdline_parser::Config> readJobs(const std::filesystem::path &path, const ByteRange &range);
+
+/**
+ * @brief Reads all jobs from a job file
+ * @param path Path to the job file
+ * @return Jobs in file order
+ * @throw std::runtime_error if the file cannot be opened
+ * @throw std::invalid_argument with line number if a line is invalid
+ */
+std::vector<cmdline_parser::Config> readJobs(const std::filesystem::path &path);
+
+/**
+ * @brief Writes one job line
+ * @param out Output stream
+ * @param job Job to write
+ *
+ * Numbers are written with full precision, so readJobs() restores them exactly.
+ */
+void writeJob(std::ostream &out, const cmdline_parser::Config &job);
+
+/**
+ * @brief Writes rectangles as a binary shape set
+ * @param out Binary output stream
+ * @param shapes Rectangles to write
+ */
+void writeShapeSet(std::ostream &out, const std::vector<geometry::Rectangle> &shapes);
+
+/**
+ * @brief Reads a binary shape set
+ * @param in Binary input stream
+ * @return Rectangles in file order
+ * @throw std::runtime_error if the data is not a valid shape set
+ */
+std::vector<geometry::Rectangle> readShapeSet(std::istream &in);
+
+} // namespace job_file
@@ -0,0 +1,198 @@
+/**
+ * @file job_queue.h
+ * @brief Queue of batch jobs with priority classes and deadlines
+ * @author Alsu Khabibulina
+ * @date 2025
+ *
+ * Jobs are taken by class first, INTERACTIVE before BATCH, and by earliest
+ * deadline within a class. Jobs without a deadline come after those with
+ * one, the larger first (LPT), then in submission order. A BATCH job that
+ * has waited for Policy::aging since its release is taken as INTERACTIVE
+ * with that moment as its deadline, and a running BATCH job is not
+ * preempted again once it has been paused for Policy::maxPaused, so a
+ * stream of interactive jobs delays an expensive job by a bounded time
+ * only. Aging only reorders the queue, an aged job never preempts and is
+ * never preempted.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <set>
+
+namespace job_queue
+{
+
+/**
+ * @enum Priority
+ * @brief Priority class of a job, in decreasing precedence
+ */
+enum Priority
+{
+    INTERACTIVE, ///< Previews and other requests someone waits for
+    BATCH        ///< Production fills, may be preempted by INTERACTIVE jobs
+};
+
+/// Number of priority classes
+constexpr size_t PRIORITIES = 2;
+
+/// Clock of release times and deadlines
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @struct Policy
+ * @brief Scheduling limits
+ */
+struct Policy
+{
+    std::array<unsigned, PRIORITIES> maxRunning{}; ///< Running jobs per class, 0 for no limit
+    std::chrono::milliseconds aging{1000};         ///< Wait after which a BATCH job counts as INTERACTIVE, 0 never
+    std::chrono::milliseconds maxPaused{1000};     ///< Pause after which a BATCH job isn't preempted, 0 no limit
+};
+
+/**
+ * @struct Ticket
+ * @brief Job taken from the queue
+ */
+struct Ticket
+{
+    size_t id;         ///< Identifier given to push()
+    Priority priority; ///< Class the job runs in, INTERACTIVE for an aged BATCH job
+};
+
+/**
+ * @class JobQueue
+ * @brief Thread-safe queue handing out jobs within the class limits
+ */
+class JobQueue
+{
+  public:
+    /**
+     * @brief Constructs an empty queue
+     * @param policy Class limits and aging
+     */
+    explicit JobQueue(const Policy &policy = {});
+
+    /**
+     * @brief Adds a job
+     * @param id Identifier returned in the ticket
+     * @param priority Class of the job
+     * @param work Size of the job, ranks jobs without a deadline
+     * @param deadline Time the job should be done by, if any
+     * @param release Time before which the job is not taken
+     */
+    void push(size_t id, Priority priority, size_t work, std::optional<Clock::time_point> deadline = {},
+              Clock::time_point release = {});
+
+    /**
+     * @brief Marks the end of the jobs, take() returns nothing once all are taken
+     */
+    void close();
+
+    /**
+     * @brief Takes the most urgent job that may run now, waiting if none may
+     * @return Ticket to pass to done(), empty once the queue is closed and drained
+     */
+    std::optional<Ticket> take();
+
+    /**
+     * @brief Takes a job that may preempt a running job, without waiting
+     * @param running Class the running job was taken in
+     * @param paused Time the running job has been preempted for so far
+     * @param fits Tells whether the job with a given identifier can run now, empty for any
+     * @return Ticket of the most urgent released job of a higher class with a free slot,
+     *         if there is one, it fits and the running job was paused for less than
+     *         Policy::maxPaused
+     *
+     * The preempted job keeps its slot while the returned one runs. Aged
+     * BATCH jobs are not returned, they wait for take().
+     */
+    std::optional<Ticket> preempt(Priority running, Clock::duration paused = {},
+                                  const std::function<bool(size_t)> &fits = {});
+
+    /**
+     * @brief Frees the slot of a finished job
+     * @param ticket Ticket returned by take() or preempt()
+     */
+    void done(const Ticket &ticket);
+
+  private:
+    /**
+     * @struct Entry
+     * @brief Waiting job
+     */
+    struct Entry
+    {
+        Clock::time_point deadline; ///< Deadline, time_point::max() if none
+        size_t work;                ///< Size of the job
+        uint64_t sequence;          ///< Submission order
+        size_t id;                  ///< Identifier of the job
+        Priority priority;          ///< Class of the job
+        Clock::time_point release;  ///< Time the job may be taken from
+
+        /**
+         * @brief Orders entries by urgency within a class
+         * @param other Entry to compare with
+         * @return true if this entry goes first
+         */
+        bool operator<(const Entry &other) const noexcept;
+    };
+
+    /**
+     * @struct ByRelease
+     * @brief Orders entries by release time, then by urgency
+     */
+    struct ByRelease
+    {
+        /**
+         * @brief Compares two entries
+         * @param l Left entry
+         * @param r Right entry
+         * @return true if l is released first
+         */
+        bool operator()(const Entry &l, const Entry &r) const noexcept;
+    };
+
+    Policy policy;                                 ///< Class limits and aging
+    std::mutex mutex;                              ///< Guards everything below
+    std::condition_variable changed;               ///< Signalled on push, close and done
+    std::set<Entry, ByRelease> pending;            ///< Jobs not released yet
+    std::array<std::set<Entry>, PRIORITIES> ready; ///< Released jobs by class
+    std::set<Entry, ByRelease> aging;              ///< Released BATCH jobs by release time
+    std::array<unsigned, PRIORITIES> running{};    ///< Running jobs per class
+    uint64_t submitted = 0;                        ///< Jobs pushed so far
+    bool closed = false;                           ///< No more jobs will be pushed
+
+    /**
+     * @brief Moves released jobs to the ready sets
+     * @param now Current time
+     */
+    void releaseDue(Clock::time_point now);
+
+    /**
+     * @brief Picks and removes the next job of a class
+     * @param priority Class to pick for
+     * @param now Current time
+     * @param aged Whether aged BATCH jobs compete for INTERACTIVE
+     * @param fits Tells whether the picked job can run now, empty for any
+     * @return Ticket, empty if the class has no job or no free slot, or the job doesn't fit
+     */
+    std::optional<Ticket> pick(Priority priority, Clock::time_point now, bool aged = true,
+                               const std::function<bool(size_t)> &fits = {});
+
+    /**
+     * @brief Returns the next time a waiting take() may succeed without a notification
+     * @param now Current time
+     * @return Earliest future release or aging time, time_point::max() if none
+     */
+    Clock::time_point nextEvent(Clock::time_point now) const;
+};
+
+} // namespace job_queue
@@ -0,0 +1,101 @@
+/**
+ * @file memory_budget.h
+ * @brief Memory prediction and budget enforcement for hatch jobs
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+#include "geometry.h"
+
+namespace memory_budget
+{
+
+/**
+ * @enum Policy
+ * @brief What to do with a job predicted to exceed the budget
+ */
+enum Policy
+{
+    STREAM, ///< Generate and write segments one by one in constant memory
+    FAIL,   ///< Refuse the job before generating anything
+    SPILL   ///< Generate into temporary files within the budget, write once complete
+};
+
+/**
+ * @struct Budget
+ * @brief Memory limit of a job
+ */
+struct Budget
+{
+    size_t maxBytes = 0;                  ///< Limit in bytes, 0 for unlimited
+    Policy policy = STREAM;               ///< Action when the limit would be exceeded
+    std::filesystem::path spillDirectory; ///< Temporary files of SPILL, empty for the system directory
+};
+
+/**
+ * @struct Estimate
+ * @brief Predicted memory of a buffered (non-streaming) job
+ */
+struct Estimate
+{
+    size_t lines;      ///< Hatch line count, see geometry::hatchLineCount()
+    size_t hatchBytes; ///< Hatch vector returned by geometry::generateHatch()
+    size_t svgBytes;   ///< Segment buffer of svg::SVGWriter, 0 without SVG output
+
+    /**
+     * @brief Returns predicted peak of the job
+     * @return Sum of all buffers, saturated at SIZE_MAX
+     */
+    size_t totalBytes() const noexcept;
+};
+
+/**
+ * @class BudgetExceeded
+ * @brief Thrown for a job over budget with the FAIL policy
+ */
+class BudgetExceeded : public std::runtime_error
+{
+  public:
+    /**
+     * @brief Constructs the error
+     * @param predicted Predicted bytes of the job
+     * @param budget Budget in bytes
+     */
+    BudgetExceeded(size_t predicted, size_t budget);
+};
+
+/**
+ * @brief Predicts memory of a job from the closed-form line count
+ * @param rect Rectangle to fill with hatch
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @param svg Whether the hatch is also drawn to an SVG file
+ * @return Prediction, O(1)
+ */
+Estimate estimate(const geometry::Rectangle &rect, double angle, double step, bool svg) noexcept;
+
+/**
+ * @brief Decides how to run a job under a budget
+ * @param e Prediction of the job
+ * @param budget Memory budget
+ * @return true if the job must be streamed, or spilled with the SPILL policy
+ * @throw BudgetExceeded if the job is over budget and the policy is FAIL
+ */
+bool mustStream(const Estimate &e, const Budget &budget);
+
+/**
+ * @brief Parses a byte size with an optional K, M or G suffix (powers of 1024)
+ * @param text Size text, e.g. "512M"
+ * @return Size in bytes
+ * @throw std::invalid_argument if the text is not a size
+ */
+size_t parseSize(const std::string &text);
+
+} // namespace memory_budget
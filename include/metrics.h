@@ -0,0 +1,242 @@
+/**
+ * @file metrics.h
+ * @brief Counters, gauges and histograms exposed in Prometheus text format
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace metrics
+{
+
+/// Cells of a counter or histogram, threads beyond this count share cells
+constexpr size_t SHARDS = 16;
+
+/**
+ * @class Counter
+ * @brief Monotonic counter with one cache line per thread
+ *
+ * Each thread adds to its own cell with a relaxed atomic add, so hot paths
+ * never contend; the cells are summed only when the value is read.
+ */
+class Counter
+{
+  public:
+    /**
+     * @brief Adds to the counter
+     * @param n Increment
+     */
+    void add(uint64_t n = 1) noexcept;
+
+    /**
+     * @brief Returns the counter value
+     * @return Sum of all cells
+     */
+    uint64_t value() const noexcept;
+
+  private:
+    /**
+     * @struct Cell
+     * @brief Counter part of one thread, alone in its cache line
+     */
+    struct alignas(64) Cell
+    {
+        std::atomic<uint64_t> value{0}; ///< Part of the counter
+    };
+
+    std::array<Cell, SHARDS> cells; ///< Per-thread parts
+};
+
+/**
+ * @class Gauge
+ * @brief Value that goes up and down, e.g. a queue depth
+ */
+class Gauge
+{
+  public:
+    /**
+     * @brief Sets the value
+     * @param v New value
+     */
+    void set(int64_t v) noexcept;
+
+    /**
+     * @brief Adds to the value
+     * @param n Increment, negative to decrease
+     */
+    void add(int64_t n) noexcept;
+
+    /**
+     * @brief Returns the value
+     * @return Current value
+     */
+    int64_t value() const noexcept;
+
+  private:
+    std::atomic<int64_t> current{0}; ///< Current value
+};
+
+/**
+ * @struct HistogramSnapshot
+ * @brief Aggregated state of a histogram
+ */
+struct HistogramSnapshot
+{
+    std::vector<double> bounds;   ///< Upper bounds of the buckets, without +Inf
+    std::vector<uint64_t> counts; ///< Cumulative counts per bucket, the last one is +Inf
+    double sum;                   ///< Sum of observed values
+};
+
+/**
+ * @class Histogram
+ * @brief Distribution over fixed buckets, sharded like Counter
+ */
+class Histogram
+{
+  public:
+    /**
+     * @brief Constructs a histogram
+     * @param bounds Bucket upper bounds, sorted ascending
+     * @throw std::invalid_argument if the bounds are not sorted
+     */
+    explicit Histogram(std::vector<double> bounds);
+
+    /**
+     * @brief Records a value
+     * @param v Observed value, e.g. seconds
+     */
+    void observe(double v) noexcept;
+
+    /**
+     * @brief Aggregates all cells
+     * @return Cumulative bucket counts and sum
+     */
+    HistogramSnapshot snapshot() const;
+
+  private:
+    /**
+     * @struct Cell
+     * @brief Histogram part of one thread
+     */
+    struct alignas(64) Cell
+    {
+        std::unique_ptr<std::atomic<uint64_t>[]> counts; ///< Non-cumulative count per bucket
+        std::atomic<double> sum{0};                      ///< Sum of observed values
+    };
+
+    std::vector<double> bounds;     ///< Bucket upper bounds
+    std::array<Cell, SHARDS> cells; ///< Per-thread parts
+};
+
+/**
+ * @class Registry
+ * @brief Named metrics written together in Prometheus text format
+ *
+ * Registration takes a lock and returns a reference that stays valid for
+ * the lifetime of the registry; updates through the reference take none.
+ */
+class Registry
+{
+  public:
+    /**
+     * @brief Returns a counter, registering it on first use
+     * @param name Metric name, should end with _total
+     * @param help Description
+     * @return Counter of this name
+     * @throw std::invalid_argument if the name is taken by another metric type
+     */
+    Counter &counter(const std::string &name, const std::string &help);
+
+    /**
+     * @brief Returns a gauge, registering it on first use
+     * @param name Metric name
+     * @param help Description
+     * @return Gauge of this name
+     * @throw std::invalid_argument if the name is taken by another metric type
+     */
+    Gauge &gauge(const std::string &name, const std::string &help);
+
+    /**
+     * @brief Returns a histogram, registering it on first use
+     * @param name Metric name
+     * @param help Description
+     * @param bounds Bucket upper bounds of a new histogram
+     * @return Histogram of this name
+     * @throw std::invalid_argument if the name is taken by another metric type
+     */
+    Histogram &histogram(const std::string &name, const std::string &help, std::vector<double> bounds);
+
+    /**
+     * @brief Writes all metrics in Prometheus text exposition format
+     * @param out Output stream
+     */
+    void write(std::ostream &out) const;
+
+  private:
+    /**
+     * @struct Family
+     * @brief One registered metric, exactly one pointer is set
+     */
+    struct Family
+    {
+        std::string name;                       ///< Metric name
+        std::string help;                       ///< Description
+        std::unique_ptr<Counter> counter{};     ///< Counter metric
+        std::unique_ptr<Gauge> gauge{};         ///< Gauge metric
+        std::unique_ptr<Histogram> histogram{}; ///< Histogram metric
+    };
+
+    mutable std::mutex mutex;     ///< Guards families
+    std::vector<Family> families; ///< Metrics in registration order
+
+    /**
+     * @brief Finds a family by name
+     * @param name Metric name
+     * @return Family or null
+     */
+    Family *find(const std::string &name);
+};
+
+/**
+ * @brief Returns the process-wide registry
+ * @return Registry the library reports to
+ */
+Registry &registry();
+
+/**
+ * @struct HatchMetrics
+ * @brief Metrics the library updates, registered in registry()
+ */
+struct HatchMetrics
+{
+    Counter &requests;       ///< Batch jobs and coalescer requests started
+    Counter &segments;       ///< Hatch segments generated
+    Counter &svgBytes;       ///< Bytes written by SVG writers
+    Counter &cacheHits;      ///< Result cache hits
+    Counter &cacheMisses;    ///< Result cache misses
+    Gauge &queueDepth;       ///< Batch jobs waiting for a worker
+    Histogram &jobSeconds;   ///< Duration of batch jobs
+    Gauge &formatQueueDepth; ///< Segment chunks waiting for the SVG formatting stage
+    Gauge &writeQueueDepth;  ///< Text chunks waiting for the file writing stage
+    Counter &formatStalls;   ///< Chunks the generation stage waited to hand over
+    Counter &writeStalls;    ///< Chunks the formatting stage waited to hand over
+};
+
+/**
+ * @brief Returns the library metrics
+ * @return Metrics, registered on the first call
+ */
+const HatchMetrics &hatchMetrics();
+
+} // namespace metrics
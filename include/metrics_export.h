@@ -0,0 +1,106 @@
+/**
+ * @file metrics_export.h
+ * @brief Serving metrics on a local socket and dumping them on a signal
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <csignal>
+#include <filesystem>
+#include <thread>
+
+#include "metrics.h"
+
+namespace metrics
+{
+
+/**
+ * @brief Writes metrics to a file atomically
+ * @param r Registry to write
+ * @param path Output file, replaced by rename so readers never see a partial file
+ * @throw std::runtime_error if the file cannot be written
+ */
+void dump(const Registry &r, const std::filesystem::path &path);
+
+/**
+ * @class SocketServer
+ * @brief Serves metrics over HTTP on a Unix domain socket
+ *
+ * Every connection gets one HTTP/1.0 response with the Prometheus text and
+ * is closed, whatever the request, so both a scraper and e.g.
+ * `curl --unix-socket <path> http://localhost/metrics` work. Connections are
+ * served one by one on a background thread.
+ */
+class SocketServer
+{
+  public:
+    /**
+     * @brief Starts serving
+     * @param r Registry to serve, must outlive the server
+     * @param path Socket path, an existing socket file is replaced
+     * @throw std::runtime_error if the socket cannot be created
+     */
+    SocketServer(const Registry &r, std::filesystem::path path);
+
+    /**
+     * @brief Stops serving and removes the socket file
+     */
+    ~SocketServer();
+
+    SocketServer(const SocketServer &) = delete;
+    SocketServer &operator=(const SocketServer &) = delete;
+
+  private:
+    const Registry &registry;   ///< Served registry
+    std::filesystem::path path; ///< Socket path
+    int listener = -1;          ///< Listening socket
+    std::jthread thread;        ///< Accept loop
+
+    /**
+     * @brief Accepts connections until a stop is requested
+     * @param stop Stop request of the thread
+     */
+    void serve(std::stop_token stop);
+};
+
+/**
+ * @class SignalDump
+ * @brief Dumps metrics to a file whenever the process receives a signal
+ *
+ * The handler only writes a byte to a pipe; a background thread reads it
+ * and writes the file. One instance may exist at a time, the previous
+ * handler is restored on destruction.
+ */
+class SignalDump
+{
+  public:
+    /**
+     * @brief Installs the signal handler
+     * @param r Registry to dump, must outlive the object
+     * @param path Output file
+     * @param signal Signal number
+     * @throw std::logic_error if another instance exists
+     * @throw std::runtime_error if the handler cannot be installed
+     */
+    SignalDump(const Registry &r, std::filesystem::path path, int signal = SIGUSR1);
+
+    /**
+     * @brief Restores the previous handler and stops the thread
+     */
+    ~SignalDump();
+
+    SignalDump(const SignalDump &) = delete;
+    SignalDump &operator=(const SignalDump &) = delete;
+
+  private:
+    const Registry &registry;   ///< Dumped registry
+    std::filesystem::path path; ///< Output file
+    int signal;                 ///< Handled signal
+    struct sigaction previous;  ///< Handler before installation
+    int pipeRead = -1;          ///< Read end of the wake-up pipe
+    std::jthread thread;        ///< Dump loop
+};
+
+} // namespace metrics
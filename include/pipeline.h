@@ -0,0 +1,307 @@
+/**
+ * @file pipeline.h
+ * @brief Staged SVG output with bounded queues between the stages
+ * @author Alsu Khabibulina
+ * @date 2025
+ *
+ * Streaming a hatch to SVG is split into three stages on their own
+ * threads: generation (the caller) fills chunks of segments, formatting
+ * turns each chunk into SVG text, writing puts the text into the file.
+ * Stages are connected by BoundedQueue: when a stage falls behind, the queue
+ * in front of it fills up and the stage before blocks, so a slow disk slows
+ * generation down instead of piling up memory. At most
+ * 2 * QUEUE_CHUNKS + 3 chunks exist at a time.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "geometry.h"
+#include "progress.h"
+#include "segment_buffer.h"
+#include "svg_writer.h"
+
+namespace pipeline
+{
+
+/// Chunks each queue holds
+constexpr size_t QUEUE_CHUNKS = 8;
+
+/**
+ * @class BoundedQueue
+ * @brief Single-producer/single-consumer queue of fixed capacity
+ * @tparam T Element type, moved in and out
+ *
+ * Head and tail are atomics on separate cache lines, so push() and pop()
+ * take no lock. A side that finds the queue full or empty sets its waiting
+ * flag and sleeps on the other side's sequence with std::atomic::wait; the
+ * other side only notifies when the flag is set.
+ */
+template <typename T>
+class BoundedQueue
+{
+  public:
+    /**
+     * @brief Constructs an empty queue
+     * @param capacity Maximal number of elements, rounded up to a power of two
+     */
+    explicit BoundedQueue(size_t capacity) : slots(std::bit_ceil(std::max<size_t>(capacity, 1)))
+    {
+    }
+
+    /**
+     * @brief Appends an element, waiting while the queue is full
+     * @param value Element to append
+     * @return false if the queue was aborted, the element is then dropped
+     */
+    bool push(T value)
+    {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == slots.size())
+        {
+            stalled.fetch_add(1, std::memory_order_relaxed);
+            while (!aborted.load(std::memory_order_acquire) &&
+                   h - tail.load(std::memory_order_acquire) == slots.size())
+            {
+                producerWaiting.store(1);
+                uint32_t sequence = spaceSequence.load();
+                if (!aborted.load() && h - tail.load(std::memory_order_acquire) == slots.size())
+                {
+                    spaceSequence.wait(sequence);
+                }
+                producerWaiting.store(0, std::memory_order_relaxed);
+            }
+        }
+        if (aborted.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        slots[h & (slots.size() - 1)] = std::move(value);
+        head.store(h + 1, std::memory_order_release);
+        notify(dataSequence, consumerWaiting);
+        return true;
+    }
+
+    /**
+     * @brief Removes the first element, waiting while the queue is empty
+     * @return Element, empty once the queue is closed and drained or aborted
+     */
+    std::optional<T> pop()
+    {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            if (aborted.load(std::memory_order_acquire))
+            {
+                return {};
+            }
+            // closed is read first: after seeing it, head is final
+            bool done = closed.load(std::memory_order_acquire);
+            if (head.load(std::memory_order_acquire) != t)
+            {
+                break;
+            }
+            if (done)
+            {
+                return {};
+            }
+            consumerWaiting.store(1);
+            uint32_t sequence = dataSequence.load();
+            if (head.load(std::memory_order_acquire) == t && !closed.load() && !aborted.load())
+            {
+                dataSequence.wait(sequence);
+            }
+            consumerWaiting.store(0, std::memory_order_relaxed);
+        }
+        T value = std::move(slots[t & (slots.size() - 1)]);
+        tail.store(t + 1, std::memory_order_release);
+        notify(spaceSequence, producerWaiting);
+        return value;
+    }
+
+    /**
+     * @brief Marks the end of the elements, called by the producer
+     */
+    void close()
+    {
+        closed.store(true, std::memory_order_release);
+        dataSequence.fetch_add(1);
+        dataSequence.notify_one();
+    }
+
+    /**
+     * @brief Stops both sides: push() fails and pop() returns nothing
+     */
+    void abort()
+    {
+        aborted.store(true, std::memory_order_release);
+        dataSequence.fetch_add(1);
+        dataSequence.notify_one();
+        spaceSequence.fetch_add(1);
+        spaceSequence.notify_one();
+    }
+
+    /**
+     * @brief Returns the number of queued elements
+     * @return Elements pushed and not popped yet
+     */
+    size_t size() const noexcept
+    {
+        return static_cast<size_t>(head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire));
+    }
+
+    /**
+     * @brief Returns how often the producer found the queue full
+     * @return Number of push() calls that had to wait
+     */
+    uint64_t stalls() const noexcept
+    {
+        return stalled.load(std::memory_order_relaxed);
+    }
+
+  private:
+    std::vector<T> slots;                          ///< Ring of elements
+    alignas(64) std::atomic<uint64_t> head{0};     ///< Elements pushed
+    std::atomic<uint32_t> dataSequence{0};         ///< Bumped after head moves, on close and abort
+    std::atomic<uint32_t> consumerWaiting{0};      ///< Consumer sleeps on dataSequence
+    std::atomic<uint64_t> stalled{0};              ///< Pushes that found the queue full
+    alignas(64) std::atomic<uint64_t> tail{0};     ///< Elements popped
+    std::atomic<uint32_t> spaceSequence{0};        ///< Bumped after tail moves and on abort
+    std::atomic<uint32_t> producerWaiting{0};      ///< Producer sleeps on spaceSequence
+    alignas(64) std::atomic<bool> closed{false};   ///< No more elements will be pushed
+    std::atomic<bool> aborted{false};              ///< Both sides stop
+
+    /**
+     * @brief Bumps a sequence and wakes its sleeper if there is one
+     * @param sequence Sequence of the other side
+     * @param waiting Waiting flag of the other side
+     *
+     * Both operations are sequentially consistent: either the sleeper sees
+     * the new sequence before sleeping or its flag is seen here.
+     */
+    static void notify(std::atomic<uint32_t> &sequence, const std::atomic<uint32_t> &waiting)
+    {
+        sequence.fetch_add(1);
+        if (waiting.load() != 0)
+        {
+            sequence.notify_one();
+        }
+    }
+};
+
+/**
+ * @struct Chunk
+ * @brief Segments handed from generation to formatting
+ */
+struct Chunk
+{
+    std::vector<geometry::SegmentView> segments; ///< Endpoints of segments in generation order
+    svg::LineFormat format = svg::HATCH;         ///< Format of all segments
+};
+
+/**
+ * @class SvgPipeline
+ * @brief Writes a streamed SVG file through formatting and writing threads
+ *
+ * The file is the same, byte for byte, as with svg::SVGWriter in streaming
+ * mode on the generating thread.
+ */
+class SvgPipeline
+{
+  public:
+    /**
+     * @brief Opens the file and starts the formatting and writing stages
+     * @param outFile Output SVG file
+     * @param bounds Bounds of everything drawn, see svg::SVGWriter::setBounds()
+     * @param chunkSegments Segments per chunk
+     * @param progress Receiver of progress of the formatting stage, may be null
+     * @throw std::runtime_error if the file cannot be opened
+     */
+    SvgPipeline(const std::filesystem::path &outFile, const svg::Bounds &bounds, size_t chunkSegments,
+                progress::Reporter *progress = nullptr);
+
+    /**
+     * @brief Completes the file with the hatch pushed so far if finish() was not called
+     */
+    ~SvgPipeline();
+
+    SvgPipeline(const SvgPipeline &) = delete;
+    SvgPipeline &operator=(const SvgPipeline &) = delete;
+
+    /**
+     * @brief Adds a hatch segment, handing the chunk over when it is full
+     * @param segment Segment to draw
+     * @throw std::runtime_error if a later stage failed
+     */
+    void push(const geometry::Segment &segment);
+
+    /**
+     * @brief Draws the contour, completes the file and waits for the stages
+     * @param contour Segments drawn with svg::CONTOUR after the hatch
+     * @throw std::runtime_error if a stage failed
+     */
+    void finish(std::span<const geometry::Segment> contour);
+
+  private:
+    std::filesystem::path path;           ///< Path of the output file
+    std::ofstream file;                   ///< Output file, used by the writing stage
+    svg::Bounds bounds;                   ///< Fixed bounds of the drawing
+    size_t chunkSegments;                 ///< Segments per chunk
+    progress::Reporter *progress;         ///< Receiver of progress, may be null
+    Chunk current;                        ///< Chunk being filled by generation
+    BoundedQueue<Chunk> formatQueue;      ///< Chunks waiting for formatting
+    BoundedQueue<std::string> writeQueue; ///< Text waiting for writing
+    std::mutex errorMutex;                ///< Guards error
+    std::exception_ptr error;             ///< First failure of a stage
+    std::jthread formatter;               ///< Formatting stage
+    std::jthread writer;                  ///< Writing stage
+
+    /**
+     * @brief Hands the current chunk to formatting
+     * @throw std::runtime_error if a later stage failed
+     */
+    void handOver();
+
+    /**
+     * @brief Hands the current chunk to formatting, if it has segments
+     * @return false if the stages were stopped by a failure
+     */
+    bool deliver();
+
+    /**
+     * @brief Records a stage failure and stops all stages
+     * @param failure Exception of the stage
+     */
+    void fail(std::exception_ptr failure);
+
+    /**
+     * @brief Throws the recorded failure, if any
+     */
+    void rethrow();
+
+    /**
+     * @brief Body of the formatting stage
+     */
+    void format();
+
+    /**
+     * @brief Body of the writing stage
+     */
+    void write();
+};
+
+} // namespace pipeline
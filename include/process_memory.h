@@ -0,0 +1,43 @@
+/**
+ * @file process_memory.h
+ * @brief Resident memory of the current process from /proc
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+
+namespace process_memory
+{
+
+/**
+ * @brief Returns current resident set size
+ * @return VmRSS in bytes, empty if /proc/self/status is unavailable
+ */
+std::optional<size_t> residentBytes();
+
+/**
+ * @brief Returns resident set high-water mark
+ * @return VmHWM in bytes, empty if /proc/self/status is unavailable
+ */
+std::optional<size_t> peakResidentBytes();
+
+/**
+ * @brief Returns resident set high-water mark of the largest child process
+ * @return Peak RSS in bytes of the largest terminated and waited-for child,
+ *         empty if unavailable
+ */
+std::optional<size_t> peakChildResidentBytes();
+
+/**
+ * @brief Resets the high-water mark to the current resident size
+ * @return true if the kernel accepted the reset (Linux 4.0+)
+ *
+ * Allows measuring the peak of a single phase of a long-running process.
+ */
+bool resetPeakResident();
+
+} // namespace process_memory
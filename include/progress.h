@@ -0,0 +1,108 @@
+/**
+ * @file progress.h
+ * @brief Throttled progress reporting of hatching and serialization
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+
+namespace progress
+{
+
+/**
+ * @struct Snapshot
+ * @brief Work done so far by everything reporting to one Reporter
+ */
+struct Snapshot
+{
+    size_t hatchedLines; ///< Hatch lines generated
+    size_t totalLines;   ///< Hatch lines expected, an upper bound of hatchedLines
+    size_t writtenLines; ///< Line elements written to SVG files
+    size_t writtenBytes; ///< Bytes written to SVG files
+};
+
+/**
+ * @brief Receives progress snapshots, must not block for long
+ */
+using Callback = std::function<void(const Snapshot &)>;
+
+/**
+ * @class Reporter
+ * @brief Accumulates progress and calls the callback at most once per interval
+ *
+ * Producers add their work in batches (generateHatch() every
+ * geometry::TIME_CHECK_INTERVAL lines), so the cost is an atomic add and a
+ * clock read per batch. Any number of threads may report: counters are
+ * atomic, one of them wins the interval and calls the callback, and calls
+ * are never concurrent. Code that takes a Reporter pointer does nothing
+ * when it is null.
+ */
+class Reporter
+{
+  public:
+    /**
+     * @brief Constructs a reporter
+     * @param callback Receiver of snapshots, exceptions it throws are ignored
+     * @param interval Minimal time between two callback calls
+     */
+    explicit Reporter(Callback callback, std::chrono::milliseconds interval = std::chrono::milliseconds(200));
+
+    /**
+     * @brief Adds lines to the expected total
+     * @param lines Number of hatch lines a job is going to generate
+     */
+    void expect(size_t lines) noexcept;
+
+    /**
+     * @brief Adds generated hatch lines
+     * @param lines Number of lines generated since the last call
+     */
+    void hatched(size_t lines) noexcept;
+
+    /**
+     * @brief Adds serialized output
+     * @param lines Number of line elements written since the last call
+     * @param bytes Number of bytes written since the last call
+     */
+    void written(size_t lines, size_t bytes) noexcept;
+
+    /**
+     * @brief Calls the callback now, regardless of the interval
+     */
+    void flush() noexcept;
+
+    /**
+     * @brief Returns current counters
+     * @return Snapshot of the counters
+     */
+    Snapshot snapshot() const noexcept;
+
+  private:
+    Callback callback;                                   ///< Receiver of snapshots
+    std::chrono::steady_clock::duration interval;        ///< Minimal time between calls
+    std::atomic<size_t> hatchedLines{0};                 ///< Hatch lines generated
+    std::atomic<size_t> totalLines{0};                   ///< Hatch lines expected
+    std::atomic<size_t> writtenLines{0};                 ///< Line elements written
+    std::atomic<size_t> writtenBytes{0};                 ///< Bytes written
+    std::atomic<std::chrono::steady_clock::rep> next{0}; ///< Earliest time of the next call
+    std::mutex callbackMutex;                            ///< Serializes callback calls
+
+    /**
+     * @brief Calls the callback if the interval has passed
+     */
+    void tick() noexcept;
+
+    /**
+     * @brief Calls the callback with a fresh snapshot
+     */
+    void report() noexcept;
+};
+
+} // namespace progress
@@ -0,0 +1,120 @@
+/**
+ * @file result_cache.h
+ * @brief Persistent content-addressed cache of job output files
+ * @author Alsu Khabibulina
+ * @date 2025
+ *
+ * An entry is named by the 64-bit FNV-1a hash of its key and consists of
+ * two files in the cache directory:
+ * @code
+ * <hash>.out   output file of the job, copied as is
+ * <hash>.meta  key text followed by a "segments <count>" line
+ * @endcode
+ * The key text is compared on every lookup, so a hash collision is a miss
+ * and never returns a wrong file.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+#include "cmdline_parser.h"
+
+namespace result_cache
+{
+
+/// Version of the key and entry layout, part of every key
+constexpr unsigned FORMAT_VERSION = 1;
+
+/**
+ * @brief Builds the cache key of a job
+ * @param job Job configuration
+ * @param format Output format and writer mode, e.g. "svg/buffered"
+ * @return Key text
+ *
+ * The key holds only what determines the output: the tool version, the
+ * format, the rectangle, angle and step written exactly (as hexadecimal
+ * floating point). Paths, threads, budgets and limits are left out, so the
+ * same hatch written to another file is a hit.
+ */
+std::string jobKey(const cmdline_parser::Config &job, const std::string &format);
+
+/**
+ * @class Cache
+ * @brief Output files of finished jobs keyed by jobKey()
+ *
+ * Entries are written to temporary files and renamed into place, output
+ * first, so readers never see a partial entry and any number of threads and
+ * processes may share a directory. Lookups refresh the entry time. The
+ * size of the directory is taken by a scan when the cache is opened and
+ * then counted up by stores; once the count is over the size limit, the
+ * directory is scanned again and the least recently used entries are
+ * removed until it fits. Stores of other processes are seen at the next
+ * scan only. Cache errors never fail a job: a broken entry is a miss and a
+ * failed store is dropped.
+ */
+class Cache
+{
+  public:
+    /**
+     * @brief Opens a cache directory, creating it if needed, and evicts down to the limit
+     * @param directory Cache directory
+     * @param maxBytes Size limit of all entries, 0 for unlimited
+     * @throw std::filesystem::filesystem_error if the directory cannot be created
+     */
+    explicit Cache(std::filesystem::path directory, size_t maxBytes = 0);
+
+    /**
+     * @brief Copies the output of a cached job
+     * @param key Job key
+     * @param out Destination output file, overwritten
+     * @return Number of hatch segments of the job, or nothing on a miss
+     *
+     * The copy is a reflink where the file system supports it.
+     */
+    std::optional<size_t> fetch(const std::string &key, const std::filesystem::path &out) const;
+
+    /**
+     * @brief Stores the output of a finished job
+     * @param key Job key
+     * @param file Output file of the job
+     * @param segments Number of hatch segments of the job
+     *
+     * Scans the directory only if the counted size gets over the limit.
+     */
+    void store(const std::string &key, const std::filesystem::path &file, size_t segments) const;
+
+    /**
+     * @brief Scans the directory and removes least recently used entries down to the size limit
+     *
+     * Also removes temporary files left by interrupted stores, and resets the
+     * counted size to what is left.
+     */
+    void evict() const;
+
+  private:
+    std::filesystem::path directory;          ///< Cache directory
+    size_t maxBytes;                          ///< Size limit, 0 for unlimited
+    mutable std::atomic<uintmax_t> counted{}; ///< Size at the last scan plus the stores since
+
+    /**
+     * @brief Returns path of an entry file
+     * @param key Job key
+     * @param extension ".out" or ".meta"
+     * @return Path in the cache directory
+     */
+    std::filesystem::path entryPath(const std::string &key, const char *extension) const;
+
+    /**
+     * @brief Returns a new unique temporary path in the cache directory
+     * @return Path of a file that does not exist yet
+     */
+    std::filesystem::path tempPath() const;
+};
+
+} // namespace result_cache
@@ -0,0 +1,127 @@
+/**
+ * @file segment_arena.h
+ * @brief Huge-page backed segment buffer for very large fills
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+#include "geometry.h"
+
+namespace geometry
+{
+
+/**
+ * @class SegmentArena
+ * @brief Append-only segment buffer in a reserved address range
+ *
+ * The constructor reserves address space for the maximal number of segments
+ * without committing memory. The buffer grows by committing 2 MiB chunks in
+ * place, so segments are never copied and pointers to them stay valid. On
+ * Linux the range is aligned to 2 MiB and advised for transparent huge
+ * pages, which cuts TLB misses when walking tens of millions of segments.
+ * Without mmap support the arena falls back to a single heap block.
+ */
+class SegmentArena
+{
+  public:
+    /// Commit granularity and huge page size in bytes
+    static constexpr size_t CHUNK_BYTES = size_t(2) << 20;
+
+    /**
+     * @brief Reserves address space
+     * @param maxSegments Maximal number of segments the arena can hold
+     * @throw std::bad_alloc if the address space cannot be reserved
+     */
+    explicit SegmentArena(size_t maxSegments);
+
+    /**
+     * @brief Releases the address range
+     */
+    ~SegmentArena();
+
+    SegmentArena(const SegmentArena &) = delete;
+    SegmentArena &operator=(const SegmentArena &) = delete;
+
+    /**
+     * @brief Appends a segment
+     * @param s Segment to append
+     * @throw std::length_error if the arena is full
+     * @throw std::bad_alloc if memory cannot be committed
+     */
+    void push_back(const Segment &s);
+
+    /**
+     * @brief Removes all segments, committed memory is kept for reuse
+     */
+    void clear() noexcept;
+
+    /**
+     * @brief Returns number of segments
+     * @return Segment count
+     */
+    size_t size() const noexcept;
+
+    /**
+     * @brief Returns maximal number of segments
+     * @return Capacity given to the constructor
+     */
+    size_t capacity() const noexcept;
+
+    /**
+     * @brief Returns committed memory
+     * @return Bytes backed by memory
+     */
+    size_t committedBytes() const noexcept;
+
+    /**
+     * @brief Checks if the kernel accepted the huge page advice
+     * @return true if the range is advised for transparent huge pages
+     */
+    bool hugePages() const noexcept;
+
+    /**
+     * @brief Returns stored segments
+     * @return View of the segments, valid until the arena is destroyed
+     */
+    std::span<const Segment> segments() const noexcept;
+
+  private:
+    std::byte *base = nullptr;  ///< Start of the usable range
+    void *mapping = nullptr;    ///< Start of the reservation, including alignment slack
+    size_t mappingBytes = 0;    ///< Size of the reservation
+    size_t reservedBytes = 0;   ///< Usable reserved bytes
+    size_t committed = 0;       ///< Committed bytes from base
+    size_t count = 0;           ///< Number of segments
+    size_t maxCount = 0;        ///< Capacity in segments
+    bool advised = false;       ///< Huge page advice accepted
+    bool heap = false;          ///< Fallback heap block instead of a mapping
+
+    /**
+     * @brief Commits memory for at least one more segment
+     */
+    void grow();
+};
+
+/**
+ * @brief Generates hatch lines directly into an arena
+ * @param rect Rectangle to fill with hatch
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @param out Arena to append segments to
+ * @param cancel Stop request and deadline of the caller
+ * @param limits Work budget
+ * @return COMPLETE, or why generation stopped early; out then holds the
+ *         segments generated so far
+ * @throw std::invalid_argument if parameters are invalid
+ * @throw HatchLimitExceeded if the work budget is exceeded
+ * @throw std::length_error before generation if the hatch may not fit
+ */
+RunStatus generateHatch(const Rectangle &rect, double angle, double step, SegmentArena &out,
+                        const Cancellation &cancel = {}, const HatchLimits &limits = {});
+
+} // namespace geometry
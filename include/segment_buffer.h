@@ -0,0 +1,412 @@
+/**
+ * @file segment_buffer.h
+ * @brief Structure-of-arrays container of segment endpoints
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <memory_resource>
+#include <span>
+
+#include "geometry.h"
+
+namespace geometry
+{
+
+/**
+ * @struct BoundingBox
+ * @brief Axis-aligned bounding box
+ */
+struct BoundingBox
+{
+    Point min; ///< Corner with minimal coordinates
+    Point max; ///< Corner with maximal coordinates
+};
+
+/**
+ * @struct SegmentView
+ * @brief Endpoints of one segment stored in a SegmentBuffer
+ */
+struct SegmentView
+{
+    Point a; ///< First endpoint
+    Point b; ///< Second endpoint
+
+    /**
+     * @brief Builds a full segment, including its line coefficients
+     * @return Segment between the endpoints
+     */
+    Segment toSegment() const noexcept
+    {
+        return Segment(a, b);
+    }
+};
+
+/**
+ * @class SegmentBuffer
+ * @brief Segments stored as four coordinate columns x1, y1, x2, y2
+ *
+ * Unlike std::vector<Segment>, the columns hold only endpoints (32 bytes per
+ * segment instead of 56) and are contiguous per coordinate, so bulk passes
+ * vectorize. Columns are ALIGNMENT-aligned and their capacity is a multiple
+ * of LANES: kernels may load whole SIMD vectors past size(), the values
+ * there are unspecified. Lanes are zeroed a LANES group at a time as the
+ * columns grow into them, so these loads never read uninitialized memory.
+ */
+class SegmentBuffer
+{
+  public:
+    /// Column alignment in bytes, the widest supported SIMD register
+    static constexpr size_t ALIGNMENT = 64;
+
+    /// Doubles per ALIGNMENT bytes, capacity is always a multiple of it
+    static constexpr size_t LANES = ALIGNMENT / sizeof(double);
+
+    /**
+     * @class const_iterator
+     * @brief Random access iterator yielding SegmentView values
+     */
+    class const_iterator
+    {
+      public:
+        using iterator_category = std::random_access_iterator_tag; ///< Iterator category
+        using value_type = SegmentView;                            ///< Value type
+        using difference_type = std::ptrdiff_t;                    ///< Distance type
+        using pointer = void;                                      ///< Views are returned by value
+        using reference = SegmentView;                             ///< Views are returned by value
+
+        const_iterator() = default;
+
+        /**
+         * @brief Constructs an iterator
+         * @param buffer Iterated buffer
+         * @param index Position in the buffer
+         */
+        const_iterator(const SegmentBuffer *buffer, size_t index) noexcept : buffer(buffer), index(index)
+        {
+        }
+
+        SegmentView operator*() const noexcept
+        {
+            return (*buffer)[index];
+        }
+
+        SegmentView operator[](difference_type n) const noexcept
+        {
+            return (*buffer)[index + n];
+        }
+
+        const_iterator &operator++() noexcept
+        {
+            ++index;
+            return *this;
+        }
+
+        const_iterator operator++(int) noexcept
+        {
+            return {buffer, index++};
+        }
+
+        const_iterator &operator--() noexcept
+        {
+            --index;
+            return *this;
+        }
+
+        const_iterator operator--(int) noexcept
+        {
+            return {buffer, index--};
+        }
+
+        const_iterator &operator+=(difference_type n) noexcept
+        {
+            index += n;
+            return *this;
+        }
+
+        const_iterator &operator-=(difference_type n) noexcept
+        {
+            index -= n;
+            return *this;
+        }
+
+        friend const_iterator operator+(const_iterator it, difference_type n) noexcept
+        {
+            return it += n;
+        }
+
+        friend const_iterator operator+(difference_type n, const_iterator it) noexcept
+        {
+            return it += n;
+        }
+
+        friend const_iterator operator-(const_iterator it, difference_type n) noexcept
+        {
+            return it -= n;
+        }
+
+        friend difference_type operator-(const const_iterator &l, const const_iterator &r) noexcept
+        {
+            return difference_type(l.index) - difference_type(r.index);
+        }
+
+        friend bool operator==(const const_iterator &l, const const_iterator &r) noexcept
+        {
+            return l.index == r.index;
+        }
+
+        friend auto operator<=>(const const_iterator &l, const const_iterator &r) noexcept
+        {
+            return l.index <=> r.index;
+        }
+
+      private:
+        const SegmentBuffer *buffer = nullptr; ///< Iterated buffer
+        size_t index = 0;                      ///< Position in the buffer
+    };
+
+    /**
+     * @brief Constructs an empty buffer
+     * @param mr Memory resource for the columns
+     */
+    explicit SegmentBuffer(std::pmr::memory_resource *mr = std::pmr::get_default_resource()) noexcept;
+
+    /**
+     * @brief Copies a buffer, the copy uses the same memory resource
+     * @param other Buffer to copy
+     */
+    SegmentBuffer(const SegmentBuffer &other);
+
+    /**
+     * @brief Moves a buffer
+     * @param other Buffer to move from, left empty
+     */
+    SegmentBuffer(SegmentBuffer &&other) noexcept;
+
+    /**
+     * @brief Copy assignment
+     * @param other Buffer to copy
+     * @return Reference to this buffer
+     */
+    SegmentBuffer &operator=(const SegmentBuffer &other);
+
+    /**
+     * @brief Move assignment
+     * @param other Buffer to move from
+     * @return Reference to this buffer
+     */
+    SegmentBuffer &operator=(SegmentBuffer &&other);
+
+    /**
+     * @brief Releases the columns
+     */
+    ~SegmentBuffer();
+
+    /**
+     * @brief Returns bytes held for a number of segments
+     * @param n Number of segments
+     * @return Size of the four padded columns
+     * @throw std::length_error if n is over max_size()
+     */
+    static size_t bytesFor(size_t n);
+
+    /**
+     * @brief Returns the largest capacity
+     * @return Segments whose padded columns still have a size_t size in bytes
+     */
+    static size_t max_size() noexcept;
+
+    /**
+     * @brief Ensures capacity for at least n segments
+     * @param n Number of segments
+     * @throw std::length_error if n is over max_size()
+     */
+    void reserve(size_t n);
+
+    /**
+     * @brief Appends a segment
+     * @param s Segment to append, its line coefficients are dropped
+     */
+    void push_back(const Segment &s);
+
+    /**
+     * @brief Appends segments
+     * @param segments Segments to append
+     */
+    void append(std::span<const Segment> segments);
+
+    /**
+     * @brief Appends all segments of another buffer
+     * @param other Buffer to append, column by column
+     */
+    void append(const SegmentBuffer &other);
+
+    /**
+     * @brief Removes all segments, capacity is kept
+     */
+    void clear() noexcept;
+
+    /**
+     * @brief Returns number of segments
+     * @return Segment count
+     */
+    size_t size() const noexcept;
+
+    /**
+     * @brief Checks if the buffer is empty
+     * @return true if there are no segments
+     */
+    bool empty() const noexcept;
+
+    /**
+     * @brief Returns capacity
+     * @return Segments that fit without reallocation, a multiple of LANES
+     */
+    size_t capacity() const noexcept;
+
+    /**
+     * @brief Returns segment endpoints
+     * @param i Segment index
+     * @return View of the segment
+     */
+    SegmentView operator[](size_t i) const noexcept
+    {
+        return {{x1Column[i], y1Column[i]}, {x2Column[i], y2Column[i]}};
+    }
+
+    /// @name Column access
+    /// @{
+    const double *x1() const noexcept
+    {
+        return x1Column;
+    }
+    const double *y1() const noexcept
+    {
+        return y1Column;
+    }
+    const double *x2() const noexcept
+    {
+        return x2Column;
+    }
+    const double *y2() const noexcept
+    {
+        return y2Column;
+    }
+    double *x1() noexcept
+    {
+        return x1Column;
+    }
+    double *y1() noexcept
+    {
+        return y1Column;
+    }
+    double *x2() noexcept
+    {
+        return x2Column;
+    }
+    double *y2() noexcept
+    {
+        return y2Column;
+    }
+    /// @}
+
+    const_iterator begin() const noexcept
+    {
+        return {this, 0};
+    }
+
+    const_iterator end() const noexcept
+    {
+        return {this, count};
+    }
+
+    /**
+     * @brief Applies translation then scale to all coordinates
+     * @param tx Added to X coordinates
+     * @param ty Added to Y coordinates
+     * @param sx X scale
+     * @param sy Y scale
+     * @param flipY Mirror Y coordinates before translation
+     *
+     * x' = (x + tx) * sx, y' = (y + ty) * sy, or (-y + ty) * sy with flipY.
+     * Runs as a cpu_dispatch kernel, split over hardware threads for large buffers.
+     */
+    void transform(double tx, double ty, double sx, double sy, bool flipY = false) noexcept;
+
+    /**
+     * @brief Computes bounding box of all endpoints
+     * @return Box, inverted (min > max) for an empty buffer
+     *
+     * Runs as a cpu_dispatch min/max reduction, split over hardware threads
+     * for large buffers. NaN coordinates are ignored, zero bounds are +0.
+     * @throw std::bad_alloc if the per-thread results can't be allocated
+     */
+    BoundingBox bbox() const;
+
+    /**
+     * @brief Keeps only segments matching a predicate, preserving order
+     * @param keep Predicate taking a SegmentView
+     */
+    template <typename Predicate> void filter(Predicate keep)
+    {
+        size_t out = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (keep((*this)[i]))
+            {
+                x1Column[out] = x1Column[i];
+                y1Column[out] = y1Column[i];
+                x2Column[out] = x2Column[i];
+                y2Column[out] = y2Column[i];
+                ++out;
+            }
+        }
+        count = out;
+    }
+
+  private:
+    std::pmr::memory_resource *resource; ///< Memory resource of the columns
+    double *x1Column = nullptr;          ///< First endpoint X, start of the column block
+    double *y1Column = nullptr;          ///< First endpoint Y
+    double *x2Column = nullptr;          ///< Second endpoint X
+    double *y2Column = nullptr;          ///< Second endpoint Y
+    size_t count = 0;                    ///< Number of segments
+    size_t cap = 0;                      ///< Capacity of each column
+
+    /**
+     * @brief Reallocates columns to a new capacity
+     * @param newCap New capacity, a multiple of LANES
+     */
+    void reallocate(size_t newCap);
+
+    /**
+     * @brief Zeroes a range of lanes in all four columns
+     * @param begin First lane
+     * @param end Lane past the last one, at most capacity()
+     */
+    void zeroLanes(size_t begin, size_t end) noexcept;
+};
+
+/**
+ * @brief Generates hatch lines directly into a SegmentBuffer
+ * @param rect Rectangle to fill with hatch
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @param out Buffer to append segments to
+ * @param cancel Stop request and deadline of the caller
+ * @param limits Work budget
+ * @return COMPLETE, or why generation stopped early; out then holds the
+ *         segments generated so far
+ * @throw std::invalid_argument if parameters are invalid
+ * @throw HatchLimitExceeded if the work budget is exceeded or the segments
+ *        don't fit in memory
+ */
+RunStatus generateHatch(const Rectangle &rect, double angle, double step, SegmentBuffer &out,
+                        const Cancellation &cancel = {}, const HatchLimits &limits = {});
+
+} // namespace geometry
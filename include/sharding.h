@@ -0,0 +1,61 @@
+/**
+ * @file sharding.h
+ * @brief Running shards of work in forked worker processes, POSIX only
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sharding
+{
+
+/**
+ * @struct ShardExit
+ * @brief How a worker process ended
+ */
+struct ShardExit
+{
+    int exitCode = 0; ///< Exit status of a worker that returned
+    int signal = 0;   ///< Signal that terminated the worker, 0 if it returned
+
+    /**
+     * @brief Checks if the worker returned 0
+     * @return true on success
+     */
+    bool ok() const noexcept
+    {
+        return signal == 0 && exitCode == 0;
+    }
+
+    /**
+     * @brief Describes a failure
+     * @return e.g. "worker terminated by signal 11", empty on success
+     */
+    std::string describe() const;
+};
+
+/**
+ * @brief Runs every shard in its own child process and waits for all
+ * @param count Number of shards
+ * @param worker Called in the child with the shard index, its result is
+ *        the exit status of the child
+ * @return Exit of each shard, in shard order
+ * @throw std::runtime_error if a process cannot be created; shards already
+ *        started are waited for first
+ *
+ * Children share nothing with each other after the fork: each has its own
+ * heap and allocator, and a crash ends only its own shard. Output streams
+ * are flushed before forking. A child leaves with _exit() after flushing
+ * std::cout and std::cerr, so exit handlers of the parent don't run twice.
+ * An exception escaping the worker is printed to stderr and gives status 1.
+ * Must be called while the process has a single thread.
+ */
+std::vector<ShardExit> forkShards(size_t count, const std::function<int(size_t shard)> &worker);
+
+} // namespace sharding
@@ -0,0 +1,197 @@
+/**
+ * @file shm_ring.h
+ * @brief Shared-memory single-producer/single-consumer ring of hatch segments
+ * @author Alsu Khabibulina
+ * @date 2025
+ *
+ * The ring is a POSIX shared memory object, so a consumer in another
+ * process on the same host reads the segments where the producer wrote
+ * them. Layout, in native byte order:
+ * @code
+ * offset 0     Header (see below), padded to HEADER_BYTES
+ * offset 4096  capacity records of 4 doubles: x1 y1 x2 y2
+ * @endcode
+ * Header fields, 64-bit unless noted:
+ * @code
+ * 0    magic "HATCHRNG"
+ * 8    uint32 version, uint32 record bytes (32)
+ * 16   capacity in records, a power of two
+ * 24   uint32 closed flag, uint32 geometry::RunStatus once closed
+ * 64   head: records published by the producer
+ * 72   uint32 data sequence (futex), uint32 consumer waiting flag
+ * 128  tail: records released by the consumer
+ * 136  uint32 space sequence (futex), uint32 producer waiting flag
+ * @endcode
+ * Record i lives in slot i % capacity. head and tail only grow, so
+ * head - tail records are readable. The producer writes records, then
+ * stores head with release order; the consumer loads head with acquire
+ * order, reads records in place and stores tail when done with them.
+ *
+ * A side that finds the ring full (producer) or empty (consumer) sets its
+ * waiting flag, reads the other side's sequence, checks again and sleeps
+ * on the sequence with FUTEX_WAIT. The other side bumps the sequence after
+ * moving its index and calls FUTEX_WAKE only if the flag is set, so no
+ * system call is made while both sides keep up. Without futexes (non-Linux)
+ * sleeping falls back to short naps.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include "geometry.h"
+#include "segment_buffer.h"
+
+namespace shm_ring
+{
+
+/// Magic bytes at the start of the header
+constexpr char MAGIC[8] = {'H', 'A', 'T', 'C', 'H', 'R', 'N', 'G'};
+
+/// Layout version
+constexpr uint32_t VERSION = 1;
+
+/// Bytes before the first record
+constexpr size_t HEADER_BYTES = 4096;
+
+/// Records written by the producer between two publications of head
+constexpr size_t PUBLISH_BATCH = 256;
+
+/**
+ * @struct Header
+ * @brief Shared control block at the start of the ring
+ */
+struct Header
+{
+    char magic[8];                                    ///< MAGIC
+    uint32_t version;                                 ///< VERSION
+    uint32_t recordBytes;                             ///< Bytes per record
+    uint64_t capacity;                                ///< Records in the ring, a power of two
+    std::atomic<uint32_t> closed;                     ///< Set once the producer is done
+    std::atomic<uint32_t> status;                     ///< geometry::RunStatus of the producer
+    alignas(64) std::atomic<uint64_t> head;           ///< Records published
+    std::atomic<uint32_t> dataSequence;               ///< Bumped after head moves or on close
+    std::atomic<uint32_t> consumerWaiting;            ///< Consumer sleeps on dataSequence
+    alignas(64) std::atomic<uint64_t> tail;           ///< Records released
+    std::atomic<uint32_t> spaceSequence;              ///< Bumped after tail moves
+    std::atomic<uint32_t> producerWaiting;            ///< Producer sleeps on spaceSequence
+};
+
+/**
+ * @class Producer
+ * @brief Creates a ring and publishes segments into it
+ */
+class Producer
+{
+  public:
+    /**
+     * @brief Creates the shared memory object, replacing a stale one
+     * @param name Object name, a leading '/' is added if missing
+     * @param capacity Records in the ring, rounded up to a power of two
+     * @param stallTimeout Longest wait for space before the consumer is considered gone
+     * @throw std::runtime_error if the object cannot be created
+     */
+    explicit Producer(const std::string &name, size_t capacity = size_t(1) << 16,
+                      std::chrono::milliseconds stallTimeout = std::chrono::seconds(10));
+
+    /**
+     * @brief Closes the ring as CANCELLED if close() was not called, unlinks the name
+     *
+     * A consumer that has attached keeps reading the remaining records.
+     */
+    ~Producer();
+
+    Producer(const Producer &) = delete;
+    Producer &operator=(const Producer &) = delete;
+
+    /**
+     * @brief Writes a segment, blocking while the ring is full
+     * @param s Segment to write, its line coefficients are dropped
+     * @throw std::runtime_error if the ring stays full for the stall timeout
+     */
+    void push(const geometry::Segment &s);
+
+    /**
+     * @brief Publishes all written segments
+     */
+    void flush() noexcept;
+
+    /**
+     * @brief Publishes all segments and marks the ring closed
+     * @param status How generation ended, passed to the consumer
+     */
+    void close(geometry::RunStatus status = geometry::COMPLETE) noexcept;
+
+  private:
+    std::string name;                  ///< Shared memory object name
+    Header *header = nullptr;          ///< Mapped header
+    geometry::SegmentView *records;    ///< Mapped records
+    size_t mappedBytes = 0;            ///< Size of the mapping
+    uint64_t written = 0;              ///< Records written, published or not
+    uint64_t published = 0;            ///< Records published
+    uint64_t freeUntil = 0;            ///< written may grow up to this without reading tail
+    std::chrono::milliseconds timeout; ///< Stall timeout
+
+    /**
+     * @brief Waits until at least one slot is free
+     */
+    void waitForSpace();
+};
+
+/**
+ * @class Consumer
+ * @brief Attaches to a ring and reads segments in place
+ */
+class Consumer
+{
+  public:
+    /**
+     * @brief Maps an existing ring
+     * @param name Object name, a leading '/' is added if missing
+     * @throw std::runtime_error if the object does not exist or is not a ring
+     */
+    explicit Consumer(const std::string &name);
+
+    /**
+     * @brief Unmaps the ring
+     */
+    ~Consumer();
+
+    Consumer(const Consumer &) = delete;
+    Consumer &operator=(const Consumer &) = delete;
+
+    /**
+     * @brief Waits for published segments
+     * @return Contiguous readable segments in the ring, empty once the ring
+     *         is closed and drained
+     *
+     * The span stays valid until release(). It may be shorter than what is
+     * available when the records wrap around the end of the ring.
+     */
+    std::span<const geometry::SegmentView> wait();
+
+    /**
+     * @brief Hands segments back to the producer
+     * @param n Number of segments from the start of the last wait() span
+     */
+    void release(size_t n) noexcept;
+
+    /**
+     * @brief Returns how the producer ended
+     * @return Status written by Producer::close(), COMPLETE while open
+     */
+    geometry::RunStatus status() const noexcept;
+
+  private:
+    Header *header = nullptr;       ///< Mapped header
+    geometry::SegmentView *records; ///< Mapped records
+    size_t mappedBytes = 0;         ///< Size of the mapping
+    uint64_t read = 0;              ///< Records released
+};
+
+} // namespace shm_ring
@@ -0,0 +1,158 @@
+/**
+ * @file spill_sink.h
+ * @brief Segment sink with a fixed memory ceiling that spills to disk
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+#include "geometry.h"
+#include "segment_buffer.h"
+
+namespace geometry
+{
+
+/**
+ * @brief Strict weak order of spilled segments, empty for generation order
+ */
+using SegmentOrder = std::function<bool(const SegmentView &, const SegmentView &)>;
+
+/**
+ * @class SpillSink
+ * @brief Collects any number of segments in bounded memory
+ *
+ * Segments are kept in memory up to half of the byte limit. When the memory
+ * part is full it is sorted and written to a temporary file as a chunk of
+ * raw endpoint records (RECORD_BYTES per segment, no line coefficients).
+ * merge() then reads all chunks back through a k-way merge, with the other
+ * half of the limit split between read blocks, so the peak stays at the
+ * limit however large the hatch is. Chunks beyond MERGE_FAN_IN are merged
+ * into larger ones first.
+ *
+ * Without an order no sorting happens: hatch lines come in generation order
+ * and the merge replays chunks one after another. With an order, segments
+ * that compare equal keep their generation order.
+ *
+ * Files are removed by the destructor.
+ */
+class SpillSink
+{
+  public:
+    /// Bytes of one spilled segment
+    static constexpr size_t RECORD_BYTES = sizeof(SegmentView);
+
+    /// Maximal number of chunks read at once by a merge
+    static constexpr size_t MERGE_FAN_IN = 16;
+
+    /**
+     * @brief Constructs an empty sink
+     * @param maxBytes Memory limit of buffers, rounded up to hold a few records
+     * @param directory Directory of temporary files, empty for the system one
+     * @param order Order of merged segments, empty for generation order
+     */
+    explicit SpillSink(size_t maxBytes, std::filesystem::path directory = {}, SegmentOrder order = {});
+
+    /**
+     * @brief Removes temporary files
+     */
+    ~SpillSink();
+
+    SpillSink(const SpillSink &) = delete;
+    SpillSink &operator=(const SpillSink &) = delete;
+
+    /**
+     * @brief Appends a segment, spilling the memory part when it is full
+     * @param s Segment to append, its line coefficients are dropped
+     * @throw std::runtime_error if a temporary file cannot be written
+     */
+    void push_back(const Segment &s);
+
+    /**
+     * @brief Passes all segments to a sink in merge order
+     * @param sink Consumer of the segments
+     * @throw std::runtime_error if a temporary file cannot be read or written
+     *
+     * May be called more than once, the segments are kept.
+     */
+    void merge(const SegmentSink &sink);
+
+    /**
+     * @brief Returns number of segments
+     * @return Segments appended so far
+     */
+    size_t size() const noexcept;
+
+    /**
+     * @brief Returns number of temporary files
+     * @return Chunks on disk
+     */
+    size_t spilledChunks() const noexcept;
+
+    /**
+     * @brief Returns bytes spilled to disk
+     * @return Size of all chunks
+     */
+    size_t spilledBytes() const noexcept;
+
+  private:
+    std::filesystem::path directory;           ///< Directory of temporary files
+    SegmentOrder order;                        ///< Merge order, empty for generation order
+    size_t capacity;                           ///< Segments kept in memory
+    size_t readBytes;                          ///< Bytes of all read blocks of a merge
+    std::vector<SegmentView> memory;           ///< Segments not spilled yet
+    std::vector<std::filesystem::path> chunks; ///< Chunk files in generation order
+    size_t count = 0;                          ///< Segments appended so far
+
+    /**
+     * @brief Sorts the memory part and writes it as a new chunk
+     */
+    void spill();
+
+    /**
+     * @brief Merges consecutive chunks until at most MERGE_FAN_IN are left
+     */
+    void reduceChunks();
+
+    /**
+     * @brief Merges chunks and, optionally, the memory part into a sink
+     * @param first Index of the first chunk
+     * @param last Index past the last chunk
+     * @param withMemory Whether the memory part is the last source
+     * @param sink Consumer of the merged segments
+     */
+    void mergeChunks(size_t first, size_t last, bool withMemory,
+                     const std::function<void(const SegmentView &)> &sink) const;
+
+    /**
+     * @brief Returns a new unique path in the spill directory
+     * @return Path of a file that does not exist yet
+     */
+    std::filesystem::path newChunkPath() const;
+};
+
+/**
+ * @brief Generates hatch lines into a spill sink
+ * @param rect Rectangle to fill with hatch
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @param out Sink to append segments to
+ * @param limits Work budget of the call
+ * @param cancel Stop request and deadline of the caller
+ * @param progress Receiver of generated lines, may be null
+ * @return COMPLETE, or why generation stopped early; out then holds the
+ *         segments generated so far
+ * @throw std::invalid_argument if parameters are invalid
+ * @throw HatchLimitExceeded if the work budget is exceeded
+ * @throw std::runtime_error if a temporary file cannot be written
+ */
+RunStatus generateHatch(const Rectangle &rect, double angle, double step, SpillSink &out,
+                        const HatchLimits &limits = {}, const Cancellation &cancel = {},
+                        progress::Reporter *progress = nullptr);
+
+} // namespace geometry
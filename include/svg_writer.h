@@ -9,10 +9,16 @@
 
 #include <filesystem>
 #include <fstream>
+#include <memory_resource>
+#include <optional>
+#include <ostream>
+#include <span>
 #include <unordered_map>
 #include <vector>
 
 #include "geometry.h"
+#include "progress.h"
+#include "segment_buffer.h"
 
 namespace svg
 {
@@ -27,6 +33,25 @@ enum LineFormat
     HATCH    ///< Hatch lines (thinner, for filling)
 };
 
+/**
+ * @struct Bounds
+ * @brief Axis-aligned bounding box of the drawing in model coordinates
+ */
+struct Bounds
+{
+    double minX; ///< Minimal X coordinate
+    double minY; ///< Minimal Y coordinate
+    double maxX; ///< Maximal X coordinate
+    double maxY; ///< Maximal Y coordinate
+};
+
+/**
+ * @brief Computes bounding box of a rectangle
+ * @param rect Rectangle
+ * @return Bounds containing all corners, and thus the rectangle hatch
+ */
+Bounds boundsOf(const geometry::Rectangle &rect) noexcept;
+
 /**
  * @class SVGWriter
  * @brief Generates SVG files from geometric segments
@@ -34,6 +59,11 @@ enum LineFormat
  * This class creates SVG images containing geometric segments with
  * different formatting options. It handles coordinate scaling and
  * applies different visual styles based on line format.
+ *
+ * By default segments are buffered until destruction, because scaling needs
+ * the bounding box of the whole drawing. If the bounds are known in advance
+ * (e.g. the hatched rectangle), setBounds() switches the writer to streaming:
+ * segments are written as soon as they are drawn and nothing is buffered.
  */
 class SVGWriter
 {
@@ -43,8 +73,20 @@ class SVGWriter
      * @param outFile Path to the output SVG file
      * @param w Width of the SVG canvas in pixels
      * @param h Height of the SVG canvas in pixels
+     * @param mr Memory resource for buffered segments
+     */
+    SVGWriter(const std::filesystem::path &outFile, double w, double h,
+              std::pmr::memory_resource *mr = std::pmr::get_default_resource());
+
+    /**
+     * @brief Constructs an SVG writer on an existing stream
+     * @param out Output stream, must outlive the writer
+     * @param w Width of the SVG canvas in pixels
+     * @param h Height of the SVG canvas in pixels
+     * @param mr Memory resource for buffered segments
      */
-    SVGWriter(const std::filesystem::path &outFile, double w, double h);
+    SVGWriter(std::ostream &out, double w, double h,
+              std::pmr::memory_resource *mr = std::pmr::get_default_resource());
 
     /**
      * @brief Destructor - completes SVG file and closes it
@@ -53,24 +95,110 @@ class SVGWriter
 
     /**
      * @brief Adds segments to be drawn with specified format
-     * @param segments Vector of segments to draw
+     * @param segments Segments to draw
      * @param lf Line format to apply to these segments
      */
-    void drawSegments(std::vector<geometry::Segment> segments, LineFormat lf) noexcept;
+    void drawSegments(std::span<const geometry::Segment> segments, LineFormat lf) noexcept;
+
+    /**
+     * @brief Adds one segment to be drawn with specified format
+     * @param segment Segment to draw
+     * @param lf Line format to apply to the segment
+     */
+    void drawSegment(const geometry::Segment &segment, LineFormat lf) noexcept;
+
+    /**
+     * @brief Adds segments stored as coordinate columns
+     * @param segments Segments to draw, appended column by column
+     * @param lf Line format to apply to these segments
+     */
+    void drawSegments(const geometry::SegmentBuffer &segments, LineFormat lf) noexcept;
+
+    /**
+     * @brief Fixes the drawing bounds and switches to streaming output
+     * @param b Bounds of everything drawn afterwards
+     *
+     * Must be called before any segment is drawn. Segments outside the
+     * bounds are written as is and fall outside the canvas.
+     */
+    void setBounds(const Bounds &b) noexcept;
+
+    /**
+     * @brief Returns memory held by buffered segments
+     * @return Capacity of segment buffers in bytes, 0 in streaming mode
+     */
+    size_t bufferedBytes() const noexcept;
+
+    /**
+     * @brief Reports written lines and bytes from now on
+     * @param progress Receiver of progress, null to stop reporting
+     *
+     * Reports every geometry::TIME_CHECK_INTERVAL lines and at destruction.
+     * Bytes are taken from the stream position, so they are not counted on
+     * streams without one.
+     */
+    void setProgress(progress::Reporter *progress) noexcept;
+
+    /**
+     * @brief Renders all buffered segments now instead of at destruction
+     * @param cancel Stop request and deadline, checked every TIME_CHECK_INTERVAL lines
+     * @return COMPLETE, or why rendering stopped early
+     *
+     * Calculates bounding box, applies scaling, and writes SVG line elements
+     * with appropriate formatting based on line type. If stopped, the file
+     * holds the lines written so far and the rest of the buffer is dropped.
+     * Afterwards the writer is in streaming mode. Does nothing in streaming mode.
+     */
+    geometry::RunStatus draw(const geometry::Cancellation &cancel = {});
 
   private:
-    std::ofstream outFile;                                                         ///< Output file stream
-    std::unordered_map<LineFormat, std::vector<geometry::Segment>> formatSegments; ///< Segments grouped by format
+    std::ofstream ownedFile;                                                       ///< File opened by path constructor
+    std::ostream &outFile;                                                         ///< Output stream
+    std::pmr::memory_resource *resource;                                           ///< Memory resource of buffers
+    std::pmr::unordered_map<LineFormat, geometry::SegmentBuffer> formatSegments;   ///< Segments grouped by format
     double width;                                                                  ///< SVG canvas width
     double height;                                                                 ///< SVG canvas height
+    std::optional<Bounds> bounds;                                                  ///< Fixed bounds in streaming mode
+    double scale = 1;                                                              ///< Model to canvas scale
+    progress::Reporter *reporter = nullptr;                                        ///< Receiver of progress
+    size_t unreportedLines = 0;                                                    ///< Lines written since last report
+    std::streamoff reportedBytes = 0;                                              ///< Stream position of last report
+    std::streamoff startPosition = 0;                                              ///< Stream position before the header
 
     /**
-     * @brief Renders all segments to the SVG file
-     *
-     * Calculates bounding box, applies scaling, and writes SVG line elements
-     * with appropriate formatting based on line type.
+     * @brief Computes scale for given bounds
+     * @param b Drawing bounds
+     */
+    void fitTo(const Bounds &b) noexcept;
+
+    /**
+     * @brief Writes one SVG line element using current bounds and scale
+     * @param segment Segment to write
+     * @param lf Line format of the segment
+     */
+    void writeSegment(const geometry::Segment &segment, LineFormat lf);
+
+    /**
+     * @brief Writes one SVG line element in canvas coordinates
+     * @param ax First endpoint X
+     * @param ay First endpoint Y
+     * @param bx Second endpoint X
+     * @param by Second endpoint Y
+     * @param lf Line format of the segment
+     */
+    void writeLine(double ax, double ay, double bx, double by, LineFormat lf);
+
+    /**
+     * @brief Passes lines and bytes written since the last report to the reporter
+     */
+    void reportWritten() noexcept;
+
+    /**
+     * @brief Returns buffer of a line format, creating it on first use
+     * @param lf Line format
+     * @return Segment buffer using the writer memory resource
      */
-    void draw();
+    geometry::SegmentBuffer &bufferOf(LineFormat lf);
 };
 
 } // namespace svg
\ No newline at end of file
@@ -0,0 +1,333 @@
+/**
+ * @file alloc_tracker.cpp
+ * @brief Counting replacements of global operator new/delete
+ * @author Alsu Khabibulina
+ * @date 2025
+ *
+ * Compiled only when HATCH_ALLOC_TRACKING is enabled. Sizes are taken from
+ * malloc_usable_size(), so frees are accounted without a side table.
+ */
+
+#include "alloc_tracker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+#include <new>
+#include <vector>
+
+namespace
+{
+
+/// Maximum number of distinct call site tags
+constexpr size_t MAX_TAGS = 128;
+
+/// Slot used for allocations made outside of any guard
+constexpr size_t UNTAGGED_SLOT = 0;
+
+/**
+ * @struct TagSlot
+ * @brief Hot spot counters for one call site tag
+ */
+struct TagSlot
+{
+    std::atomic<const char *> tag{nullptr}; ///< Tag name, nullptr if slot is free
+    std::atomic<size_t> calls{0};           ///< Allocations charged to the tag
+    std::atomic<size_t> bytes{0};           ///< Bytes charged to the tag
+};
+
+std::atomic<size_t> globalCalls{0};
+std::atomic<size_t> globalFrees{0};
+std::atomic<size_t> globalBytes{0};
+std::atomic<long long> globalLive{0};
+std::atomic<long long> globalPeak{0};
+
+TagSlot tagSlots[MAX_TAGS];
+
+/// Innermost guard of the current thread
+thread_local alloc_tracker::AllocationGuard *currentGuard = nullptr;
+
+/**
+ * @brief Finds or registers the slot of a tag
+ * @param tag Call site tag
+ * @return Slot index, UNTAGGED_SLOT if the table is full
+ */
+size_t slotOf(const char *tag) noexcept
+{
+    for (size_t i = 1; i < MAX_TAGS; ++i)
+    {
+        const char *current = tagSlots[i].tag.load(std::memory_order_acquire);
+        if (current == nullptr)
+        {
+            // Try to claim the free slot; another thread may win with the same tag
+            if (tagSlots[i].tag.compare_exchange_strong(current, tag, std::memory_order_acq_rel))
+            {
+                return i;
+            }
+        }
+        if (current == tag || std::strcmp(current, tag) == 0)
+        {
+            return i;
+        }
+    }
+    return UNTAGGED_SLOT;
+}
+
+/**
+ * @brief Accounts an allocation of given usable size
+ * @param size Usable size of the block
+ */
+void onAllocate(size_t size) noexcept
+{
+    globalCalls.fetch_add(1, std::memory_order_relaxed);
+    globalBytes.fetch_add(size, std::memory_order_relaxed);
+    long long live = globalLive.fetch_add(size, std::memory_order_relaxed) + size;
+    long long peak = globalPeak.load(std::memory_order_relaxed);
+    while (peak < live && !globalPeak.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+    {
+    }
+
+    size_t slot = currentGuard ? currentGuard->slot : UNTAGGED_SLOT;
+    tagSlots[slot].calls.fetch_add(1, std::memory_order_relaxed);
+    tagSlots[slot].bytes.fetch_add(size, std::memory_order_relaxed);
+
+    for (auto *guard = currentGuard; guard != nullptr; guard = guard->outer)
+    {
+        guard->onAllocate(size);
+    }
+}
+
+/**
+ * @brief Accounts a deallocation of given usable size
+ * @param size Usable size of the block
+ */
+void onFree(size_t size) noexcept
+{
+    globalFrees.fetch_add(1, std::memory_order_relaxed);
+    globalLive.fetch_sub(size, std::memory_order_relaxed);
+
+    for (auto *guard = currentGuard; guard != nullptr; guard = guard->outer)
+    {
+        guard->onFree(size);
+    }
+}
+
+/**
+ * @brief Allocates and accounts a block
+ * @param size Requested size
+ * @param align Requested alignment, 0 for malloc default
+ * @return Pointer to the block or nullptr
+ */
+void *trackedAlloc(size_t size, size_t align) noexcept
+{
+    void *p = nullptr;
+    if (align <= alignof(std::max_align_t))
+    {
+        p = std::malloc(size ? size : 1);
+    }
+    else if (posix_memalign(&p, align, size ? size : 1) != 0)
+    {
+        p = nullptr;
+    }
+    if (p != nullptr)
+    {
+        onAllocate(malloc_usable_size(p));
+    }
+    return p;
+}
+
+/**
+ * @brief Allocates a block or throws std::bad_alloc
+ * @param size Requested size
+ * @param align Requested alignment, 0 for malloc default
+ * @return Pointer to the block
+ */
+void *trackedAllocOrThrow(size_t size, size_t align)
+{
+    void *p = trackedAlloc(size, align);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+/**
+ * @brief Accounts and frees a block
+ * @param p Block returned by trackedAlloc, may be nullptr
+ */
+void trackedFree(void *p) noexcept
+{
+    if (p != nullptr)
+    {
+        onFree(malloc_usable_size(p));
+        std::free(p);
+    }
+}
+
+} // namespace
+
+namespace alloc_tracker
+{
+
+AllocationGuard::AllocationGuard(const char *tag, GuardMode mode) noexcept
+    : outer(currentGuard), tag(tag), mode(mode), slot(slotOf(tag))
+{
+    currentGuard = this;
+}
+
+AllocationGuard::~AllocationGuard()
+{
+    currentGuard = outer;
+}
+
+Stats AllocationGuard::stats() const noexcept
+{
+    return counters;
+}
+
+void AllocationGuard::onAllocate(size_t size) noexcept
+{
+    if (mode == FORBID)
+    {
+        // stderr is unbuffered, fprintf does not allocate here
+        std::fprintf(stderr, "alloc_tracker: %zu-byte allocation inside zero-allocation scope '%s'\n", size, tag);
+        std::abort();
+    }
+    counters.calls++;
+    counters.bytes += size;
+    counters.live += size;
+    counters.peak = std::max(counters.peak, counters.live);
+}
+
+void AllocationGuard::onFree(size_t size) noexcept
+{
+    counters.frees++;
+    counters.live -= size;
+}
+
+Stats globalStats() noexcept
+{
+    return {.calls = globalCalls.load(std::memory_order_relaxed),
+            .frees = globalFrees.load(std::memory_order_relaxed),
+            .bytes = globalBytes.load(std::memory_order_relaxed),
+            .live = globalLive.load(std::memory_order_relaxed),
+            .peak = globalPeak.load(std::memory_order_relaxed)};
+}
+
+void report(std::ostream &out)
+{
+    struct Row
+    {
+        const char *tag;
+        size_t calls;
+        size_t bytes;
+    };
+
+    // Take a snapshot before allocating the rows themselves
+    Stats total = globalStats();
+    std::vector<Row> rows;
+    rows.reserve(MAX_TAGS);
+    for (size_t i = 0; i < MAX_TAGS; ++i)
+    {
+        const char *tag = i == UNTAGGED_SLOT ? "<untagged>" : tagSlots[i].tag.load(std::memory_order_acquire);
+        size_t calls = tagSlots[i].calls.load(std::memory_order_relaxed);
+        if (tag != nullptr && calls != 0)
+        {
+            rows.push_back({tag, calls, tagSlots[i].bytes.load(std::memory_order_relaxed)});
+        }
+    }
+    std::sort(rows.begin(), rows.end(), [](const Row &l, const Row &r) { return l.bytes > r.bytes; });
+
+    out << "Allocations: " << total.calls << " calls, " << total.frees << " frees, " << total.bytes
+        << " bytes, peak " << total.peak << " bytes\n";
+    for (const auto &row : rows)
+    {
+        out << "  " << row.tag << ": " << row.calls << " calls, " << row.bytes << " bytes\n";
+    }
+}
+
+} // namespace alloc_tracker
+
+void *operator new(size_t size)
+{
+    return trackedAllocOrThrow(size, 0);
+}
+
+void *operator new[](size_t size)
+{
+    return trackedAllocOrThrow(size, 0);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return trackedAlloc(size, 0);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return trackedAlloc(size, 0);
+}
+
+void *operator new(size_t size, std::align_val_t align)
+{
+    return trackedAllocOrThrow(size, static_cast<size_t>(align));
+}
+
+void *operator new[](size_t size, std::align_val_t align)
+{
+    return trackedAllocOrThrow(size, static_cast<size_t>(align));
+}
+
+void *operator new(size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    return trackedAlloc(size, static_cast<size_t>(align));
+}
+
+void *operator new[](size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    return trackedAlloc(size, static_cast<size_t>(align));
+}
+
+void operator delete(void *p) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete[](void *p, size_t, std::align_val_t) noexcept
+{
+    trackedFree(p);
+}
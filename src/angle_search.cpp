@@ -0,0 +1,191 @@
+/**
+ * @file angle_search.cpp
+ * @brief Implementation of the hatch angle search
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "angle_search.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+
+/// Period of the width function in degrees
+constexpr double HALF_TURN = 180.0;
+
+/**
+ * @brief Returns the unit normal of hatch lines
+ * @param angle Hatch angle in degrees
+ * @return Normal as used by geometry::generateHatch()
+ */
+geometry::Vector hatchNormal(double angle) noexcept
+{
+    double rad = angle * M_PI / 180.0;
+    return geometry::Vector(std::sin(rad), std::cos(rad));
+}
+
+/**
+ * @brief Returns the hatch angle parallel to a direction
+ * @param v Direction
+ * @return Angle in degrees in [0, 180)
+ */
+double parallelAngle(const geometry::Vector &v) noexcept
+{
+    // Hatch lines run along (cos, -sin) of the angle
+    double angle = std::atan2(-v.y, v.x) * 180.0 / M_PI;
+    angle = std::fmod(angle, HALF_TURN);
+    if (angle < 0)
+    {
+        angle += HALF_TURN;
+    }
+    return angle < HALF_TURN ? angle : 0.0;
+}
+
+} // namespace
+
+namespace angle_search
+{
+
+std::vector<geometry::Point> convexHull(std::vector<geometry::Point> points)
+{
+    std::sort(points.begin(), points.end(), [](const geometry::Point &l, const geometry::Point &r) {
+        return l.y < r.y || (l.y == r.y && l.x < r.x);
+    });
+    points.erase(std::unique(points.begin(), points.end(),
+                             [](const geometry::Point &l, const geometry::Point &r) {
+                                 return l.x == r.x && l.y == r.y;
+                             }),
+                 points.end());
+    if (points.size() < 3)
+    {
+        return points;
+    }
+
+    // Lower chain left to right, then upper chain back
+    std::vector<geometry::Point> hull;
+    hull.reserve(points.size() + 1);
+    auto turnsLeft = [&hull](const geometry::Point &p) {
+        const auto &a = hull[hull.size() - 2];
+        const auto &b = hull.back();
+        return geometry::crossProduct(geometry::Vector(a, b), geometry::Vector(b, p)) > 0;
+    };
+    for (const auto &p : points)
+    {
+        while (hull.size() >= 2 && !turnsLeft(p))
+        {
+            hull.pop_back();
+        }
+        hull.push_back(p);
+    }
+    size_t lower = hull.size();
+    for (size_t i = points.size() - 1; i-- > 0;)
+    {
+        while (hull.size() > lower && !turnsLeft(points[i]))
+        {
+            hull.pop_back();
+        }
+        hull.push_back(points[i]);
+    }
+    // The first point closed the chain
+    hull.pop_back();
+    return hull;
+}
+
+double width(std::span<const geometry::Point> hull, double angle) noexcept
+{
+    if (hull.empty())
+    {
+        return 0;
+    }
+    // Projections relative to the first vertex, as in geometry::hatchLineCount()
+    geometry::Vector normal = hatchNormal(angle);
+    double lo = 0, hi = 0;
+    for (const auto &p : hull)
+    {
+        double proj = geometry::dotProduct(geometry::Vector(hull.front(), p), normal);
+        lo = std::min(lo, proj);
+        hi = std::max(hi, proj);
+    }
+    return hi - lo;
+}
+
+std::vector<WidthBreak> widthBreaks(std::span<const geometry::Point> hull)
+{
+    std::vector<WidthBreak> breaks;
+    size_t n = hull.size();
+    if (n < 2)
+    {
+        return breaks;
+    }
+    if (n == 2)
+    {
+        // A segment has zero width along itself
+        breaks.push_back({parallelAngle(geometry::Vector(hull[0], hull[1])), 0});
+        return breaks;
+    }
+
+    breaks.reserve(n);
+    // Twice the triangle area of an edge and a vertex, i.e. height times edge length
+    auto area = [&](size_t edge, size_t vertex) {
+        return geometry::crossProduct(geometry::Vector(hull[edge], hull[(edge + 1) % n]),
+                                      geometry::Vector(hull[edge], hull[vertex % n]));
+    };
+    size_t far = 1;
+    for (size_t edge = 0; edge < n; edge++)
+    {
+        // The farthest vertex advances monotonically with the edge
+        far = std::max(far, edge + 1);
+        while (area(edge, far + 1) >= area(edge, far) && far + 1 < edge + n)
+        {
+            far++;
+        }
+        geometry::Vector e(hull[edge], hull[(edge + 1) % n]);
+        double length = std::sqrt(geometry::dotProduct(e, e));
+        breaks.push_back({parallelAngle(e), area(edge, far) / length});
+    }
+    std::sort(breaks.begin(), breaks.end(),
+              [](const WidthBreak &l, const WidthBreak &r) { return l.angle < r.angle; });
+    return breaks;
+}
+
+BestAngle bestAngle(const geometry::Rectangle &rect, double step, double minAngle, double maxAngle)
+{
+    geometry::validateHatch(rect, minAngle, step);
+    if (!std::isfinite(maxAngle) || maxAngle < minAngle)
+    {
+        throw std::invalid_argument("Angle range must be finite and not empty");
+    }
+
+    auto hull = convexHull({rect.points.begin(), rect.points.end()});
+    std::vector<WidthBreak> candidates = {{minAngle, width(hull, minAngle)}, {maxAngle, width(hull, maxAngle)}};
+    for (const auto &b : widthBreaks(hull))
+    {
+        // One period is enough, the first one inside the range has the smallest angle
+        double shifted = b.angle + std::ceil((minAngle - b.angle) / HALF_TURN) * HALF_TURN;
+        if (shifted <= maxAngle)
+        {
+            candidates.push_back({shifted, b.width});
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const WidthBreak &l, const WidthBreak &r) { return l.angle < r.angle; });
+
+    BestAngle best{0, 0, 0};
+    bool found = false;
+    for (const auto &c : candidates)
+    {
+        size_t lines = geometry::hatchLineCount(rect, c.angle, step);
+        if (!found || lines < best.lines || (lines == best.lines && c.width < best.width))
+        {
+            best = {c.angle, c.width, lines};
+            found = true;
+        }
+    }
+    return best;
+}
+
+} // namespace angle_search
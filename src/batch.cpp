@@ -0,0 +1,317 @@
+/**
+ * @file batch.cpp
+ * @brief Implementation of parallel batch execution
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "batch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <thread>
+
+#include "alloc_tracker.h"
+#include "metrics.h"
+#include "pipeline.h"
+#include "spill_sink.h"
+#include "svg_writer.h"
+
+namespace batch
+{
+
+void writeJobSVG(const cmdline_parser::Config &job, std::span<const geometry::Segment> hatch,
+                 std::pmr::memory_resource *mr, progress::Reporter *progress)
+{
+    if (!job.outSVG.has_value())
+    {
+        return;
+    }
+    alloc_tracker::AllocationGuard guard("SVGWriter");
+    svg::SVGWriter writer(job.outSVG.value(), 400, 400, mr);
+    writer.setProgress(progress);
+    {
+        alloc_tracker::AllocationGuard drawGuard("SVGWriter::drawSegments");
+        writer.drawSegments(hatch, svg::HATCH);
+        writer.drawSegments(job.rect.toSegments(mr), svg::CONTOUR);
+    }
+}
+
+JobResult streamJob(const cmdline_parser::Config &job, const geometry::SegmentSink &sink,
+                    const geometry::Cancellation &cancel, progress::Reporter *progress)
+{
+    geometry::checkHatch(job.rect, job.angle, job.step, job.limits);
+
+    // Hatch never leaves the rectangle, so bounds are known before generation
+    std::optional<svg::SVGWriter> writer;
+    std::optional<pipeline::SvgPipeline> staged;
+    if (job.outSVG.has_value() && job.pipelineChunk != 0)
+    {
+        staged.emplace(job.outSVG.value(), svg::boundsOf(job.rect), job.pipelineChunk, progress);
+    }
+    else if (job.outSVG.has_value())
+    {
+        writer.emplace(job.outSVG.value(), 400, 400);
+        writer->setBounds(svg::boundsOf(job.rect));
+        writer->setProgress(progress);
+    }
+
+    JobResult result{.streamed = true};
+    result.status = geometry::generateHatch(
+        job.rect, job.angle, job.step,
+        [&](const geometry::Segment &segment) {
+            ++result.segments;
+            if (writer.has_value())
+            {
+                writer->drawSegment(segment, svg::HATCH);
+            }
+            else if (staged.has_value())
+            {
+                staged->push(segment);
+            }
+            if (sink)
+            {
+                sink(segment);
+            }
+        },
+        job.limits, cancel, progress);
+
+    if (writer.has_value())
+    {
+        writer->drawSegments(job.rect.toSegments(), svg::CONTOUR);
+    }
+    else if (staged.has_value())
+    {
+        staged->finish(job.rect.toSegments());
+    }
+    return result;
+}
+
+JobResult spillJob(const cmdline_parser::Config &job, const memory_budget::Budget &budget,
+                   const geometry::SegmentSink &sink, const geometry::Cancellation &cancel,
+                   progress::Reporter *progress)
+{
+    geometry::checkHatch(job.rect, job.angle, job.step, job.limits);
+
+    geometry::SpillSink spill(budget.maxBytes, budget.spillDirectory);
+    JobResult result{.spilled = true};
+    result.status = geometry::generateHatch(job.rect, job.angle, job.step, spill, job.limits, cancel, progress);
+    result.segments = spill.size();
+    result.spilledBytes = spill.spilledBytes();
+    if (result.status != geometry::COMPLETE)
+    {
+        return result;
+    }
+
+    std::optional<svg::SVGWriter> writer;
+    if (job.outSVG.has_value())
+    {
+        writer.emplace(job.outSVG.value(), 400, 400);
+        writer->setBounds(svg::boundsOf(job.rect));
+        writer->setProgress(progress);
+    }
+    spill.merge([&](const geometry::Segment &segment) {
+        if (writer.has_value())
+        {
+            writer->drawSegment(segment, svg::HATCH);
+        }
+        if (sink)
+        {
+            sink(segment);
+        }
+    });
+
+    if (writer.has_value())
+    {
+        writer->drawSegments(job.rect.toSegments(), svg::CONTOUR);
+    }
+    return result;
+}
+
+std::vector<JobResult> run(const std::vector<cmdline_parser::Config> &jobs, unsigned threads,
+                           const JobHandler &handler, const memory_budget::Budget &budget,
+                           const geometry::Cancellation &cancel, progress::Reporter *progress,
+                           const result_cache::Cache *cache, const job_queue::Policy &policy)
+{
+    std::vector<JobResult> results(jobs.size());
+
+    // Within a class longest job first: the last jobs to be taken are the short ones, which balance
+    // the workers. Generation and serialization both cost per line, so the line bound ranks the jobs.
+    job_queue::JobQueue queue(policy);
+    auto start = job_queue::Clock::now();
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        std::optional<job_queue::Clock::time_point> deadline;
+        if (jobs[i].deadline.count() != 0)
+        {
+            deadline = start + jobs[i].deadline;
+        }
+        queue.push(i, jobs[i].priority, geometry::hatchSegmentBound(jobs[i].rect, jobs[i].angle, jobs[i].step),
+                   deadline, start + jobs[i].delay);
+    }
+    queue.close();
+
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(jobs.size(), 1)));
+
+    memory_budget::Budget workerBudget = budget;
+    workerBudget.maxBytes = budget.maxBytes == 0 ? 0 : std::max<size_t>(budget.maxBytes / threads, 1);
+
+    // Runs one job within a budget, its failure is recorded in its result. The bytes the job
+    // keeps while it runs are stored to held before generation starts.
+    auto runJob = [&](size_t i, std::pmr::monotonic_buffer_resource &arena, const geometry::Cancellation &cancel,
+                      const memory_budget::Budget &jobBudget, size_t &held) {
+        try
+        {
+            auto estimate = memory_budget::estimate(jobs[i].rect, jobs[i].angle, jobs[i].step,
+                                                    jobs[i].outSVG.has_value());
+            bool streaming = memory_budget::mustStream(estimate, jobBudget);
+            // A streamed job runs in constant memory, a spilled one fills its whole budget
+            if (!streaming)
+            {
+                held = estimate.totalBytes();
+            }
+            else if (jobBudget.policy == memory_budget::SPILL)
+            {
+                held = jobBudget.maxBytes;
+            }
+
+            // The streaming writer lays out the file differently, so the mode is part of the key
+            std::string key;
+            if (cache != nullptr && jobs[i].outSVG.has_value())
+            {
+                geometry::checkHatch(jobs[i].rect, jobs[i].angle, jobs[i].step, jobs[i].limits);
+                key = result_cache::jobKey(jobs[i], streaming ? "svg/streamed" : "svg/buffered");
+                if (auto segments = cache->fetch(key, jobs[i].outSVG.value()); segments.has_value())
+                {
+                    metrics::hatchMetrics().cacheHits.add();
+                    results[i].segments = segments.value();
+                    results[i].cached = true;
+                    return;
+                }
+                metrics::hatchMetrics().cacheMisses.add();
+            }
+
+            if (streaming)
+            {
+                results[i] = jobBudget.policy == memory_budget::SPILL
+                                 ? spillJob(jobs[i], jobBudget, {}, cancel, progress)
+                                 : streamJob(jobs[i], {}, cancel, progress);
+            }
+            else
+            {
+                std::pmr::vector<geometry::Segment> hatch(&arena);
+                {
+                    alloc_tracker::AllocationGuard guard("generateHatch");
+                    results[i].status = geometry::generateHatch(jobs[i].rect, jobs[i].angle, jobs[i].step, hatch,
+                                                                cancel, jobs[i].limits, progress);
+                }
+                results[i].segments = hatch.size();
+                // A stopped job is abandoned, its partial hatch is not worth serializing
+                if (results[i].status == geometry::COMPLETE)
+                {
+                    handler(jobs[i], hatch, &arena, progress);
+                }
+            }
+
+            if (!key.empty() && results[i].status == geometry::COMPLETE)
+            {
+                cache->store(key, jobs[i].outSVG.value(), results[i].segments);
+            }
+        }
+        catch (const std::exception &e)
+        {
+            results[i].ok = false;
+            results[i].error = e.what();
+        }
+    };
+
+    const auto &metrics = metrics::hatchMetrics();
+    metrics.queueDepth.add(static_cast<int64_t>(jobs.size()));
+
+    // Runs a job taken from the queue. A BATCH job yields to one more urgent job per
+    // generation check, which runs nested on this thread with its own arena, until it
+    // has been paused for Policy::maxPaused. The paused job keeps its memory, so the
+    // nested one gets only what is left of the budget.
+    std::function<void(const job_queue::Ticket &, std::pmr::monotonic_buffer_resource &,
+                       const memory_budget::Budget &)>
+        execute = [&](const job_queue::Ticket &ticket, std::pmr::monotonic_buffer_resource &arena,
+                      const memory_budget::Budget &jobBudget) {
+            size_t i = ticket.id;
+            metrics.queueDepth.add(-1);
+            // Jobs left after a stop are skipped quickly, each one reported as stopped
+            if (auto status = cancel.poll(); status != geometry::COMPLETE)
+            {
+                results[i].status = status;
+                queue.done(ticket);
+                return;
+            }
+
+            size_t held = 0;
+            job_queue::Clock::duration paused{};
+            geometry::Cancellation jobCancel = cancel;
+            if (ticket.priority == job_queue::BATCH)
+            {
+                jobCancel.yield = [&] {
+                    memory_budget::Budget left = jobBudget;
+                    if (jobBudget.maxBytes != 0)
+                    {
+                        if (held >= jobBudget.maxBytes)
+                        {
+                            return;
+                        }
+                        left.maxBytes = jobBudget.maxBytes - held;
+                    }
+                    // With FAIL an urgent job over what is left would be refused, it waits for a free worker
+                    auto fits = [&](size_t id) {
+                        return left.maxBytes == 0 || left.policy != memory_budget::FAIL ||
+                               memory_budget::estimate(jobs[id].rect, jobs[id].angle, jobs[id].step,
+                                                       jobs[id].outSVG.has_value())
+                                       .totalBytes() <= left.maxBytes;
+                    };
+                    if (auto urgent = queue.preempt(ticket.priority, paused, fits); urgent.has_value())
+                    {
+                        auto started = job_queue::Clock::now();
+                        std::pmr::monotonic_buffer_resource nested;
+                        execute(urgent.value(), nested, left);
+                        paused += job_queue::Clock::now() - started;
+                    }
+                };
+            }
+
+            metrics.requests.add();
+            auto started = std::chrono::steady_clock::now();
+            runJob(i, arena, jobCancel, jobBudget, held);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+            metrics.jobSeconds.observe(elapsed.count());
+            queue.done(ticket);
+        };
+
+    auto worker = [&] {
+        std::pmr::monotonic_buffer_resource arena;
+        while (auto ticket = queue.take())
+        {
+            execute(ticket.value(), arena, workerBudget);
+            arena.release();
+        }
+    };
+
+    // The calling thread is one of the workers, the others are joined at the end of the block
+    {
+        std::vector<std::jthread> pool;
+        for (unsigned t = 1; t < threads; ++t)
+        {
+            pool.emplace_back(worker);
+        }
+        worker();
+    }
+
+    return results;
+}
+
+} // namespace batch
@@ -7,11 +7,14 @@
 
 #include "cmdline_parser.h"
 
+#include <chrono>
 #include <filesystem>
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <utility>
 
+#include "angle_search.h"
 #include "geometry.h"
 
 namespace cmdline_parser
@@ -21,8 +24,32 @@ Config parse(int argc, char *argv[])
 {
     std::optional<std::array<geometry::Point, 4>> rect;
     std::optional<double> angle;
+    std::optional<std::pair<double, double>> angleRange;
     std::optional<double> step;
     std::optional<std::filesystem::path> svg;
+    std::optional<std::filesystem::path> jobs;
+    std::optional<unsigned> threads;
+    std::optional<unsigned> processes;
+    std::optional<size_t> maxMemory;
+    std::optional<memory_budget::Policy> overBudget;
+    std::optional<std::filesystem::path> spillDir;
+    std::optional<size_t> maxSegments;
+    std::optional<long long> timeBudget;
+    bool progress = false;
+    std::optional<std::filesystem::path> cacheDir;
+    std::optional<size_t> cacheSize;
+    std::optional<std::filesystem::path> metricsSocket;
+    std::optional<std::filesystem::path> metricsFile;
+    std::optional<std::string> shm;
+    std::optional<job_queue::Priority> priority;
+    std::optional<long long> deadline;
+    std::optional<long long> delay;
+    std::optional<unsigned> interactiveLimit;
+    std::optional<unsigned> batchLimit;
+    std::optional<long long> aging;
+    std::optional<long long> maxPaused;
+    std::optional<size_t> chunkSize;
+    std::optional<cpu_dispatch::Isa> isa;
 
     // Parse all command line arguments
     for (size_t i = 1; i < argc; ++i)
@@ -62,6 +89,20 @@ Config parse(int argc, char *argv[])
             angle.emplace(stod(nextArg));
             i += 1;
         }
+        // Handle --angle-range argument
+        else if (currentArg == ANGLE_RANGE_ARG_NAME)
+        {
+            if (angleRange.has_value())
+            {
+                throw std::invalid_argument(ANGLE_RANGE_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 2 >= argc)
+            {
+                throw std::invalid_argument("Expected <double> x 2 after " + ANGLE_RANGE_ARG_NAME);
+            }
+            angleRange.emplace(std::stod(argv[i + 1]), std::stod(argv[i + 2]));
+            i += 2;
+        }
         // Handle --step argument
         else if (currentArg == STEP_ARG_NAME)
         {
@@ -92,6 +133,391 @@ Config parse(int argc, char *argv[])
             svg.emplace(nextArg);
             i += 1;
         }
+        // Handle --jobs argument
+        else if (currentArg == JOBS_ARG_NAME)
+        {
+            if (jobs.has_value())
+            {
+                throw std::invalid_argument(JOBS_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <path> after " + JOBS_ARG_NAME);
+            }
+            std::string nextArg(argv[i + 1]);
+            jobs.emplace(nextArg);
+            i += 1;
+        }
+        // Handle --threads argument
+        else if (currentArg == THREADS_ARG_NAME)
+        {
+            if (threads.has_value())
+            {
+                throw std::invalid_argument(THREADS_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <count> after " + THREADS_ARG_NAME);
+            }
+            std::string nextArg(argv[i + 1]);
+            threads.emplace(std::stoul(nextArg));
+            i += 1;
+        }
+        // Handle --processes argument
+        else if (currentArg == PROCESSES_ARG_NAME)
+        {
+            if (processes.has_value())
+            {
+                throw std::invalid_argument(PROCESSES_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <count> after " + PROCESSES_ARG_NAME);
+            }
+            std::string nextArg(argv[i + 1]);
+            processes.emplace(std::stoul(nextArg));
+            i += 1;
+        }
+        // Handle --max-memory argument
+        else if (currentArg == MAX_MEMORY_ARG_NAME)
+        {
+            if (maxMemory.has_value())
+            {
+                throw std::invalid_argument(MAX_MEMORY_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <bytes> after " + MAX_MEMORY_ARG_NAME);
+            }
+            maxMemory.emplace(memory_budget::parseSize(argv[i + 1]));
+            i += 1;
+        }
+        // Handle --over-budget argument
+        else if (currentArg == OVER_BUDGET_ARG_NAME)
+        {
+            if (overBudget.has_value())
+            {
+                throw std::invalid_argument(OVER_BUDGET_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected stream|fail|spill after " + OVER_BUDGET_ARG_NAME);
+            }
+            std::string nextArg(argv[i + 1]);
+            if (nextArg == "stream")
+            {
+                overBudget.emplace(memory_budget::STREAM);
+            }
+            else if (nextArg == "fail")
+            {
+                overBudget.emplace(memory_budget::FAIL);
+            }
+            else if (nextArg == "spill")
+            {
+                overBudget.emplace(memory_budget::SPILL);
+            }
+            else
+            {
+                throw std::invalid_argument("Expected stream|fail|spill after " + OVER_BUDGET_ARG_NAME);
+            }
+            i += 1;
+        }
+        // Handle --spill-dir argument
+        else if (currentArg == SPILL_DIR_ARG_NAME)
+        {
+            if (spillDir.has_value())
+            {
+                throw std::invalid_argument(SPILL_DIR_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <path> after " + SPILL_DIR_ARG_NAME);
+            }
+            std::string nextArg(argv[i + 1]);
+            spillDir.emplace(nextArg);
+            i += 1;
+        }
+        // Handle --max-segments argument
+        else if (currentArg == MAX_SEGMENTS_ARG_NAME)
+        {
+            if (maxSegments.has_value())
+            {
+                throw std::invalid_argument(MAX_SEGMENTS_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <count> after " + MAX_SEGMENTS_ARG_NAME);
+            }
+            std::string nextArg(argv[i + 1]);
+            maxSegments.emplace(std::stoull(nextArg));
+            i += 1;
+        }
+        // Handle --time-budget argument
+        else if (currentArg == TIME_BUDGET_ARG_NAME)
+        {
+            if (timeBudget.has_value())
+            {
+                throw std::invalid_argument(TIME_BUDGET_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <milliseconds> after " + TIME_BUDGET_ARG_NAME);
+            }
+            std::string nextArg(argv[i + 1]);
+            timeBudget.emplace(std::stoll(nextArg));
+            if (timeBudget.value() < 0)
+            {
+                throw std::invalid_argument("Expected <milliseconds> after " + TIME_BUDGET_ARG_NAME);
+            }
+            i += 1;
+        }
+        // Handle --progress flag
+        else if (currentArg == PROGRESS_ARG_NAME)
+        {
+            if (progress)
+            {
+                throw std::invalid_argument(PROGRESS_ARG_NAME + " argument gets more then once");
+            }
+            progress = true;
+        }
+        // Handle --cache-dir argument
+        else if (currentArg == CACHE_DIR_ARG_NAME)
+        {
+            if (cacheDir.has_value())
+            {
+                throw std::invalid_argument(CACHE_DIR_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <path> after " + CACHE_DIR_ARG_NAME);
+            }
+            std::string nextArg(argv[i + 1]);
+            cacheDir.emplace(nextArg);
+            i += 1;
+        }
+        // Handle --cache-size argument
+        else if (currentArg == CACHE_SIZE_ARG_NAME)
+        {
+            if (cacheSize.has_value())
+            {
+                throw std::invalid_argument(CACHE_SIZE_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <bytes> after " + CACHE_SIZE_ARG_NAME);
+            }
+            cacheSize.emplace(memory_budget::parseSize(argv[i + 1]));
+            i += 1;
+        }
+        // Handle --metrics-socket argument
+        else if (currentArg == METRICS_SOCKET_ARG_NAME)
+        {
+            if (metricsSocket.has_value())
+            {
+                throw std::invalid_argument(METRICS_SOCKET_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <path> after " + METRICS_SOCKET_ARG_NAME);
+            }
+            std::string nextArg(argv[i + 1]);
+            metricsSocket.emplace(nextArg);
+            i += 1;
+        }
+        // Handle --metrics-file argument
+        else if (currentArg == METRICS_FILE_ARG_NAME)
+        {
+            if (metricsFile.has_value())
+            {
+                throw std::invalid_argument(METRICS_FILE_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <path> after " + METRICS_FILE_ARG_NAME);
+            }
+            std::string nextArg(argv[i + 1]);
+            metricsFile.emplace(nextArg);
+            i += 1;
+        }
+        // Handle --shm argument
+        else if (currentArg == SHM_ARG_NAME)
+        {
+            if (shm.has_value())
+            {
+                throw std::invalid_argument(SHM_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <name> after " + SHM_ARG_NAME);
+            }
+            shm.emplace(argv[i + 1]);
+            i += 1;
+        }
+        // Handle --priority argument
+        else if (currentArg == PRIORITY_ARG_NAME)
+        {
+            if (priority.has_value())
+            {
+                throw std::invalid_argument(PRIORITY_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected interactive|batch after " + PRIORITY_ARG_NAME);
+            }
+            std::string nextArg(argv[i + 1]);
+            if (nextArg == "interactive")
+            {
+                priority.emplace(job_queue::INTERACTIVE);
+            }
+            else if (nextArg == "batch")
+            {
+                priority.emplace(job_queue::BATCH);
+            }
+            else
+            {
+                throw std::invalid_argument("Expected interactive|batch after " + PRIORITY_ARG_NAME);
+            }
+            i += 1;
+        }
+        // Handle --deadline argument
+        else if (currentArg == DEADLINE_ARG_NAME)
+        {
+            if (deadline.has_value())
+            {
+                throw std::invalid_argument(DEADLINE_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <milliseconds> after " + DEADLINE_ARG_NAME);
+            }
+            std::string nextArg(argv[i + 1]);
+            deadline.emplace(std::stoll(nextArg));
+            if (deadline.value() < 0)
+            {
+                throw std::invalid_argument("Expected <milliseconds> after " + DEADLINE_ARG_NAME);
+            }
+            i += 1;
+        }
+        // Handle --delay argument
+        else if (currentArg == DELAY_ARG_NAME)
+        {
+            if (delay.has_value())
+            {
+                throw std::invalid_argument(DELAY_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <milliseconds> after " + DELAY_ARG_NAME);
+            }
+            std::string nextArg(argv[i + 1]);
+            delay.emplace(std::stoll(nextArg));
+            if (delay.value() < 0)
+            {
+                throw std::invalid_argument("Expected <milliseconds> after " + DELAY_ARG_NAME);
+            }
+            i += 1;
+        }
+        // Handle --interactive-limit argument
+        else if (currentArg == INTERACTIVE_LIMIT_ARG_NAME)
+        {
+            if (interactiveLimit.has_value())
+            {
+                throw std::invalid_argument(INTERACTIVE_LIMIT_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <count> after " + INTERACTIVE_LIMIT_ARG_NAME);
+            }
+            std::string nextArg(argv[i + 1]);
+            interactiveLimit.emplace(std::stoul(nextArg));
+            i += 1;
+        }
+        // Handle --batch-limit argument
+        else if (currentArg == BATCH_LIMIT_ARG_NAME)
+        {
+            if (batchLimit.has_value())
+            {
+                throw std::invalid_argument(BATCH_LIMIT_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <count> after " + BATCH_LIMIT_ARG_NAME);
+            }
+            std::string nextArg(argv[i + 1]);
+            batchLimit.emplace(std::stoul(nextArg));
+            i += 1;
+        }
+        // Handle --aging argument
+        else if (currentArg == AGING_ARG_NAME)
+        {
+            if (aging.has_value())
+            {
+                throw std::invalid_argument(AGING_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <milliseconds> after " + AGING_ARG_NAME);
+            }
+            std::string nextArg(argv[i + 1]);
+            aging.emplace(std::stoll(nextArg));
+            if (aging.value() < 0)
+            {
+                throw std::invalid_argument("Expected <milliseconds> after " + AGING_ARG_NAME);
+            }
+            i += 1;
+        }
+        // Handle --max-paused argument
+        else if (currentArg == MAX_PAUSED_ARG_NAME)
+        {
+            if (maxPaused.has_value())
+            {
+                throw std::invalid_argument(MAX_PAUSED_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <milliseconds> after " + MAX_PAUSED_ARG_NAME);
+            }
+            std::string nextArg(argv[i + 1]);
+            maxPaused.emplace(std::stoll(nextArg));
+            if (maxPaused.value() < 0)
+            {
+                throw std::invalid_argument("Expected <milliseconds> after " + MAX_PAUSED_ARG_NAME);
+            }
+            i += 1;
+        }
+        // Handle --chunk-size argument
+        else if (currentArg == CHUNK_SIZE_ARG_NAME)
+        {
+            if (chunkSize.has_value())
+            {
+                throw std::invalid_argument(CHUNK_SIZE_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected <segments> after " + CHUNK_SIZE_ARG_NAME);
+            }
+            std::string nextArg(argv[i + 1]);
+            chunkSize.emplace(std::stoull(nextArg));
+            if (chunkSize.value() == 0)
+            {
+                throw std::invalid_argument("Expected <segments> after " + CHUNK_SIZE_ARG_NAME);
+            }
+            i += 1;
+        }
+        // Handle --isa argument
+        else if (currentArg == ISA_ARG_NAME)
+        {
+            if (isa.has_value())
+            {
+                throw std::invalid_argument(ISA_ARG_NAME + " argument gets more then once");
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Expected scalar|sse2|avx2|avx512 after " + ISA_ARG_NAME);
+            }
+            isa.emplace(cpu_dispatch::parseIsa(argv[i + 1]));
+            i += 1;
+        }
         // Unknown argument
         else
         {
@@ -99,13 +525,98 @@ Config parse(int argc, char *argv[])
         }
     }
 
+    memory_budget::Budget memory{.maxBytes = maxMemory.value_or(0),
+                                 .policy = overBudget.value_or(memory_budget::STREAM),
+                                 .spillDirectory = spillDir.value_or(std::filesystem::path())};
+    geometry::HatchLimits limits{.maxSegments = maxSegments.value_or(0),
+                                 .timeBudget = std::chrono::milliseconds(timeBudget.value_or(0))};
+
+    job_queue::Policy queue;
+    queue.maxRunning[job_queue::INTERACTIVE] = interactiveLimit.value_or(0);
+    queue.maxRunning[job_queue::BATCH] = batchLimit.value_or(0);
+    queue.aging = std::chrono::milliseconds(aging.value_or(queue.aging.count()));
+    queue.maxPaused = std::chrono::milliseconds(maxPaused.value_or(queue.maxPaused.count()));
+
+    if (cacheSize.has_value() && !cacheDir.has_value())
+    {
+        throw std::invalid_argument(CACHE_SIZE_ARG_NAME + " requires " + CACHE_DIR_ARG_NAME);
+    }
+
+    // Batch mode takes jobs from the file only
+    if (jobs.has_value())
+    {
+        if (rect.has_value() || angle.has_value() || angleRange.has_value() || step.has_value() || svg.has_value() ||
+            shm.has_value() || priority.has_value() || deadline.has_value() || delay.has_value())
+        {
+            throw std::invalid_argument(JOBS_ARG_NAME + " can't be combined with single job arguments");
+        }
+        // Every worker process has its own metrics, the parent would serve none of them
+        if (processes.value_or(1) != 1 && (metricsSocket.has_value() || metricsFile.has_value()))
+        {
+            throw std::invalid_argument(PROCESSES_ARG_NAME + " can't be combined with metrics arguments");
+        }
+        return {.rect = {}, .angle = 0, .step = 0, .outSVG = {}, .jobs = jobs, .threads = threads.value_or(1),
+                .processes = processes.value_or(1), .memory = memory, .limits = limits, .progress = progress,
+                .cache = cacheDir, .cacheBytes = cacheSize.value_or(0), .metricsSocket = metricsSocket,
+                .metricsFile = metricsFile, .shm = {}, .priority = job_queue::BATCH, .deadline = {}, .delay = {},
+                .queue = queue, .pipelineChunk = chunkSize.value_or(0), .isa = isa};
+    }
+    if (threads.has_value())
+    {
+        throw std::invalid_argument(THREADS_ARG_NAME + " requires " + JOBS_ARG_NAME);
+    }
+    if (processes.has_value())
+    {
+        throw std::invalid_argument(PROCESSES_ARG_NAME + " requires " + JOBS_ARG_NAME);
+    }
+    if (cacheDir.has_value())
+    {
+        throw std::invalid_argument(CACHE_DIR_ARG_NAME + " requires " + JOBS_ARG_NAME);
+    }
+    if (interactiveLimit.has_value() || batchLimit.has_value() || aging.has_value() || maxPaused.has_value())
+    {
+        throw std::invalid_argument("Queue limits require " + JOBS_ARG_NAME);
+    }
+
+    if (angle.has_value() && angleRange.has_value())
+    {
+        throw std::invalid_argument(ANGLE_ARG_NAME + " can't be combined with " + ANGLE_RANGE_ARG_NAME);
+    }
+
     // Validate that required arguments are present
-    if (!rect.has_value() || !angle.has_value() || !step.has_value())
+    if (!rect.has_value() || !(angle.has_value() || angleRange.has_value()) || !step.has_value())
     {
         throw std::invalid_argument("Required arg missing");
     }
 
-    return {.rect = {rect.value()}, .angle = angle.value(), .step = step.value(), .outSVG = svg};
+    // The angle with the fewest lines, found without hatching
+    if (angleRange.has_value())
+    {
+        auto [minAngle, maxAngle] = angleRange.value();
+        angle = angle_search::bestAngle({rect.value()}, step.value(), minAngle, maxAngle).angle;
+    }
+
+    return {.rect = {rect.value()},
+            .angle = angle.value(),
+            .step = step.value(),
+            .outSVG = svg,
+            .jobs = {},
+            .threads = 1,
+            .processes = 1,
+            .memory = memory,
+            .limits = limits,
+            .progress = progress,
+            .cache = {},
+            .cacheBytes = 0,
+            .metricsSocket = metricsSocket,
+            .metricsFile = metricsFile,
+            .shm = shm,
+            .priority = priority.value_or(job_queue::BATCH),
+            .deadline = std::chrono::milliseconds(deadline.value_or(0)),
+            .delay = std::chrono::milliseconds(delay.value_or(0)),
+            .queue = queue,
+            .pipelineChunk = chunkSize.value_or(0),
+            .isa = isa};
 }
 
 } // namespace cmdline_parser
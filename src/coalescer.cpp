@@ -0,0 +1,79 @@
+/**
+ * @file coalescer.cpp
+ * @brief Implementation of hatch request coalescing
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "coalescer.h"
+
+#include <exception>
+#include <sstream>
+
+#include "job_file.h"
+#include "metrics.h"
+
+namespace coalescing
+{
+
+std::string requestKey(const cmdline_parser::Config &job)
+{
+    auto request = job;
+    request.outSVG.reset();
+    // Scheduling and output staging don't change the hatch
+    request.priority = job_queue::BATCH;
+    request.deadline = {};
+    request.delay = {};
+    request.pipelineChunk = 0;
+    std::ostringstream key;
+    job_file::writeJob(key, request);
+    return key.str();
+}
+
+SharedHatch Coalescer::hatch(const cmdline_parser::Config &job)
+{
+    requests.fetch_add(1, std::memory_order_relaxed);
+    metrics::hatchMetrics().requests.add();
+    auto key = requestKey(job);
+
+    std::promise<SharedHatch> promise;
+    std::shared_future<SharedHatch> result;
+    bool leader = false;
+    {
+        std::lock_guard lock(mutex);
+        auto [it, inserted] = inFlight.try_emplace(key);
+        if (inserted)
+        {
+            it->second = promise.get_future().share();
+            leader = true;
+        }
+        result = it->second;
+    }
+
+    if (leader)
+    {
+        computations.fetch_add(1, std::memory_order_relaxed);
+        try
+        {
+            promise.set_value(std::make_shared<const std::vector<geometry::Segment>>(
+                geometry::generateHatch(job.rect, job.angle, job.step, job.limits)));
+        }
+        catch (...)
+        {
+            promise.set_exception(std::current_exception());
+        }
+
+        // Later requests start a new computation, the result stays with its holders
+        std::lock_guard lock(mutex);
+        inFlight.erase(key);
+    }
+    return result.get();
+}
+
+Stats Coalescer::stats() const noexcept
+{
+    return {.requests = requests.load(std::memory_order_relaxed),
+            .computations = computations.load(std::memory_order_relaxed)};
+}
+
+} // namespace coalescing
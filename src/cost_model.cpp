@@ -0,0 +1,188 @@
+/**
+ * @file cost_model.cpp
+ * @brief Implementation of closed-form cost prediction
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "cost_model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+
+#include "svg_writer.h"
+
+namespace
+{
+
+/// Hatch lines formatted to predict output size
+constexpr size_t SAMPLE_LINES = 8;
+
+/**
+ * @brief Multiplies with saturation
+ * @param count Number of elements
+ * @param size Element size
+ * @return count * size or SIZE_MAX on overflow
+ */
+size_t bytesOf(size_t count, size_t size) noexcept
+{
+    return size != 0 && count > std::numeric_limits<size_t>::max() / size ? std::numeric_limits<size_t>::max()
+                                                                           : count * size;
+}
+
+/**
+ * @brief Computes hatch segments spread evenly over the rectangle
+ * @param rect Rectangle to fill with hatch
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @param lines Number of hatch lines, see geometry::hatchLineCount()
+ * @return Up to SAMPLE_LINES segments with the coordinates real lines have
+ */
+std::vector<geometry::Segment> sampleHatch(const geometry::Rectangle &rect, double angle, double step, size_t lines)
+{
+    double rad = angle * M_PI / 180.0;
+    geometry::Vector unitNorm(std::sin(rad), std::cos(rad));
+    const auto &origin = rect.points.front();
+
+    double lo = 0;
+    for (const auto &p : rect.points)
+    {
+        lo = std::min(lo, geometry::dotProduct(geometry::Vector(origin, p), unitNorm));
+    }
+    double kMin = std::floor(lo / step) + 1;
+
+    std::vector<geometry::Segment> samples;
+    size_t count = std::min(lines, SAMPLE_LINES);
+    for (size_t i = 0; i < count; ++i)
+    {
+        double k = kMin + std::floor(double(lines) * (2 * i + 1) / (2 * count));
+        geometry::Line hatchLine(unitNorm, origin + unitNorm * (k * step));
+
+        // Crossings within the edges, the farthest two bound the chord
+        std::vector<geometry::Point> crossings;
+        for (const auto &edge : rect.toSegments())
+        {
+            if (geometry::isLinesSameOrParallel(edge.line, hatchLine))
+            {
+                continue;
+            }
+            auto p = geometry::linesIntersection(edge.line, hatchLine);
+            geometry::Vector along(edge.a, edge.b);
+            double t = geometry::dotProduct(geometry::Vector(edge.a, p), along) / geometry::dotProduct(along, along);
+            if (t >= 0 && t <= 1)
+            {
+                crossings.push_back(p);
+            }
+        }
+
+        double farthest = -1;
+        std::optional<geometry::Segment> chord;
+        for (size_t a = 0; a < crossings.size(); ++a)
+        {
+            for (size_t b = a + 1; b < crossings.size(); ++b)
+            {
+                if (double d = geometry::distance2(crossings[a], crossings[b]); d > farthest)
+                {
+                    farthest = d;
+                    chord.emplace(crossings[a], crossings[b]);
+                }
+            }
+        }
+        if (chord.has_value())
+        {
+            samples.push_back(chord.value());
+        }
+    }
+    return samples;
+}
+
+/**
+ * @brief Measures SVG output of one segment
+ * @param rect Rectangle fixing the drawing bounds
+ * @param segment Segment to write
+ * @param lf Line format
+ * @return Bytes of the line element
+ */
+size_t svgElementBytes(const geometry::Rectangle &rect, const geometry::Segment &segment, svg::LineFormat lf)
+{
+    std::ostringstream out;
+    svg::SVGWriter writer(out, 400, 400);
+    writer.setBounds(svg::boundsOf(rect));
+    auto begin = out.tellp();
+    writer.drawSegment(segment, lf);
+    return static_cast<size_t>(out.tellp() - begin);
+}
+
+/**
+ * @brief Measures SVG header and tail
+ * @return Bytes of an SVG file without elements
+ */
+size_t svgFrameBytes()
+{
+    std::ostringstream out;
+    {
+        svg::SVGWriter writer(out, 400, 400);
+    }
+    return out.str().size();
+}
+
+} // namespace
+
+namespace cost_model
+{
+
+HatchCost estimateHatch(const geometry::Rectangle &rect, double angle, double step)
+{
+    HatchCost cost{.lines = geometry::hatchLineCount(rect, angle, step),
+                   .maxSegments = 0,
+                   .totalLength = 0,
+                   .textBytes = 0,
+                   .svgHatchBytes = 0,
+                   .svgContourBytes = 0,
+                   .svgBytes = 0,
+                   .memory = memory_budget::estimate(rect, angle, step, true)};
+    try
+    {
+        geometry::validateHatch(rect, angle, step);
+    }
+    catch (const std::invalid_argument &)
+    {
+        return cost;
+    }
+
+    cost.maxSegments = geometry::hatchSegmentBound(rect, angle, step);
+    cost.totalLength = geometry::hatchTotalLength(rect, angle, step);
+
+    // Average size of a few real hatch lines, their digits are those of the whole hatch
+    auto samples = sampleHatch(rect, angle, step, cost.lines);
+    size_t textSample = 0, svgSample = 0;
+    for (const auto &segment : samples)
+    {
+        std::ostringstream text;
+        text << "Line: " << segment << '\n';
+        textSample += text.str().size();
+        svgSample += svgElementBytes(rect, segment, svg::HATCH);
+    }
+    if (!samples.empty())
+    {
+        cost.textBytes = bytesOf(cost.lines, textSample) / samples.size();
+        cost.svgHatchBytes = bytesOf(cost.lines, svgSample) / samples.size();
+    }
+
+    cost.svgContourBytes = 0;
+    for (const auto &edge : rect.toSegments())
+    {
+        cost.svgContourBytes += svgElementBytes(rect, edge, svg::CONTOUR);
+    }
+    static const size_t frameBytes = svgFrameBytes();
+    size_t frame = frameBytes + cost.svgContourBytes;
+    cost.svgBytes = cost.svgHatchBytes > std::numeric_limits<size_t>::max() - frame ? std::numeric_limits<size_t>::max()
+                                                                                    : cost.svgHatchBytes + frame;
+    return cost;
+}
+
+} // namespace cost_model
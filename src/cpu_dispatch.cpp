@@ -0,0 +1,429 @@
+/**
+ * @file cpu_dispatch.cpp
+ * @brief Implementation of the instruction set variants of geometry kernels
+ * @author Alsu Khabibulina
+ * @date 2025
+ *
+ * Built with -ffp-contract=off (see CMakeLists.txt): a fused multiply-add
+ * rounds once instead of twice, so contracting in one variant only would
+ * break bit-identical results.
+ */
+
+#include "cpu_dispatch.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HATCH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+using cpu_dispatch::Range;
+
+/// Instruction set selected so far, -1 until first use
+std::atomic<int> active{-1};
+
+/**
+ * @brief Finds range of two columns over [begin, end) one element at a time
+ * @param a First column
+ * @param b Second column
+ * @param begin First index
+ * @param end Index past the last one
+ * @param range Range found so far
+ * @return Range including the values
+ */
+Range scalarRange(const double *a, const double *b, size_t begin, size_t end, Range range) noexcept
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        range.min = std::min({range.min, a[i], b[i]});
+        range.max = std::max({range.max, a[i], b[i]});
+    }
+    return range;
+}
+
+/**
+ * @brief Transforms [begin, end) of a column one element at a time
+ * @param column Column to transform in place
+ * @param begin First index
+ * @param end Index past the last one
+ * @param m Mirror factor
+ * @param t Translation
+ * @param s Scale
+ */
+void scalarTransform(double *column, size_t begin, size_t end, double m, double t, double s) noexcept
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        column[i] = (m * column[i] + t) * s;
+    }
+}
+
+Range columnRangeScalar(const double *a, const double *b, size_t begin, size_t end) noexcept
+{
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    return scalarRange(a, b, begin, end, {inf, -inf});
+}
+
+void transformColumnScalar(double *column, size_t begin, size_t end, double m, double t, double s) noexcept
+{
+    scalarTransform(column, begin, end, m, t, s);
+}
+
+uint32_t intersectLinesScalar(const double *a, const double *b, const double *c, const double *tol, size_t n,
+                              double la, double lb, double lc, double *x, double *y) noexcept
+{
+    uint32_t mask = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        // Same operations as isLinesSameOrParallel() and linesIntersection()
+        double d = a[i] * lb - la * b[i];
+        if (!(std::abs(d) <= tol[i]))
+        {
+            mask |= uint32_t(1) << i;
+            x[i] = (b[i] * lc - lb * c[i]) / d;
+            y[i] = (c[i] * la - lc * a[i]) / d;
+        }
+    }
+    return mask;
+}
+
+#ifdef HATCH_X86
+
+__attribute__((target("sse2"))) Range columnRangeSSE2(const double *a, const double *b, size_t begin,
+                                                      size_t end) noexcept
+{
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    size_t i = begin;
+    // Two independent accumulators per bound hide min/max latency
+    __m128d lo0 = _mm_set1_pd(inf), lo1 = lo0;
+    __m128d hi0 = _mm_set1_pd(-inf), hi1 = hi0;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128d a0 = _mm_load_pd(a + i), a1 = _mm_load_pd(a + i + 2);
+        __m128d b0 = _mm_load_pd(b + i), b1 = _mm_load_pd(b + i + 2);
+        lo0 = _mm_min_pd(b0, _mm_min_pd(a0, lo0));
+        lo1 = _mm_min_pd(b1, _mm_min_pd(a1, lo1));
+        hi0 = _mm_max_pd(b0, _mm_max_pd(a0, hi0));
+        hi1 = _mm_max_pd(b1, _mm_max_pd(a1, hi1));
+    }
+    double lo[2], hi[2];
+    _mm_storeu_pd(lo, _mm_min_pd(lo0, lo1));
+    _mm_storeu_pd(hi, _mm_max_pd(hi0, hi1));
+    return scalarRange(a, b, i, end, {std::min(lo[0], lo[1]), std::max(hi[0], hi[1])});
+}
+
+__attribute__((target("sse2"))) void transformColumnSSE2(double *column, size_t begin, size_t end, double m,
+                                                         double t, double s) noexcept
+{
+    size_t i = begin;
+    __m128d mv = _mm_set1_pd(m), tv = _mm_set1_pd(t), sv = _mm_set1_pd(s);
+    for (; i + 2 <= end; i += 2)
+    {
+        __m128d v = _mm_load_pd(column + i);
+        _mm_store_pd(column + i, _mm_mul_pd(_mm_add_pd(_mm_mul_pd(v, mv), tv), sv));
+    }
+    scalarTransform(column, i, end, m, t, s);
+}
+
+__attribute__((target("sse2"))) uint32_t intersectLinesSSE2(const double *a, const double *b, const double *c,
+                                                            const double *tol, size_t n, double la, double lb,
+                                                            double lc, double *x, double *y) noexcept
+{
+    __m128d lav = _mm_set1_pd(la), lbv = _mm_set1_pd(lb), lcv = _mm_set1_pd(lc);
+    __m128d sign = _mm_set1_pd(-0.0);
+    uint32_t parallel = 0;
+    for (size_t i = 0; i < n; i += 2)
+    {
+        __m128d av = _mm_loadu_pd(a + i), bv = _mm_loadu_pd(b + i), cv = _mm_loadu_pd(c + i);
+        __m128d d = _mm_sub_pd(_mm_mul_pd(av, lbv), _mm_mul_pd(lav, bv));
+        __m128d near = _mm_cmple_pd(_mm_andnot_pd(sign, d), _mm_loadu_pd(tol + i));
+        parallel |= uint32_t(_mm_movemask_pd(near)) << i;
+        __m128d dx = _mm_sub_pd(_mm_mul_pd(bv, lcv), _mm_mul_pd(lbv, cv));
+        __m128d dy = _mm_sub_pd(_mm_mul_pd(cv, lav), _mm_mul_pd(lcv, av));
+        _mm_storeu_pd(x + i, _mm_div_pd(dx, d));
+        _mm_storeu_pd(y + i, _mm_div_pd(dy, d));
+    }
+    uint32_t valid = n == 32 ? ~uint32_t(0) : (uint32_t(1) << n) - 1;
+    return ~parallel & valid;
+}
+
+/**
+ * @brief Reduces range accumulators to one range
+ * @param lo4 Smallest values per lane
+ * @param hi4 Largest values per lane
+ * @return Smallest and largest of all lanes
+ */
+__attribute__((target("avx2"))) inline Range reduceRange(__m256d lo4, __m256d hi4) noexcept
+{
+    __m128d lo2 = _mm_min_pd(_mm256_castpd256_pd128(lo4), _mm256_extractf128_pd(lo4, 1));
+    __m128d hi2 = _mm_max_pd(_mm256_castpd256_pd128(hi4), _mm256_extractf128_pd(hi4, 1));
+    double lo[2], hi[2];
+    _mm_storeu_pd(lo, lo2);
+    _mm_storeu_pd(hi, hi2);
+    return {std::min(lo[0], lo[1]), std::max(hi[0], hi[1])};
+}
+
+__attribute__((target("avx2"))) Range columnRangeAVX2(const double *a, const double *b, size_t begin,
+                                                      size_t end) noexcept
+{
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    size_t i = begin;
+    __m256d lo0 = _mm256_set1_pd(inf), lo1 = lo0;
+    __m256d hi0 = _mm256_set1_pd(-inf), hi1 = hi0;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256d a0 = _mm256_load_pd(a + i), a1 = _mm256_load_pd(a + i + 4);
+        __m256d b0 = _mm256_load_pd(b + i), b1 = _mm256_load_pd(b + i + 4);
+        lo0 = _mm256_min_pd(b0, _mm256_min_pd(a0, lo0));
+        lo1 = _mm256_min_pd(b1, _mm256_min_pd(a1, lo1));
+        hi0 = _mm256_max_pd(b0, _mm256_max_pd(a0, hi0));
+        hi1 = _mm256_max_pd(b1, _mm256_max_pd(a1, hi1));
+    }
+    return scalarRange(a, b, i, end, reduceRange(_mm256_min_pd(lo0, lo1), _mm256_max_pd(hi0, hi1)));
+}
+
+__attribute__((target("avx2"))) void transformColumnAVX2(double *column, size_t begin, size_t end, double m,
+                                                         double t, double s) noexcept
+{
+    size_t i = begin;
+    __m256d mv = _mm256_set1_pd(m), tv = _mm256_set1_pd(t), sv = _mm256_set1_pd(s);
+    for (; i + 4 <= end; i += 4)
+    {
+        __m256d v = _mm256_load_pd(column + i);
+        _mm256_store_pd(column + i, _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(v, mv), tv), sv));
+    }
+    scalarTransform(column, i, end, m, t, s);
+}
+
+/**
+ * @brief Intersects a line with four lines of a batch using 256-bit vectors
+ * @param a Coefficients a of the four lines
+ * @param b Coefficients b of the four lines
+ * @param c Coefficients c of the four lines
+ * @param tol Tolerances of the parallel test of the four lines
+ * @param la Coefficient a of the line
+ * @param lb Coefficient b of the line
+ * @param lc Coefficient c of the line
+ * @param x Output X of the four intersections
+ * @param y Output Y of the four intersections
+ * @return Mask of the four lines that are parallel to the line
+ */
+__attribute__((target("avx2"))) inline uint32_t intersectFour(const double *a, const double *b, const double *c,
+                                                              const double *tol, double la, double lb, double lc,
+                                                              double *x, double *y) noexcept
+{
+    __m256d lav = _mm256_set1_pd(la), lbv = _mm256_set1_pd(lb), lcv = _mm256_set1_pd(lc);
+    __m256d av = _mm256_loadu_pd(a), bv = _mm256_loadu_pd(b), cv = _mm256_loadu_pd(c);
+    __m256d d = _mm256_sub_pd(_mm256_mul_pd(av, lbv), _mm256_mul_pd(lav, bv));
+    __m256d near = _mm256_cmp_pd(_mm256_andnot_pd(_mm256_set1_pd(-0.0), d), _mm256_loadu_pd(tol), _CMP_LE_OQ);
+    __m256d dx = _mm256_sub_pd(_mm256_mul_pd(bv, lcv), _mm256_mul_pd(lbv, cv));
+    __m256d dy = _mm256_sub_pd(_mm256_mul_pd(cv, lav), _mm256_mul_pd(lcv, av));
+    _mm256_storeu_pd(x, _mm256_div_pd(dx, d));
+    _mm256_storeu_pd(y, _mm256_div_pd(dy, d));
+    return uint32_t(_mm256_movemask_pd(near));
+}
+
+__attribute__((target("avx2"))) uint32_t intersectLinesAVX2(const double *a, const double *b, const double *c,
+                                                            const double *tol, size_t n, double la, double lb,
+                                                            double lc, double *x, double *y) noexcept
+{
+    uint32_t parallel = 0;
+    for (size_t i = 0; i < n; i += 4)
+    {
+        parallel |= intersectFour(a + i, b + i, c + i, tol + i, la, lb, lc, x + i, y + i) << i;
+    }
+    uint32_t valid = n == 32 ? ~uint32_t(0) : (uint32_t(1) << n) - 1;
+    return ~parallel & valid;
+}
+
+// GCC 12 builds the unmasked AVX-512 min, max, andnot and extract intrinsics on undefined vectors,
+// which -Wall reports as uninitialized. Their zero-masked forms with every lane selected are the
+// same instructions without that.
+
+/// Mask selecting every double lane of a 512-bit vector
+constexpr __mmask8 LANES8 = 0xFF;
+
+/// Mask selecting every double lane of a 256-bit half
+constexpr __mmask8 LANES4 = 0x0F;
+
+__attribute__((target("avx512f"))) Range columnRangeAVX512(const double *a, const double *b, size_t begin,
+                                                           size_t end) noexcept
+{
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    size_t i = begin;
+    __m512d lo0 = _mm512_set1_pd(inf), lo1 = lo0;
+    __m512d hi0 = _mm512_set1_pd(-inf), hi1 = hi0;
+    for (; i + 16 <= end; i += 16)
+    {
+        __m512d a0 = _mm512_load_pd(a + i), a1 = _mm512_load_pd(a + i + 8);
+        __m512d b0 = _mm512_load_pd(b + i), b1 = _mm512_load_pd(b + i + 8);
+        lo0 = _mm512_maskz_min_pd(LANES8, b0, _mm512_maskz_min_pd(LANES8, a0, lo0));
+        lo1 = _mm512_maskz_min_pd(LANES8, b1, _mm512_maskz_min_pd(LANES8, a1, lo1));
+        hi0 = _mm512_maskz_max_pd(LANES8, b0, _mm512_maskz_max_pd(LANES8, a0, hi0));
+        hi1 = _mm512_maskz_max_pd(LANES8, b1, _mm512_maskz_max_pd(LANES8, a1, hi1));
+    }
+    // Halves go to the AVX2 reduction, _mm512_reduce_* of GCC reads undefined lanes as well
+    __m512d lo8 = _mm512_maskz_min_pd(LANES8, lo0, lo1), hi8 = _mm512_maskz_max_pd(LANES8, hi0, hi1);
+    __m256d lo4 =
+        _mm256_min_pd(_mm512_maskz_extractf64x4_pd(LANES4, lo8, 0), _mm512_maskz_extractf64x4_pd(LANES4, lo8, 1));
+    __m256d hi4 =
+        _mm256_max_pd(_mm512_maskz_extractf64x4_pd(LANES4, hi8, 0), _mm512_maskz_extractf64x4_pd(LANES4, hi8, 1));
+    return scalarRange(a, b, i, end, reduceRange(lo4, hi4));
+}
+
+__attribute__((target("avx512f"))) void transformColumnAVX512(double *column, size_t begin, size_t end, double m,
+                                                              double t, double s) noexcept
+{
+    size_t i = begin;
+    __m512d mv = _mm512_set1_pd(m), tv = _mm512_set1_pd(t), sv = _mm512_set1_pd(s);
+    for (; i + 8 <= end; i += 8)
+    {
+        __m512d v = _mm512_load_pd(column + i);
+        _mm512_store_pd(column + i, _mm512_mul_pd(_mm512_add_pd(_mm512_mul_pd(v, mv), tv), sv));
+    }
+    scalarTransform(column, i, end, m, t, s);
+}
+
+__attribute__((target("avx512f"))) uint32_t intersectLinesAVX512(const double *a, const double *b, const double *c,
+                                                                 const double *tol, size_t n, double la, double lb,
+                                                                 double lc, double *x, double *y) noexcept
+{
+    __m512d lav = _mm512_set1_pd(la), lbv = _mm512_set1_pd(lb), lcv = _mm512_set1_pd(lc);
+    // _mm512_andnot_pd needs AVX512DQ, the sign is cleared as an integer
+    __m512i sign = _mm512_castpd_si512(_mm512_set1_pd(-0.0));
+    uint32_t parallel = 0;
+    size_t i = 0;
+    for (; i + 4 < n; i += 8)
+    {
+        __m512d av = _mm512_loadu_pd(a + i), bv = _mm512_loadu_pd(b + i), cv = _mm512_loadu_pd(c + i);
+        __m512d d = _mm512_sub_pd(_mm512_mul_pd(av, lbv), _mm512_mul_pd(lav, bv));
+        __m512d abs = _mm512_castsi512_pd(_mm512_maskz_andnot_epi64(LANES8, sign, _mm512_castpd_si512(d)));
+        parallel |= uint32_t(_mm512_cmp_pd_mask(abs, _mm512_loadu_pd(tol + i), _CMP_LE_OQ)) << i;
+        __m512d dx = _mm512_sub_pd(_mm512_mul_pd(bv, lcv), _mm512_mul_pd(lbv, cv));
+        __m512d dy = _mm512_sub_pd(_mm512_mul_pd(cv, lav), _mm512_mul_pd(lcv, av));
+        _mm512_storeu_pd(x + i, _mm512_div_pd(dx, d));
+        _mm512_storeu_pd(y + i, _mm512_div_pd(dy, d));
+    }
+    // Four lines or less left, e.g. the sides of a rectangle: half a vector is faster
+    if (i < n)
+    {
+        parallel |= intersectFour(a + i, b + i, c + i, tol + i, la, lb, lc, x + i, y + i) << i;
+    }
+    uint32_t valid = n == 32 ? ~uint32_t(0) : (uint32_t(1) << n) - 1;
+    return ~parallel & valid;
+}
+
+#endif
+
+/// Kernels of every instruction set, indexed by cpu_dispatch::Isa
+const std::array<cpu_dispatch::Kernels, cpu_dispatch::ISA_COUNT> TABLE = {{
+    {columnRangeScalar, transformColumnScalar, intersectLinesScalar},
+#ifdef HATCH_X86
+    {columnRangeSSE2, transformColumnSSE2, intersectLinesSSE2},
+    {columnRangeAVX2, transformColumnAVX2, intersectLinesAVX2},
+    {columnRangeAVX512, transformColumnAVX512, intersectLinesAVX512},
+#else
+    // Never selected, supported() is false
+    {columnRangeScalar, transformColumnScalar, intersectLinesScalar},
+    {columnRangeScalar, transformColumnScalar, intersectLinesScalar},
+    {columnRangeScalar, transformColumnScalar, intersectLinesScalar},
+#endif
+}};
+
+/// Names of instruction sets, indexed by cpu_dispatch::Isa
+const std::array<const char *, cpu_dispatch::ISA_COUNT> NAMES = {"scalar", "sse2", "avx2", "avx512"};
+
+} // namespace
+
+namespace cpu_dispatch
+{
+
+bool supported(Isa isa) noexcept
+{
+    switch (isa)
+    {
+    case SCALAR:
+        return true;
+#ifdef HATCH_X86
+    case SSE2:
+        return __builtin_cpu_supports("sse2");
+    case AVX2:
+        return __builtin_cpu_supports("avx2");
+    case AVX512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return false;
+    }
+}
+
+Isa bestIsa() noexcept
+{
+    for (Isa isa : {AVX512, AVX2, SSE2})
+    {
+        if (supported(isa))
+        {
+            return isa;
+        }
+    }
+    return SCALAR;
+}
+
+Isa activeIsa() noexcept
+{
+    int isa = active.load(std::memory_order_relaxed);
+    if (isa < 0)
+    {
+        // Racing first calls compute the same value
+        isa = bestIsa();
+        active.store(isa, std::memory_order_relaxed);
+    }
+    return static_cast<Isa>(isa);
+}
+
+void selectIsa(Isa isa)
+{
+    if (!supported(isa))
+    {
+        throw std::invalid_argument("Instruction set " + isaName(isa) + " is not supported by this CPU");
+    }
+    active.store(isa, std::memory_order_relaxed);
+}
+
+const Kernels &kernels() noexcept
+{
+    return TABLE[activeIsa()];
+}
+
+const Kernels &kernelsFor(Isa isa) noexcept
+{
+    return TABLE[isa];
+}
+
+std::string isaName(Isa isa)
+{
+    return NAMES[isa];
+}
+
+Isa parseIsa(const std::string &name)
+{
+    for (size_t i = 0; i < ISA_COUNT; ++i)
+    {
+        if (name == NAMES[i])
+        {
+            return static_cast<Isa>(i);
+        }
+    }
+    throw std::invalid_argument("Unknown instruction set: " + name);
+}
+
+} // namespace cpu_dispatch
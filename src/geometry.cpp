@@ -6,10 +6,26 @@
  */
 
 #include "geometry.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include <unistd.h>
+
+#include "cpu_dispatch.h"
+#include "metrics.h"
+
 namespace geometry
 {
 
@@ -23,10 +39,19 @@ Vector Vector::operator*(double c) const noexcept
     return Vector(x * c, y * c);
 }
 
-std::vector<Segment> Rectangle::toSegments() const noexcept
+namespace
 {
-    std::vector<Segment> res;
+
+/**
+ * @brief Appends the four boundary segments of a rectangle
+ * @param rect Rectangle
+ * @param res Container to append to
+ */
+template <typename Container> void appendEdges(const Rectangle &rect, Container &res)
+{
+    const auto &points = rect.points;
     size_t size = points.size(); // 4
+    res.reserve(res.size() + size);
 
     // Create segment from last point to first point to close the rectangle
     res.emplace_back(points[0], points[size - 1]);
@@ -36,6 +61,454 @@ std::vector<Segment> Rectangle::toSegments() const noexcept
     {
         res.emplace_back(points[i], points[i + 1]);
     }
+}
+
+/// Whether generateHatch() takes the fast path for axis-aligned rectangles
+std::atomic<bool> fastPath{true};
+
+/**
+ * @brief Checks whether two doubles have the same bits
+ * @param l Left value
+ * @param r Right value
+ * @return true if identical, including the sign of zero
+ */
+bool sameBits(double l, double r) noexcept
+{
+    return std::bit_cast<uint64_t>(l) == std::bit_cast<uint64_t>(r);
+}
+
+/**
+ * @brief Finds the two points of a hatch line farthest apart
+ * @param points Intersections of the line with all four rectangle sides
+ * @return Indices i < j of the first pair with the largest distance, (0, 0)
+ *         if all points coincide
+ */
+std::pair<size_t, size_t> farthestPair(const Point *points) noexcept
+{
+    size_t farthest1 = 0, farthest2 = 0;
+    double maxDistance2 = 0;
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        for (size_t j = i + 1; j < 4; j++)
+        {
+            double d = distance2(points[i], points[j]);
+
+            if (maxDistance2 < d)
+            {
+                maxDistance2 = d;
+                farthest1 = i;
+                farthest2 = j;
+            }
+        }
+    }
+    return {farthest1, farthest2};
+}
+
+/**
+ * @class AxisCrossings
+ * @brief Hatch segments of a rectangle with axis-parallel sides
+ *
+ * A side parallel to an axis has a == 0 or b == 0, so one numerator of its
+ * crossing is the same on every line of a direction and its quotient is
+ * reused until the numerator bits change; a side whose operands equal
+ * those of an earlier one, e.g. the opposite side at 0 degrees, takes its
+ * result. Sides parallel to the hatch are left out once per direction and
+ * the crossings stay in registers. The operations that remain are those of
+ * the general path, so the segments are bit-identical.
+ */
+class AxisCrossings
+{
+  public:
+    /**
+     * @brief Prepares the fast path if it applies
+     * @param shape Rectangle with axis-parallel sides, outlives the result
+     * @param hatch First hatch line
+     * @return Prepared crossings, empty if the hatch crosses other than two
+     *         or four sides
+     */
+    static std::optional<AxisCrossings> prepare(const PreparedShape &shape, const Line &hatch) noexcept
+    {
+        // Parallel sides stay parallel in both directions, the count is fixed
+        AxisCrossings crossings(shape.edges());
+        crossings.turn(hatch);
+        if (crossings.crossingCount != 2 && crossings.crossingCount != 4)
+        {
+            return std::nullopt;
+        }
+        return crossings;
+    }
+
+    /**
+     * @brief Finds the hatch segment on a line
+     * @param hatch Hatch line
+     * @param first Receives the first end of the segment
+     * @param second Receives the second end of the segment
+     * @return true if the line crosses the rectangle, as the general path decides
+     */
+    bool cross(const Line &hatch, Point &first, Point &second) noexcept
+    {
+        if (!sameBits(hatch.a, la) || !sameBits(hatch.b, lb))
+        {
+            turn(hatch);
+        }
+
+        std::array<Point, 4> points;
+        for (size_t k = 0; k < crossingCount; k++)
+        {
+            Side &side = state[crossing[k]];
+            double x = side.twinX < k ? points[side.twinX].x
+                                      : side.x.divide(side.b * hatch.c - side.lbc, side.d);
+            double y = side.twinY < k ? points[side.twinY].y
+                                      : side.y.divide(side.cla - hatch.c * side.a, side.d);
+            points[k] = Point(x, y);
+        }
+
+        // Keep 2 middle points, erased in the same order as by the general path
+        std::array<size_t, 4> order = {0, 1, 2, 3};
+        if (crossingCount == 4)
+        {
+            auto [farthest1, farthest2] = farthestPair(points.data());
+            std::copy(order.begin() + farthest2 + 1, order.end(), order.begin() + farthest2);
+            std::copy(order.begin() + farthest1 + 1, order.end() - 1, order.begin() + farthest1);
+        }
+        first = points[order[0]];
+        second = points[order[1]];
+
+        // The side the first point was found on is the likeliest to hold it
+        size_t own = crossing[order[0]];
+        if (isInSegment(first, sides[own]))
+        {
+            return true;
+        }
+        for (size_t i = 0; i < sides.size(); i++)
+        {
+            if (i != own && isInSegment(first, sides[i]))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+  private:
+    /**
+     * @struct Quotient
+     * @brief Division by a fixed determinant remembering its last result
+     */
+    struct Quotient
+    {
+        double numerator = 0; ///< Last numerator
+        double value = 0;     ///< Last numerator divided by the determinant
+
+        /**
+         * @brief Divides, skipping the division for a repeated numerator
+         * @param n Numerator
+         * @param d Determinant, the same since the last reset
+         * @return n / d
+         */
+        double divide(double n, double d) noexcept
+        {
+            if (!sameBits(n, numerator))
+            {
+                numerator = n;
+                value = n / d;
+            }
+            return value;
+        }
+    };
+
+    /**
+     * @struct Side
+     * @brief Side line with the terms fixed for the current direction
+     */
+    struct Side
+    {
+        double a = 0;     ///< First coefficient of the side line
+        double b = 0;     ///< Second coefficient of the side line
+        double c = 0;     ///< Free term of the side line
+        double d = 0;     ///< Determinant with the hatch lines
+        double lbc = 0;   ///< Product lb * c
+        double cla = 0;   ///< Product c * la
+        Quotient x;       ///< Division of the x numerator
+        Quotient y;       ///< Division of the y numerator
+        size_t twinX = 0; ///< Earlier crossing with the same x operands, own position if none
+        size_t twinY = 0; ///< Earlier crossing with the same y operands, own position if none
+    };
+
+    /**
+     * @brief Copies the side lines
+     * @param sides Sides of the rectangle, four of them
+     */
+    explicit AxisCrossings(std::span<const Segment> sides) noexcept : sides(sides)
+    {
+        for (size_t i = 0; i < state.size(); i++)
+        {
+            state[i].a = sides[i].line.a;
+            state[i].b = sides[i].line.b;
+            state[i].c = sides[i].line.c;
+        }
+    }
+
+    /**
+     * @brief Recomputes the terms fixed for a hatch direction
+     * @param hatch Hatch line of the direction
+     */
+    void turn(const Line &hatch) noexcept
+    {
+        la = hatch.a;
+        lb = hatch.b;
+        crossingCount = 0;
+        for (size_t i = 0; i < state.size(); i++)
+        {
+            Side &side = state[i];
+            // Same operations as intersectLines()
+            side.d = side.a * lb - la * side.b;
+            if (std::abs(side.d) <= parallelTolerance(sides[i].line, hatch))
+            {
+                continue;
+            }
+            side.lbc = lb * side.c;
+            side.cla = side.c * la;
+            side.x = {0, 0.0 / side.d};
+            side.y = {0, 0.0 / side.d};
+            side.twinX = side.twinY = crossingCount;
+            for (size_t k = crossingCount; k-- > 0;)
+            {
+                const Side &other = state[crossing[k]];
+                bool sameD = sameBits(other.d, side.d);
+                if (sameD && sameBits(other.b, side.b) && sameBits(other.lbc, side.lbc))
+                {
+                    side.twinX = k;
+                }
+                if (sameD && sameBits(other.a, side.a) && sameBits(other.cla, side.cla))
+                {
+                    side.twinY = k;
+                }
+            }
+            crossing[crossingCount++] = i;
+        }
+    }
+
+    std::span<const Segment> sides;                       ///< Sides of the rectangle
+    std::array<Side, 4> state;                            ///< Side lines and their fixed terms
+    std::array<size_t, 4> crossing{};                     ///< Indices of sides not parallel to the hatch
+    size_t crossingCount = 0;                             ///< Number of such sides
+    double la = std::numeric_limits<double>::quiet_NaN(); ///< First coefficient of the current direction
+    double lb = std::numeric_limits<double>::quiet_NaN(); ///< Second coefficient of the current direction
+};
+
+/**
+ * @brief Builds the boundary segments of a rectangle
+ * @param rect Rectangle
+ * @return Segments in the order of Rectangle::toSegments()
+ */
+std::array<Segment, 4> edgesOf(const Rectangle &rect) noexcept
+{
+    const auto &points = rect.points;
+    return {Segment(points[0], points[3]), Segment(points[0], points[1]), Segment(points[1], points[2]),
+            Segment(points[2], points[3])};
+}
+
+/**
+ * @brief Finds why a rectangle can't be hatched
+ * @param rect Rectangle
+ * @return Error message, null if the rectangle is valid
+ */
+const char *rectangleError(const Rectangle &rect) noexcept
+{
+    const auto &points = rect.points;
+    // Area is taken over vectors from the first corner, absolute coordinates
+    // far from the origin would cancel it out
+    double area2 = 0;
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        const Point &p = points[i];
+        const Point &next = points[(i + 1) % points.size()];
+        if (!std::isfinite(p.x) || !std::isfinite(p.y))
+        {
+            return "Rectangle coordinates must be finite";
+        }
+        if (distance2(p, next) == 0)
+        {
+            return "Rectangle has coincident corners";
+        }
+        area2 += crossProduct(Vector(points.front(), p), Vector(points.front(), next));
+    }
+    if (area2 == 0 || !std::isfinite(area2))
+    {
+        return "Rectangle is degenerate";
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Validates the hatch parameters that don't depend on the rectangle
+ * @param angle Angle of hatch lines in degrees
+ * @param step Distance between hatch lines
+ * @throw std::invalid_argument if step or angle are invalid
+ */
+void validateParameters(double angle, double step)
+{
+    if (!std::isfinite(step) || step <= 0)
+    {
+        throw std::invalid_argument("Hatch step must be a positive finite number");
+    }
+    if (!std::isfinite(angle))
+    {
+        throw std::invalid_argument("Hatch angle must be finite");
+    }
+}
+
+/**
+ * @brief Validates the hatch step against the rectangle coordinates
+ * @param rect Valid rectangle
+ * @param step Valid distance between hatch lines
+ * @throw std::invalid_argument if consecutive hatch lines would round to the same line
+ */
+void validateStep(const Rectangle &rect, double step)
+{
+    double magnitude = 0;
+    for (const auto &p : rect.points)
+    {
+        magnitude = std::max({magnitude, std::abs(p.x), std::abs(p.y)});
+    }
+    if (step < magnitude * RELATIVE_EPS)
+    {
+        throw std::invalid_argument("Hatch step is too small for the rectangle coordinates");
+    }
+}
+
+/**
+ * @brief Projects the corners of a rectangle onto a hatch normal
+ * @param rect Rectangle
+ * @param unitNorm Unit hatch normal
+ * @param lo Receives the smallest offset relative to the first corner
+ * @param hi Receives the largest offset relative to the first corner
+ */
+void projectCorners(const Rectangle &rect, const Vector &unitNorm, double &lo, double &hi) noexcept
+{
+    lo = 0, hi = 0;
+    for (const auto &p : rect.points)
+    {
+        double proj = dotProduct(Vector(rect.points.front(), p), unitNorm);
+        lo = std::min(lo, proj);
+        hi = std::max(hi, proj);
+    }
+}
+
+/**
+ * @brief Projects the corners of a rectangle onto the hatch normal of an angle
+ * @param rect Rectangle
+ * @param angle Hatch angle in degrees
+ * @return Sine, cosine and corner offsets relative to the first corner
+ */
+PreparedShape::Projection projectionOf(const Rectangle &rect, double angle) noexcept
+{
+    double rad = angle * M_PI / 180.0;
+    PreparedShape::Projection projection{.angle = angle, .sin = std::sin(rad), .cos = std::cos(rad), .lo = 0, .hi = 0};
+    projectCorners(rect, Vector(projection.sin, projection.cos), projection.lo, projection.hi);
+    return projection;
+}
+
+/**
+ * @brief Counts hatch lines between corner offsets
+ * @param lo Smallest corner offset along the hatch normal
+ * @param hi Largest corner offset along the hatch normal
+ * @param step Distance between hatch lines
+ * @return Number of lines strictly inside (lo, hi), lines are at k * step
+ */
+size_t lineCount(double lo, double hi, double step) noexcept
+{
+    step = std::abs(step);
+    if (!(step > 0) || !std::isfinite(hi - lo))
+    {
+        return 0;
+    }
+
+    // Lines strictly inside (lo, hi)
+    double kMin = std::floor(lo / step) + 1;
+    double kMax = std::ceil(hi / step) - 1;
+    if (kMax < kMin)
+    {
+        return 0;
+    }
+    double count = kMax - kMin + 1;
+    return count < double(std::numeric_limits<size_t>::max()) ? static_cast<size_t>(count)
+                                                                : std::numeric_limits<size_t>::max();
+}
+
+/**
+ * @brief Checks a line count against limits
+ * @param lines Number of hatch lines
+ * @param limits Work budget
+ * @return Upper bound of the number of segments, see hatchSegmentBound()
+ * @throw HatchLimitExceeded if lines is over limits.maxSegments
+ */
+size_t checkLines(size_t lines, const HatchLimits &limits)
+{
+    if (limits.maxSegments != 0 && lines > limits.maxSegments)
+    {
+        throw HatchLimitExceeded("Hatch needs " + std::to_string(lines) + " segments, limit is " +
+                                 std::to_string(limits.maxSegments));
+    }
+    return lines > std::numeric_limits<size_t>::max() - 2 ? std::numeric_limits<size_t>::max() : lines + 2;
+}
+
+/**
+ * @brief Returns the size of physical memory
+ * @return Bytes, the largest size_t if unknown
+ */
+size_t physicalBytes() noexcept
+{
+    static const size_t bytes = [] {
+        long pages = sysconf(_SC_PHYS_PAGES);
+        long pageSize = sysconf(_SC_PAGESIZE);
+        if (pages <= 0 || pageSize <= 0)
+        {
+            return std::numeric_limits<size_t>::max();
+        }
+        size_t total = static_cast<size_t>(pages);
+        size_t page = static_cast<size_t>(pageSize);
+        return total > std::numeric_limits<size_t>::max() / page ? std::numeric_limits<size_t>::max() : total * page;
+    }();
+    return bytes;
+}
+
+/**
+ * @brief Reserves room for the segments of a hatch in a vector
+ * @param out Vector the segments will be appended to
+ * @param bound Upper bound of the number of segments, see checkHatch()
+ * @throw HatchLimitExceeded if the segments can't fit in memory
+ */
+template <typename Vec> void reserveVector(Vec &out, size_t bound)
+{
+    reserveSegments(bound, sizeof(Segment), out.max_size() - out.size(), [&] { out.reserve(out.size() + bound); });
+}
+
+} // namespace
+
+void setFastPath(bool enabled) noexcept
+{
+    fastPath.store(enabled, std::memory_order_relaxed);
+}
+
+bool fastPathEnabled() noexcept
+{
+    return fastPath.load(std::memory_order_relaxed);
+}
+
+std::vector<Segment> Rectangle::toSegments() const noexcept
+{
+    std::vector<Segment> res;
+    appendEdges(*this, res);
+    return res;
+}
+
+std::pmr::vector<Segment> Rectangle::toSegments(std::pmr::memory_resource *mr) const
+{
+    std::pmr::vector<Segment> res(mr);
+    appendEdges(*this, res);
     return res;
 }
 
@@ -59,13 +532,18 @@ Vector normOf(const Line &l) noexcept
     return Vector(l.a, l.b);
 }
 
+double parallelTolerance(const Line &l1, const Line &l2) noexcept
+{
+    return EPS * std::max(std::abs(l1.a), std::abs(l1.b)) * std::max(std::abs(l2.a), std::abs(l2.b));
+}
+
 bool isLinesSameOrParallel(const Line &l1, const Line &l2) noexcept
 {
     Vector norm1 = normOf(l1);
     Vector norm2 = normOf(l2);
 
     // Lines are parallel if their normal vectors are parallel
-    return std::abs(crossProduct(norm1, norm2)) < EPS;
+    return std::abs(crossProduct(norm1, norm2)) <= parallelTolerance(l1, l2);
 }
 
 Point linesIntersection(const Line &l1, const Line &l2) noexcept
@@ -86,78 +564,308 @@ bool isInSegment(const Point &p, const Segment &s) noexcept
     Vector AP(s.a, p);
     Vector PB(p, s.b);
 
+    // The cross product is the distance to the line times the length
+    double length = std::max(std::abs(AB.x), std::abs(AB.y));
+    double magnitude = std::max({std::abs(s.a.x), std::abs(s.a.y), std::abs(s.b.x), std::abs(s.b.y)});
+    double tolerance = std::max(EPS * std::min(length * length, 1.0), length * magnitude * RELATIVE_EPS);
+
     // Point is on segment if:
     // 1. Cross product is zero (point lies on the line)
     // 2. Dot products are positive (point is between endpoints)
-    return std::abs(crossProduct(AB, AP)) < EPS && dotProduct(AB, AP) > 0 && dotProduct(AB, PB) > 0;
+    return std::abs(crossProduct(AB, AP)) < tolerance && dotProduct(AB, AP) > 0 && dotProduct(AB, PB) > 0;
 }
 
-std::vector<Segment> generateHatch(const Rectangle &rect, double angle, double step) noexcept
+void validateHatch(const Rectangle &rect, double angle, double step)
 {
-    // Convert angle from degrees to radians
-    double rad = angle * M_PI / 180.0;
+    validateParameters(angle, step);
+    if (const char *error = rectangleError(rect))
+    {
+        throw std::invalid_argument(error);
+    }
+    validateStep(rect, step);
+}
+
+PreparedShape::PreparedShape(const Rectangle &rect, std::span<const double> angles)
+    : shape(rect), sides(edgesOf(rect)), aligned(true), isConvex(true), lower(rect.points.front()),
+      upper(rect.points.front()), invalid(rectangleError(rect))
+{
+    const auto &points = rect.points;
+    double turn = 0;
+    for (size_t i = 0; i < sides.size(); i++)
+    {
+        lines.a[i] = sides[i].line.a;
+        lines.b[i] = sides[i].line.b;
+        lines.c[i] = sides[i].line.c;
+        aligned = aligned && (sides[i].line.a == 0 || sides[i].line.b == 0);
+
+        // Consecutive turns of a convex polygon have one sign
+        const Point &p = points[i];
+        const Point &next = points[(i + 1) % points.size()];
+        double cross = crossProduct(Vector(p, next), Vector(next, points[(i + 2) % points.size()]));
+        isConvex = isConvex && !(cross * turn < 0);
+        turn = cross != 0 ? cross : turn;
+
+        lower = Point(std::min(lower.x, p.x), std::min(lower.y, p.y));
+        upper = Point(std::max(upper.x, p.x), std::max(upper.y, p.y));
+    }
+
+    projections.reserve(angles.size());
+    for (double angle : angles)
+    {
+        // Not finite angles are refused by validate(), and would break the ordering
+        if (std::isfinite(angle))
+        {
+            projections.push_back(projectionOf(rect, angle));
+        }
+    }
+    std::sort(projections.begin(), projections.end(),
+              [](const Projection &l, const Projection &r) { return l.angle < r.angle; });
+}
+
+PreparedShape::Projection PreparedShape::project(double angle) const noexcept
+{
+    auto cached = std::lower_bound(projections.begin(), projections.end(), angle,
+                                   [](const Projection &p, double a) { return p.angle < a; });
+    if (cached != projections.end() && cached->angle == angle)
+    {
+        return *cached;
+    }
+
+    return projectionOf(shape, angle);
+}
+
+void PreparedShape::validate(double angle, double step) const
+{
+    validateParameters(angle, step);
+    if (invalid != nullptr)
+    {
+        throw std::invalid_argument(invalid);
+    }
+    validateStep(shape, step);
+}
+
+size_t checkHatch(const Rectangle &rect, double angle, double step, const HatchLimits &limits)
+{
+    validateHatch(rect, angle, step);
+    return checkLines(hatchLineCount(rect, angle, step), limits);
+}
+
+size_t checkHatch(const PreparedShape &shape, double angle, double step, const HatchLimits &limits)
+{
+    shape.validate(angle, step);
+    return checkLines(hatchLineCount(shape, angle, step), limits);
+}
+
+void reserveSegments(size_t bound, size_t segmentBytes, size_t room, const std::function<void()> &reserve)
+{
+    std::string error = "Hatch needs up to " + std::to_string(bound) + " segments, they don't fit in memory";
+    if (bound > room || bound > physicalBytes() / segmentBytes)
+    {
+        throw HatchLimitExceeded(error);
+    }
+    try
+    {
+        reserve();
+    }
+    catch (const std::bad_alloc &)
+    {
+        throw HatchLimitExceeded(error);
+    }
+}
+
+std::vector<Segment> generateHatch(const Rectangle &rect, double angle, double step, const HatchLimits &limits,
+                                   progress::Reporter *progress)
+{
+    return generateHatch(PreparedShape(rect), angle, step, limits, progress);
+}
+
+std::vector<Segment> generateHatch(const PreparedShape &shape, double angle, double step, const HatchLimits &limits,
+                                   progress::Reporter *progress)
+{
+    std::vector<Segment> res;
+    // Reserve the exact upper bound, so the result never reallocates while growing
+    reserveVector(res, checkHatch(shape, angle, step, limits));
+    generateHatch(shape, angle, step, [&res](const Segment &s) { res.push_back(s); }, limits, {}, progress);
+    return res;
+}
+
+std::pmr::vector<Segment> generateHatch(const Rectangle &rect, double angle, double step,
+                                        std::pmr::memory_resource *mr, const HatchLimits &limits)
+{
+    std::pmr::vector<Segment> res(mr);
+    reserveVector(res, checkHatch(rect, angle, step, limits));
+    generateHatch(rect, angle, step, [&res](const Segment &s) { res.push_back(s); }, limits, {}, nullptr, mr);
+    return res;
+}
+
+RunStatus generateHatch(const Rectangle &rect, double angle, double step, std::pmr::vector<Segment> &out,
+                        const Cancellation &cancel, const HatchLimits &limits, progress::Reporter *progress)
+{
+    reserveVector(out, checkHatch(rect, angle, step, limits));
+    return generateHatch(rect, angle, step, [&out](const Segment &s) { out.push_back(s); }, limits, cancel,
+                         progress, out.get_allocator().resource());
+}
+
+RunStatus generateHatch(const Rectangle &rect, double angle, double step, const SegmentSink &sink,
+                        const HatchLimits &limits, const Cancellation &cancel, progress::Reporter *progress,
+                        std::pmr::memory_resource *scratch)
+{
+    return generateHatch(PreparedShape(rect), angle, step, sink, limits, cancel, progress, scratch);
+}
+
+RunStatus generateHatch(const PreparedShape &shape, double angle, double step, const SegmentSink &sink,
+                        const HatchLimits &limits, const Cancellation &cancel, progress::Reporter *progress,
+                        std::pmr::memory_resource *scratch)
+{
+    shape.validate(angle, step);
+    // One projection gives both the line count and the hatch direction
+    auto projection = shape.project(angle);
+    size_t lines = checkLines(lineCount(projection.lo, projection.hi, step), limits);
+
+    // Every line is visited once, plus the starting line and a miss per direction.
+    // The slack covers rounding of the offset accumulated line by line.
+    size_t slack = lines / 1024 + 8;
+    size_t ceiling = lines > std::numeric_limits<size_t>::max() - slack ? std::numeric_limits<size_t>::max()
+                                                                         : lines + slack;
+    // Without a budget the clock is never read, small hatches in sweeps skip the call
+    auto deadline = limits.timeBudget.count() != 0 ? std::chrono::steady_clock::now() + limits.timeBudget
+                                                   : std::chrono::steady_clock::time_point{};
+    size_t iterations = 0;
+
+    // Segments emitted in total and already passed to metrics and the progress reporter
+    size_t emitted = 0, reported = 0;
+    auto reportProgress = [&] {
+        metrics::hatchMetrics().segments.add(emitted - reported);
+        if (progress != nullptr)
+        {
+            progress->hatched(emitted - reported);
+        }
+        reported = emitted;
+    };
+    if (progress != nullptr)
+    {
+        progress->expect(lines);
+    }
+
+    if (auto status = cancel.poll(); status != COMPLETE)
+    {
+        return status;
+    }
 
     // Create hatch direction vector
-    Vector hatchNorm = Vector(std::sin(rad), std::cos(rad)) * step;
-    std::vector<Segment> rectSegments = rect.toSegments();
+    Vector hatchNorm = Vector(projection.sin, projection.cos) * step;
+    const Rectangle &rect = shape.rect();
+    std::span<const Segment> rectSegments = shape.edges();
     Point point = rect.points.front();
 
-    std::vector<Segment> res;
+    // Side coefficients as columns, every hatch line is intersected with all sides in one kernel call
+    const auto intersectLines = cpu_dispatch::kernels().intersectLines;
+    const auto &sides = shape.columns();
+    alignas(64) std::array<double, cpu_dispatch::BATCH_PADDING> crossX{}, crossY{};
+
+    // Tolerances of the parallel test, the same in both directions
+    alignas(64) std::array<double, cpu_dispatch::BATCH_PADDING> tolerance{};
+    for (size_t i = 0; i < rectSegments.size(); i++)
+    {
+        tolerance[i] = parallelTolerance(rectSegments[i].line, Line(hatchNorm, point));
+    }
+
+    // Axis-aligned rectangles take the fast path
+    std::optional<AxisCrossings> axis;
+    if (fastPathEnabled() && shape.axisAligned())
+    {
+        axis = AxisCrossings::prepare(shape, Line(hatchNorm, point));
+    }
+
+    // At most one intersection per rectangle side, allocated once for all lines; the fast path needs none
+    std::pmr::vector<Point> intersections(scratch);
+    if (!axis)
+    {
+        intersections.reserve(rectSegments.size());
+    }
 
     bool forward = true, isContinue = false, firstIter = true;
 
     while (forward || isContinue)
     {
+        if (++iterations > ceiling)
+        {
+            throw HatchLimitExceeded("Hatch exceeded its ceiling of " + std::to_string(ceiling) + " lines");
+        }
+        if (iterations % TIME_CHECK_INTERVAL == 0)
+        {
+            if (limits.timeBudget.count() != 0 && std::chrono::steady_clock::now() > deadline)
+            {
+                throw HatchLimitExceeded("Hatch exceeded its time budget of " +
+                                         std::to_string(limits.timeBudget.count()) + " ms");
+            }
+            reportProgress();
+            if (cancel.yield)
+            {
+                // The time budget covers this job's own work only
+                auto paused = std::chrono::steady_clock::now();
+                cancel.yield();
+                deadline += std::chrono::steady_clock::now() - paused;
+            }
+            if (auto status = cancel.poll(); status != COMPLETE)
+            {
+                return status;
+            }
+        }
+
         Line hatchLine(hatchNorm, point);
         isContinue = false;
 
-        std::vector<Point> intersections;
-
-        // Find intersections with all rectangle lines
-        for (auto &segment : rectSegments)
+        if (axis)
         {
-            if (!isLinesSameOrParallel(segment.line, hatchLine))
+            Point first, second;
+            if (axis->cross(hatchLine, first, second))
             {
-                intersections.emplace_back(linesIntersection(segment.line, hatchLine));
+                isContinue = true;
+
+                sink(Segment(first, second));
+                ++emitted;
             }
         }
-
-        // If hatch line is not parallel to any rectangle segments
-        // Otherwise there are 2 intersections
-        if (intersections.size() == 4)
+        else
         {
-            size_t farthest1, farthest2;
-            double maxDistance2 = 0;
+            intersections.clear();
 
-            for (size_t i = 0; i < intersections.size(); i++)
+            // Find intersections with all rectangle lines not parallel to the hatch line
+            uint32_t crossing = intersectLines(sides.a.data(), sides.b.data(), sides.c.data(), tolerance.data(),
+                                               rectSegments.size(), hatchLine.a, hatchLine.b, hatchLine.c,
+                                               crossX.data(), crossY.data());
+            for (size_t i = 0; i < rectSegments.size(); i++)
             {
-                for (size_t j = i + 1; j < intersections.size(); j++)
+                if ((crossing & (uint32_t(1) << i)) != 0)
                 {
-                    double d = distance2(intersections[i], intersections[j]);
-
-                    if (maxDistance2 < d)
-                    {
-                        maxDistance2 = d;
-                        farthest1 = i;
-                        farthest2 = j;
-                    }
+                    intersections.emplace_back(crossX[i], crossY[i]);
                 }
             }
 
-            // Keep 2 middle points
-            intersections.erase(intersections.begin() + farthest2);
-            intersections.erase(intersections.begin() + farthest1);
-        }
+            // If hatch line is not parallel to any rectangle segments
+            // Otherwise there are 2 intersections
+            if (intersections.size() == 4)
+            {
+                auto [farthest1, farthest2] = farthestPair(intersections.data());
 
-        // Check if intersection points are valid (lie on segments)
-        for (auto &segment : rectSegments)
-        {
-            if (isInSegment(intersections.front(), segment))
+                // Keep 2 middle points
+                intersections.erase(intersections.begin() + farthest2);
+                intersections.erase(intersections.begin() + farthest1);
+            }
+
+            // Check if intersection points are valid (lie on segments),
+            // a line crossing fewer than 2 sides misses the rectangle
+            for (auto &segment : rectSegments)
             {
-                isContinue = true;
+                if (intersections.size() >= 2 && isInSegment(intersections.front(), segment))
+                {
+                    isContinue = true;
 
-                res.emplace_back(intersections[0], intersections[1]);
-                break;
+                    sink(Segment(intersections[0], intersections[1]));
+                    ++emitted;
+                    break;
+                }
             }
         }
 
@@ -173,8 +881,97 @@ std::vector<Segment> generateHatch(const Rectangle &rect, double angle, double s
         firstIter = false;
         point = point + hatchNorm;
     }
+    reportProgress();
+    return COMPLETE;
+}
 
-    return res;
+size_t hatchLineCount(const Rectangle &rect, double angle, double step) noexcept
+{
+    // Offsets of the corners along the hatch normal, lines are at k * step
+    auto projection = projectionOf(rect, angle);
+    return lineCount(projection.lo, projection.hi, step);
+}
+
+size_t hatchLineCount(const PreparedShape &shape, double angle, double step) noexcept
+{
+    auto projection = shape.project(angle);
+    return lineCount(projection.lo, projection.hi, step);
+}
+
+size_t hatchSegmentBound(const Rectangle &rect, double angle, double step) noexcept
+{
+    size_t lines = hatchLineCount(rect, angle, step);
+    return lines > std::numeric_limits<size_t>::max() - 2 ? std::numeric_limits<size_t>::max() : lines + 2;
+}
+
+double hatchTotalLength(const Rectangle &rect, double angle, double step) noexcept
+{
+    double rad = angle * M_PI / 180.0;
+    Vector unitNorm(std::sin(rad), std::cos(rad));
+    Vector unitDir(unitNorm.y, -unitNorm.x);
+    step = std::abs(step);
+
+    // Corners in the hatch frame: t across the lines, s along them
+    const auto &points = rect.points;
+    std::array<double, 4> t, s;
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        Vector v(points.front(), points[i]);
+        t[i] = dotProduct(v, unitNorm);
+        s[i] = dotProduct(v, unitDir);
+    }
+
+    std::array<double, 4> breaks = t;
+    std::sort(breaks.begin(), breaks.end());
+    double lo = breaks.front(), hi = breaks.back();
+    if (!(step > 0) || !std::isfinite(hi - lo))
+    {
+        return 0;
+    }
+
+    // Chord length of the line at offset u: spread of its crossings with the edges
+    auto chord = [&](double u) {
+        double sMin = std::numeric_limits<double>::infinity();
+        double sMax = -sMin;
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            size_t j = (i + 1) % points.size();
+            if ((t[i] - u) * (t[j] - u) > 0)
+            {
+                continue;
+            }
+            double si = s[i], sj = s[j];
+            if (t[i] != t[j])
+            {
+                si = sj = s[i] + (s[j] - s[i]) * (u - t[i]) / (t[j] - t[i]);
+            }
+            sMin = std::min({sMin, si, sj});
+            sMax = std::max({sMax, si, sj});
+        }
+        return sMax > sMin ? sMax - sMin : 0.0;
+    };
+
+    // Lines strictly inside (lo, hi), as in hatchLineCount()
+    double kMin = std::floor(lo / step) + 1;
+    double kMax = std::ceil(hi / step) - 1;
+
+    // Each piece (a, b] between corner offsets holds lines kA..kB of linear chord length
+    double total = 0;
+    for (size_t i = 0; i + 1 < breaks.size(); i++)
+    {
+        double a = breaks[i], b = breaks[i + 1];
+        double kA = std::max(kMin, std::floor(a / step) + 1);
+        double kB = std::min(kMax, std::floor(b / step));
+        if (b <= a || kB < kA)
+        {
+            continue;
+        }
+        double n = kB - kA + 1;
+        double la = chord(a), slope = (chord(b) - la) / (b - a);
+        double sumOffsets = step * (kA + kB) * n / 2;
+        total += n * la + slope * (sumOffsets - n * a);
+    }
+    return total;
 }
 
 std::ostream &operator<<(std::ostream &out, const Point &p) noexcept
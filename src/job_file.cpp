@@ -0,0 +1,299 @@
+/**
+ * @file job_file.cpp
+ * @brief Implementation of job file and shape set I/O
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "job_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+
+/// Magic bytes at the start of a shape set
+constexpr char SHAPE_SET_MAGIC[8] = {'H', 'A', 'T', 'C', 'H', 'S', 'H', 'P'};
+
+/**
+ * @brief Checks if a line carries no job
+ * @param line Line of a job file
+ * @return true for blank and comment lines
+ */
+bool isSkipped(const std::string &line)
+{
+    size_t first = line.find_first_not_of(" \t\r");
+    return first == std::string::npos || line[first] == '#';
+}
+
+/**
+ * @brief Reads jobs up to a byte limit
+ * @param in Input stream positioned at a line start
+ * @param bytes Bytes to read, a line starting before the limit is read whole
+ * @param firstLine Returns the line number of the first line, called on error only
+ * @return Jobs in file order
+ * @throw std::invalid_argument with line number if a line is invalid
+ */
+std::vector<cmdline_parser::Config> readLines(std::istream &in, uint64_t bytes, const std::function<size_t()> &firstLine)
+{
+    std::vector<cmdline_parser::Config> jobs;
+    uint64_t consumed = 0;
+    size_t index = 0;
+    for (std::string line; consumed < bytes && std::getline(in, line); ++index)
+    {
+        consumed += line.size() + 1;
+        if (isSkipped(line))
+        {
+            continue;
+        }
+        try
+        {
+            jobs.push_back(job_file::parseJob(line));
+        }
+        catch (const std::exception &e)
+        {
+            throw std::invalid_argument("Job line " + std::to_string(firstLine() + index) + ": " + e.what());
+        }
+    }
+    return jobs;
+}
+
+/**
+ * @brief Counts the lines before an offset of a file
+ * @param path Path to the file
+ * @param offset Offset of a line start
+ * @return Number of line ends before the offset
+ */
+size_t countLines(const std::filesystem::path &path, uint64_t offset)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::vector<char> block(1 << 16);
+    size_t lines = 0;
+    while (offset != 0 && in)
+    {
+        in.read(block.data(), static_cast<std::streamsize>(std::min<uint64_t>(offset, block.size())));
+        auto n = static_cast<size_t>(in.gcount());
+        lines += static_cast<size_t>(std::count(block.begin(), block.begin() + n, '\n'));
+        offset -= n;
+    }
+    return lines;
+}
+
+} // namespace
+
+namespace job_file
+{
+
+cmdline_parser::Config parseJob(const std::string &line)
+{
+    std::istringstream in(line);
+    std::vector<std::string> tokens{"job"}; // argv[0] placeholder
+    for (std::string token; in >> token;)
+    {
+        tokens.push_back(std::move(token));
+    }
+
+    std::vector<char *> argv;
+    for (auto &token : tokens)
+    {
+        argv.push_back(token.data());
+    }
+    auto job = cmdline_parser::parse(static_cast<int>(argv.size()), argv.data());
+    if (job.jobs.has_value())
+    {
+        throw std::invalid_argument(cmdline_parser::JOBS_ARG_NAME + " is not allowed inside a job file");
+    }
+    if (job.memory.maxBytes != 0)
+    {
+        throw std::invalid_argument(cmdline_parser::MAX_MEMORY_ARG_NAME + " is not allowed inside a job file");
+    }
+    if (!job.memory.spillDirectory.empty())
+    {
+        throw std::invalid_argument(cmdline_parser::SPILL_DIR_ARG_NAME + " is not allowed inside a job file");
+    }
+    if (job.progress)
+    {
+        throw std::invalid_argument(cmdline_parser::PROGRESS_ARG_NAME + " is not allowed inside a job file");
+    }
+    if (job.metricsSocket.has_value() || job.metricsFile.has_value())
+    {
+        throw std::invalid_argument("Metrics arguments are not allowed inside a job file");
+    }
+    if (job.shm.has_value())
+    {
+        throw std::invalid_argument(cmdline_parser::SHM_ARG_NAME + " is not allowed inside a job file");
+    }
+    if (job.isa.has_value())
+    {
+        throw std::invalid_argument(cmdline_parser::ISA_ARG_NAME + " is not allowed inside a job file");
+    }
+    return job;
+}
+
+std::vector<cmdline_parser::Config> readJobs(std::istream &in)
+{
+    return readLines(in, std::numeric_limits<uint64_t>::max(), [] { return size_t(1); });
+}
+
+std::vector<cmdline_parser::Config> readJobs(const std::filesystem::path &path)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        throw std::runtime_error("Failed to open file: " + path.string());
+    }
+    return readJobs(in);
+}
+
+std::vector<ByteRange> splitJobs(const std::filesystem::path &path, size_t count)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        throw std::runtime_error("Failed to open file: " + path.string());
+    }
+    uint64_t size = std::filesystem::file_size(path);
+    count = std::max<size_t>(count, 1);
+
+    std::vector<ByteRange> ranges(count);
+    for (size_t i = 1; i < count; ++i)
+    {
+        // A boundary inside a line moves past its end, the line stays in the previous part
+        uint64_t boundary = std::max(size * i / count, ranges[i - 1].begin);
+        if (boundary != 0 && boundary < size)
+        {
+            in.seekg(static_cast<std::streamoff>(boundary - 1));
+            in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            boundary = in ? static_cast<uint64_t>(in.tellg()) : size;
+            in.clear();
+        }
+        ranges[i - 1].end = boundary;
+        ranges[i].begin = boundary;
+    }
+    ranges.back().end = size;
+    return ranges;
+}
+
+std::vector<cmdline_parser::Config> readJobs(const std::filesystem::path &path, const ByteRange &range)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        throw std::runtime_error("Failed to open file: " + path.string());
+    }
+    in.seekg(static_cast<std::streamoff>(range.begin));
+    return readLines(in, range.end - range.begin, [&] { return countLines(path, range.begin) + 1; });
+}
+
+void writeJob(std::ostream &out, const cmdline_parser::Config &job)
+{
+    auto precision = out.precision(std::numeric_limits<double>::max_digits10);
+
+    out << cmdline_parser::POINTS_ARG_NAME;
+    for (const auto &p : job.rect.points)
+    {
+        out << ' ' << p.x << ' ' << p.y;
+    }
+    out << ' ' << cmdline_parser::ANGLE_ARG_NAME << ' ' << job.angle;
+    out << ' ' << cmdline_parser::STEP_ARG_NAME << ' ' << job.step;
+    if (job.outSVG.has_value())
+    {
+        out << ' ' << cmdline_parser::SVG_ARG_NAME << ' ' << job.outSVG.value().string();
+    }
+    if (job.limits.maxSegments != 0)
+    {
+        out << ' ' << cmdline_parser::MAX_SEGMENTS_ARG_NAME << ' ' << job.limits.maxSegments;
+    }
+    if (job.limits.timeBudget.count() != 0)
+    {
+        out << ' ' << cmdline_parser::TIME_BUDGET_ARG_NAME << ' ' << job.limits.timeBudget.count();
+    }
+    if (job.priority != job_queue::BATCH)
+    {
+        out << ' ' << cmdline_parser::PRIORITY_ARG_NAME << " interactive";
+    }
+    if (job.deadline.count() != 0)
+    {
+        out << ' ' << cmdline_parser::DEADLINE_ARG_NAME << ' ' << job.deadline.count();
+    }
+    if (job.delay.count() != 0)
+    {
+        out << ' ' << cmdline_parser::DELAY_ARG_NAME << ' ' << job.delay.count();
+    }
+    if (job.pipelineChunk != 0)
+    {
+        out << ' ' << cmdline_parser::CHUNK_SIZE_ARG_NAME << ' ' << job.pipelineChunk;
+    }
+    out << '\n';
+
+    out.precision(precision);
+}
+
+void writeShapeSet(std::ostream &out, const std::vector<geometry::Rectangle> &shapes)
+{
+    uint32_t version = SHAPE_SET_VERSION;
+    uint32_t reserved = 0;
+    uint64_t count = shapes.size();
+
+    out.write(SHAPE_SET_MAGIC, sizeof(SHAPE_SET_MAGIC));
+    out.write(reinterpret_cast<const char *>(&version), sizeof(version));
+    out.write(reinterpret_cast<const char *>(&reserved), sizeof(reserved));
+    out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+
+    for (const auto &rect : shapes)
+    {
+        double record[8];
+        for (size_t i = 0; i < 4; ++i)
+        {
+            record[i * 2] = rect.points[i].x;
+            record[i * 2 + 1] = rect.points[i].y;
+        }
+        out.write(reinterpret_cast<const char *>(record), sizeof(record));
+    }
+}
+
+std::vector<geometry::Rectangle> readShapeSet(std::istream &in)
+{
+    char magic[sizeof(SHAPE_SET_MAGIC)];
+    uint32_t version = 0;
+    uint32_t reserved = 0;
+    uint64_t count = 0;
+
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char *>(&version), sizeof(version));
+    in.read(reinterpret_cast<char *>(&reserved), sizeof(reserved));
+    in.read(reinterpret_cast<char *>(&count), sizeof(count));
+    if (!in || std::memcmp(magic, SHAPE_SET_MAGIC, sizeof(magic)) != 0)
+    {
+        throw std::runtime_error("Not a shape set");
+    }
+    if (version != SHAPE_SET_VERSION)
+    {
+        throw std::runtime_error("Unsupported shape set version: " + std::to_string(version));
+    }
+
+    std::vector<geometry::Rectangle> shapes;
+    double record[8];
+    // Count is not trusted for reservation, the file may be truncated
+    while (shapes.size() < count && in.read(reinterpret_cast<char *>(record), sizeof(record)))
+    {
+        geometry::Rectangle &rect = shapes.emplace_back();
+        for (size_t i = 0; i < 4; ++i)
+        {
+            rect.points[i] = {record[i * 2], record[i * 2 + 1]};
+        }
+    }
+    if (shapes.size() != count)
+    {
+        throw std::runtime_error("Truncated shape set");
+    }
+    return shapes;
+}
+
+} // namespace job_file
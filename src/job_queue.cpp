@@ -0,0 +1,177 @@
+/**
+ * @file job_queue.cpp
+ * @brief Implementation of the priority job queue
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "job_queue.h"
+
+#include <algorithm>
+#include <tuple>
+
+namespace job_queue
+{
+
+bool JobQueue::Entry::operator<(const Entry &other) const noexcept
+{
+    // Earliest deadline, then largest job, then first submitted
+    return std::tie(deadline, other.work, sequence) < std::tie(other.deadline, work, other.sequence);
+}
+
+bool JobQueue::ByRelease::operator()(const Entry &l, const Entry &r) const noexcept
+{
+    return l.release != r.release ? l.release < r.release : l < r;
+}
+
+JobQueue::JobQueue(const Policy &policy) : policy(policy)
+{
+}
+
+void JobQueue::push(size_t id, Priority priority, size_t work, std::optional<Clock::time_point> deadline,
+                    Clock::time_point release)
+{
+    {
+        std::lock_guard lock(mutex);
+        pending.insert({.deadline = deadline.value_or(Clock::time_point::max()),
+                        .work = work,
+                        .sequence = submitted++,
+                        .id = id,
+                        .priority = priority,
+                        .release = release});
+    }
+    changed.notify_all();
+}
+
+void JobQueue::close()
+{
+    {
+        std::lock_guard lock(mutex);
+        closed = true;
+    }
+    changed.notify_all();
+}
+
+std::optional<Ticket> JobQueue::take()
+{
+    std::unique_lock lock(mutex);
+    for (;;)
+    {
+        auto now = Clock::now();
+        releaseDue(now);
+        for (auto priority : {INTERACTIVE, BATCH})
+        {
+            if (auto ticket = pick(priority, now); ticket.has_value())
+            {
+                return ticket;
+            }
+        }
+        if (closed && pending.empty() && std::all_of(ready.begin(), ready.end(), [](const auto &r) {
+                return r.empty();
+            }))
+        {
+            return {};
+        }
+
+        if (auto next = nextEvent(now); next == Clock::time_point::max())
+        {
+            changed.wait(lock);
+        }
+        else
+        {
+            changed.wait_until(lock, next);
+        }
+    }
+}
+
+std::optional<Ticket> JobQueue::preempt(Priority running, Clock::duration paused,
+                                        const std::function<bool(size_t)> &fits)
+{
+    // A job paused long enough runs to completion
+    if (running == INTERACTIVE || (policy.maxPaused.count() != 0 && paused >= policy.maxPaused))
+    {
+        return {};
+    }
+    std::lock_guard lock(mutex);
+    auto now = Clock::now();
+    releaseDue(now);
+    return pick(INTERACTIVE, now, false, fits);
+}
+
+void JobQueue::done(const Ticket &ticket)
+{
+    {
+        std::lock_guard lock(mutex);
+        --running[ticket.priority];
+    }
+    changed.notify_all();
+}
+
+void JobQueue::releaseDue(Clock::time_point now)
+{
+    while (!pending.empty() && pending.begin()->release <= now)
+    {
+        auto entry = pending.extract(pending.begin());
+        if (entry.value().priority == BATCH)
+        {
+            aging.insert(entry.value());
+        }
+        ready[entry.value().priority].insert(std::move(entry.value()));
+    }
+}
+
+std::optional<Ticket> JobQueue::pick(Priority priority, Clock::time_point now, bool aged,
+                                     const std::function<bool(size_t)> &fits)
+{
+    if (policy.maxRunning[priority] != 0 && running[priority] >= policy.maxRunning[priority])
+    {
+        return {};
+    }
+
+    const Entry *best = ready[priority].empty() ? nullptr : &*ready[priority].begin();
+    if (aged && priority == INTERACTIVE && policy.aging.count() != 0 && !aging.empty())
+    {
+        // The longest waiting BATCH job competes with its aging time as deadline
+        auto oldest = *aging.begin();
+        auto aged = oldest.release + policy.aging;
+        oldest.deadline = std::min(oldest.deadline, aged);
+        if (aged <= now && (best == nullptr || oldest < *best))
+        {
+            best = &*aging.begin();
+        }
+    }
+    if (best == nullptr || (fits && !fits(best->id)))
+    {
+        return {};
+    }
+
+    // Copied, best points into one of the sets it is erased from
+    Entry chosen = *best;
+    ready[chosen.priority].erase(chosen);
+    if (chosen.priority == BATCH)
+    {
+        aging.erase(chosen);
+    }
+    Ticket ticket{.id = chosen.id, .priority = priority};
+    ++running[priority];
+    return ticket;
+}
+
+Clock::time_point JobQueue::nextEvent(Clock::time_point now) const
+{
+    auto next = Clock::time_point::max();
+    if (!pending.empty())
+    {
+        next = pending.begin()->release;
+    }
+    if (policy.aging.count() != 0 && !aging.empty())
+    {
+        if (auto aged = aging.begin()->release + policy.aging; aged > now)
+        {
+            next = std::min(next, aged);
+        }
+    }
+    return next;
+}
+
+} // namespace job_queue
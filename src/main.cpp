@@ -13,17 +13,499 @@
  * parameters, and optional SVG output:
  * @code
  * ./hatch_generator --points x1 y1 x2 y2 x3 y3 x4 y4 --angle <degrees> --step <distance> [--svg <filename>]
+ * ./hatch_generator --jobs <filename> [--threads <count>] [--processes <count>]
  * @endcode
  * @author Alsu Khabibulina
  * @date 2025
  */
 
+#include <algorithm>
 #include <exception>
+#include <fstream>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include <unistd.h>
+
+#include "alloc_tracker.h"
+#include "batch.h"
 #include "cmdline_parser.h"
+#include "cpu_dispatch.h"
 #include "geometry.h"
-#include "svg_writer.h"
+#include "job_file.h"
+#include "memory_budget.h"
+#include "metrics_export.h"
+#include "process_memory.h"
+#include "progress.h"
+#include "result_cache.h"
+#include "sharding.h"
+#include "shm_ring.h"
+
+namespace
+{
+
+/**
+ * @brief Prints one hatch segment to console
+ * @param segment Segment to print
+ */
+void printSegment(const geometry::Segment &segment)
+{
+    std::cout << "Line: " << segment << std::endl;
+}
+
+/**
+ * @brief Reports memory use of the run to stderr
+ * @param what Description of the expected memory use
+ */
+void reportMemory(const std::string &what)
+{
+    std::cerr << "Memory: " << what;
+    if (auto peak = process_memory::peakResidentBytes(); peak.has_value())
+    {
+        std::cerr << ", peak RSS " << peak.value() << " bytes";
+    }
+    std::cerr << '\n';
+}
+
+/**
+ * @brief Prints a progress snapshot to stderr
+ * @param snapshot Work done so far
+ *
+ * The line is written at once, so lines of sharded workers don't interleave.
+ */
+void printProgress(const progress::Snapshot &snapshot)
+{
+    std::cerr << ("Progress: " + std::to_string(snapshot.hatchedLines) + '/' + std::to_string(snapshot.totalLines) +
+                  " lines hatched, " + std::to_string(snapshot.writtenLines) + " lines and " +
+                  std::to_string(snapshot.writtenBytes) + " bytes written\n");
+}
+
+/**
+ * @brief Runs a single job
+ * @param job Job configuration
+ * @param progress Receiver of progress, may be null
+ * @return Exit status (0 for success, 1 for error)
+ *
+ * A job predicted to exceed the memory budget is streamed: segments are
+ * printed and written to SVG as they are generated, nothing is buffered.
+ * With the SPILL policy it is generated into temporary files within the
+ * budget instead, and printed and written once complete.
+ */
+int runSingle(const cmdline_parser::Config &job, progress::Reporter *progress)
+{
+    auto estimate = memory_budget::estimate(job.rect, job.angle, job.step, job.outSVG.has_value());
+    bool streaming = false;
+    try
+    {
+        geometry::checkHatch(job.rect, job.angle, job.step, job.limits);
+        streaming = memory_budget::mustStream(estimate, job.memory);
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << e.what() << '\n';
+        return 1;
+    }
+
+    bool spilling = streaming && job.memory.policy == memory_budget::SPILL;
+    if (spilling)
+    {
+        try
+        {
+            batch::spillJob(job, job.memory, printSegment, {}, progress);
+        }
+        catch (const std::exception &e)
+        {
+            std::cout << e.what() << '\n';
+            return 1;
+        }
+    }
+    else if (streaming)
+    {
+        size_t printed = 0;
+        try
+        {
+            batch::streamJob(
+                job,
+                [&printed](const geometry::Segment &segment) {
+                    printSegment(segment);
+                    ++printed;
+                },
+                {}, progress);
+        }
+        catch (const geometry::HatchLimitExceeded &e)
+        {
+            std::cout << e.what() << '\n';
+            return 1;
+        }
+        catch (const std::exception &e)
+        {
+            if (!job.outSVG.has_value())
+            {
+                std::cout << e.what() << '\n';
+                return 1;
+            }
+            std::cout << "Failed to write svg file: " << job.outSVG.value() << ' ' << e.what() << '\n';
+            // Segments already printed would be printed twice, the hatch is only regenerated
+            // when the SVG file failed before generation
+            if (printed != 0)
+            {
+                return 1;
+            }
+            try
+            {
+                geometry::generateHatch(job.rect, job.angle, job.step, printSegment, job.limits);
+            }
+            catch (const geometry::HatchLimitExceeded &e)
+            {
+                std::cout << e.what() << '\n';
+                return 1;
+            }
+        }
+    }
+    else
+    {
+        std::vector<geometry::Segment> hatch;
+        try
+        {
+            alloc_tracker::AllocationGuard guard("generateHatch");
+            hatch = geometry::generateHatch(job.rect, job.angle, job.step, job.limits, progress);
+        }
+        catch (const std::exception &e)
+        {
+            std::cout << e.what() << '\n';
+            return 1;
+        }
+
+        for (auto &segment : hatch)
+        {
+            printSegment(segment);
+        }
+
+        if (job.outSVG.has_value())
+            try
+            {
+                batch::writeJobSVG(job, hatch, std::pmr::get_default_resource(), progress);
+            }
+            catch (const std::exception &e)
+            {
+                std::cout << "Failed to write svg file: " << job.outSVG.value() << ' ' << e.what() << '\n';
+            }
+    }
+
+    if (job.memory.maxBytes != 0)
+    {
+        std::string mode = spilling ? ", spilled" : streaming ? ", streamed" : "";
+        reportMemory("predicted " + std::to_string(estimate.totalBytes()) + " bytes" + mode);
+    }
+    return 0;
+}
+
+/**
+ * @brief Runs a single job, publishing its segments to a shared memory ring
+ * @param job Job configuration with the ring name
+ * @param progress Receiver of progress, may be null
+ * @return Exit status (0 for success, 1 for error)
+ *
+ * Segments go to the ring as they are generated instead of the console, a
+ * consumer process reads them while generation runs. The SVG file, if any,
+ * is streamed as well. Only the number of segments is printed.
+ */
+int runShared(const cmdline_parser::Config &job, progress::Reporter *progress)
+{
+    try
+    {
+        geometry::checkHatch(job.rect, job.angle, job.step, job.limits);
+        shm_ring::Producer ring(job.shm.value());
+        auto result = batch::streamJob(job, [&](const geometry::Segment &s) { ring.push(s); }, {}, progress);
+        ring.close(result.status);
+        std::cout << "Published " << result.segments << " segments to shared memory " << job.shm.value() << '\n';
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Applies the batch work budget and SVG chunk size to jobs that don't set their own
+ * @param jobs Jobs of the batch
+ * @param limits Work budget of the batch
+ * @param pipelineChunk Segments per chunk of streamed SVG output, 0 for no pipeline
+ */
+void applyDefaults(std::vector<cmdline_parser::Config> &jobs, const geometry::HatchLimits &limits,
+                   size_t pipelineChunk)
+{
+    for (auto &job : jobs)
+    {
+        if (job.pipelineChunk == 0)
+        {
+            job.pipelineChunk = pipelineChunk;
+        }
+        if (job.limits.maxSegments == 0)
+        {
+            job.limits.maxSegments = limits.maxSegments;
+        }
+        if (job.limits.timeBudget.count() == 0)
+        {
+            job.limits.timeBudget = limits.timeBudget;
+        }
+    }
+}
+
+/**
+ * @brief Describes the outcome of a batch job
+ * @param result Outcome of the job
+ * @return Summary line without the job number, e.g. "120 segments, streamed"
+ */
+std::string describeResult(const batch::JobResult &result)
+{
+    std::string text = std::to_string(result.segments) + " segments";
+    if (result.streamed)
+    {
+        text += ", streamed";
+    }
+    if (result.cached)
+    {
+        text += ", cached";
+    }
+    if (result.spilled)
+    {
+        text += ", spilled " + std::to_string(result.spilledBytes) + " bytes";
+    }
+    if (!result.ok)
+    {
+        text += ", failed: " + result.error;
+    }
+    return text;
+}
+
+/**
+ * @brief Runs all jobs of a job file
+ * @param path Path to the job file
+ * @param threads Number of worker threads, 0 for hardware concurrency
+ * @param budget Memory budget of the batch
+ * @param limits Work budget of jobs that don't set their own
+ * @param progress Receiver of progress, may be null
+ * @param cacheDir Result cache directory, if any
+ * @param cacheBytes Result cache size limit, 0 for unlimited
+ * @param queue Class limits and aging of the job queue
+ * @param pipelineChunk Segments per chunk of streamed SVG output, 0 for no pipeline
+ * @return Exit status (0 if all jobs succeeded, 1 otherwise)
+ *
+ * Prints the number of segments of each job instead of the segments themselves.
+ */
+int runBatch(const std::filesystem::path &path, unsigned threads, const memory_budget::Budget &budget,
+             const geometry::HatchLimits &limits, progress::Reporter *progress,
+             const std::optional<std::filesystem::path> &cacheDir, size_t cacheBytes,
+             const job_queue::Policy &queue, size_t pipelineChunk)
+{
+    std::vector<cmdline_parser::Config> jobs;
+    std::optional<result_cache::Cache> cache;
+    try
+    {
+        jobs = job_file::readJobs(path);
+        if (cacheDir.has_value())
+        {
+            cache.emplace(cacheDir.value(), cacheBytes);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << e.what() << '\n';
+        return 1;
+    }
+
+    applyDefaults(jobs, limits, pipelineChunk);
+
+    auto results = batch::run(jobs, threads, batch::writeJobSVG, budget, {}, progress,
+                              cache.has_value() ? &cache.value() : nullptr, queue);
+
+    int status = 0;
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        std::cout << "Job " << i + 1 << ": " << describeResult(results[i]) << '\n';
+        if (!results[i].ok)
+        {
+            status = 1;
+        }
+    }
+
+    if (budget.maxBytes != 0)
+    {
+        reportMemory("budget " + std::to_string(budget.maxBytes) + " bytes");
+    }
+    return status;
+}
+
+/**
+ * @brief Runs the jobs of one part of a job file, in a worker process
+ * @param input Batch configuration
+ * @param range Part of the job file
+ * @param budget Memory budget of the worker
+ * @param partition File receiving the summaries
+ * @return Exit status (0 if all jobs succeeded, 1 otherwise)
+ *
+ * The partition starts with "jobs <count>", written before any job runs, or
+ * with "error <message>" if the part can't be read. Then follows the summary
+ * of each job in order.
+ */
+int runShard(const cmdline_parser::Config &input, const job_file::ByteRange &range,
+             const memory_budget::Budget &budget, const std::filesystem::path &partition)
+{
+    std::ofstream out(partition);
+    std::vector<cmdline_parser::Config> jobs;
+    std::optional<result_cache::Cache> cache;
+    try
+    {
+        jobs = job_file::readJobs(input.jobs.value(), range);
+        if (input.cache.has_value())
+        {
+            cache.emplace(input.cache.value(), input.cacheBytes);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        out << "error " << e.what() << '\n';
+        return 1;
+    }
+    // Flushed now, so the parent knows how many jobs a crash took down
+    out << "jobs " << jobs.size() << std::endl;
+    applyDefaults(jobs, input.limits, input.pipelineChunk);
+
+    // Workers of a sharded batch report their own progress
+    std::optional<progress::Reporter> reporter;
+    if (input.progress)
+    {
+        reporter.emplace(printProgress);
+    }
+    auto results = batch::run(jobs, input.threads, batch::writeJobSVG, budget, {},
+                              reporter.has_value() ? &reporter.value() : nullptr,
+                              cache.has_value() ? &cache.value() : nullptr, input.queue);
+    if (reporter.has_value())
+    {
+        reporter->flush();
+    }
+
+    int status = 0;
+    for (const auto &result : results)
+    {
+        out << describeResult(result) << '\n';
+        if (!result.ok)
+        {
+            status = 1;
+        }
+    }
+    out.close();
+    return out ? status : 1;
+}
+
+/**
+ * @brief Runs all jobs of a job file in several worker processes
+ * @param input Batch configuration with the process count
+ * @return Exit status (0 if all jobs succeeded, 1 otherwise)
+ *
+ * The job file is split by byte ranges at line starts, each worker process
+ * runs one part with its own heap and writes the summaries to a partition
+ * file. The parent prints the partitions in file order, so the output is the
+ * same as with a single process. Jobs of a crashed worker are reported as
+ * failed, the other parts are not affected. The memory budget is split
+ * evenly between the workers.
+ */
+int runSharded(const cmdline_parser::Config &input)
+{
+    unsigned processes = input.processes != 0 ? input.processes : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<job_file::ByteRange> ranges;
+    try
+    {
+        ranges = job_file::splitJobs(input.jobs.value(), processes);
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << e.what() << '\n';
+        return 1;
+    }
+
+    auto budget = input.memory;
+    budget.maxBytes /= processes;
+    auto directory =
+        budget.spillDirectory.empty() ? std::filesystem::temp_directory_path() : budget.spillDirectory;
+    std::vector<std::filesystem::path> partitions;
+    for (size_t i = 0; i < processes; ++i)
+    {
+        partitions.push_back(directory /
+                             ("hatch-shard-" + std::to_string(getpid()) + '-' + std::to_string(i) + ".txt"));
+    }
+
+    std::vector<sharding::ShardExit> exits;
+    try
+    {
+        exits = sharding::forkShards(processes,
+                                     [&](size_t i) { return runShard(input, ranges[i], budget, partitions[i]); });
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << e.what() << '\n';
+        exits.assign(processes, {.exitCode = 1, .signal = 0});
+    }
+
+    int status = 0;
+    size_t number = 1;
+    for (size_t i = 0; i < processes; ++i)
+    {
+        std::ifstream in(partitions[i]);
+        std::string line;
+        size_t expected = 0;
+        size_t printed = 0;
+        bool started = static_cast<bool>(std::getline(in, line));
+        if (started && line.starts_with("error "))
+        {
+            std::cout << line.substr(6) << '\n';
+        }
+        else if (started && line.starts_with("jobs "))
+        {
+            expected = std::stoull(line.substr(5));
+            for (; printed < expected && std::getline(in, line); ++printed)
+            {
+                std::cout << "Job " << number++ << ": " << line << '\n';
+            }
+        }
+
+        if (!exits[i].ok())
+        {
+            status = 1;
+            for (; printed < expected; ++printed)
+            {
+                std::cout << "Job " << number++ << ": failed: " << exits[i].describe() << '\n';
+            }
+            if (!started && exits[i].signal != 0)
+            {
+                std::cout << "Shard " << i + 1 << ": failed: " << exits[i].describe() << '\n';
+            }
+        }
+        in.close();
+        std::error_code ignored;
+        std::filesystem::remove(partitions[i], ignored);
+    }
+
+    if (input.memory.maxBytes != 0)
+    {
+        std::cerr << "Memory: budget " << input.memory.maxBytes << " bytes, " << budget.maxBytes
+                  << " bytes per process";
+        if (auto peak = process_memory::peakChildResidentBytes(); peak.has_value())
+        {
+            std::cerr << ", peak worker RSS " << peak.value() << " bytes";
+        }
+        std::cerr << '\n';
+    }
+    return status;
+}
+
+} // namespace
 
 /**
  * @brief Main function
@@ -36,6 +518,18 @@
  * 2. Generate hatch pattern for the specified rectangle
  * 3. Output hatch segments to console
  * 4. Optionally create SVG file with visualization
+ *
+ * With --jobs the steps 2-4 are repeated for every job of the file, with
+ * --processes in several worker processes.
+ *
+ * With --shm the segments are published to a shared memory ring instead of
+ * the console, see shm_ring.h.
+ *
+ * With --metrics-socket or --metrics-file the library metrics are served
+ * or dumped in Prometheus text format while the jobs run.
+ *
+ * In builds with HATCH_ALLOC_TRACKING an allocation report grouped by stage
+ * is written to stderr before exit.
  */
 int main(int argc, char **argv)
 {
@@ -43,6 +537,10 @@ int main(int argc, char **argv)
     try
     {
         input = cmdline_parser::parse(argc, argv);
+        if (input.isa.has_value())
+        {
+            cpu_dispatch::selectIsa(input.isa.value());
+        }
     }
     catch (const std::exception &e)
     {
@@ -50,24 +548,74 @@ int main(int argc, char **argv)
         return 1;
     }
 
-    auto hatch = geometry::generateHatch(input.rect, input.angle, input.step);
+    // Metrics are served for the whole run, the file also gets a final dump
+    std::optional<metrics::SocketServer> metricsServer;
+    std::optional<metrics::SignalDump> metricsDump;
+    try
+    {
+        if (input.metricsSocket.has_value())
+        {
+            metricsServer.emplace(metrics::registry(), input.metricsSocket.value());
+        }
+        if (input.metricsFile.has_value())
+        {
+            metricsDump.emplace(metrics::registry(), input.metricsFile.value());
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << e.what() << '\n';
+        return 1;
+    }
+
+    // Workers of a sharded batch report their own progress
+    std::optional<progress::Reporter> reporter;
+    if (input.progress)
+    {
+        reporter.emplace(printProgress);
+    }
+    progress::Reporter *progress = reporter.has_value() ? &reporter.value() : nullptr;
+
+    int status = 0;
+    if (input.jobs.has_value() && input.processes != 1)
+    {
+        status = runSharded(input);
+    }
+    else if (input.jobs.has_value())
+    {
+        status = runBatch(input.jobs.value(), input.threads, input.memory, input.limits, progress, input.cache,
+                          input.cacheBytes, input.queue, input.pipelineChunk);
+    }
+    else if (input.shm.has_value())
+    {
+        status = runShared(input, progress);
+    }
+    else
+    {
+        status = runSingle(input, progress);
+    }
 
-    for (auto &segment : hatch)
+    if (reporter.has_value())
     {
-        std::cout << "Line: " << segment << std::endl;
+        reporter->flush();
     }
 
-    if (input.outSVG.has_value())
+    if (input.metricsFile.has_value())
+    {
         try
         {
-            svg::SVGWriter writer(input.outSVG.value(), 400, 400);
-            writer.drawSegments(hatch, svg::HATCH);
-            writer.drawSegments(input.rect.toSegments(), svg::CONTOUR);
+            metrics::dump(metrics::registry(), input.metricsFile.value());
         }
         catch (const std::exception &e)
         {
-            std::cout << "Failed to write svg file: " << input.outSVG.value() << ' ' << e.what() << '\n';
+            std::cerr << e.what() << '\n';
         }
+    }
 
-    return 0;
+    if constexpr (alloc_tracker::ENABLED)
+    {
+        alloc_tracker::report(std::cerr);
+    }
+
+    return status;
 }
\ No newline at end of file
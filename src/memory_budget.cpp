@@ -0,0 +1,110 @@
+/**
+ * @file memory_budget.cpp
+ * @brief Implementation of memory prediction and budget enforcement
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "memory_budget.h"
+
+#include <limits>
+
+#include "segment_buffer.h"
+
+namespace
+{
+
+/**
+ * @brief Multiplies with saturation
+ * @param count Number of elements
+ * @param size Element size
+ * @return count * size or SIZE_MAX on overflow
+ */
+size_t bytesOf(size_t count, size_t size) noexcept
+{
+    return count > std::numeric_limits<size_t>::max() / size ? std::numeric_limits<size_t>::max() : count * size;
+}
+
+} // namespace
+
+namespace memory_budget
+{
+
+size_t Estimate::totalBytes() const noexcept
+{
+    return hatchBytes > std::numeric_limits<size_t>::max() - svgBytes ? std::numeric_limits<size_t>::max()
+                                                                      : hatchBytes + svgBytes;
+}
+
+BudgetExceeded::BudgetExceeded(size_t predicted, size_t budget)
+    : std::runtime_error("Job needs " + std::to_string(predicted) + " bytes, memory budget is " +
+                         std::to_string(budget) + " bytes")
+{
+}
+
+Estimate estimate(const geometry::Rectangle &rect, double angle, double step, bool svg) noexcept
+{
+    size_t lines = geometry::hatchLineCount(rect, angle, step);
+    size_t bound = geometry::hatchSegmentBound(rect, angle, step);
+
+    // generateHatch() reserves the bound, the writer copies hatch and contour endpoints into columns
+    size_t svgBytes = bound > std::numeric_limits<size_t>::max() / sizeof(geometry::Segment)
+                          ? std::numeric_limits<size_t>::max()
+                          : geometry::SegmentBuffer::bytesFor(bound) + geometry::SegmentBuffer::bytesFor(4);
+    return {.lines = lines,
+            .hatchBytes = bytesOf(bound, sizeof(geometry::Segment)),
+            .svgBytes = svg ? svgBytes : 0};
+}
+
+bool mustStream(const Estimate &e, const Budget &budget)
+{
+    if (budget.maxBytes == 0 || e.totalBytes() <= budget.maxBytes)
+    {
+        return false;
+    }
+    if (budget.policy == FAIL)
+    {
+        throw BudgetExceeded(e.totalBytes(), budget.maxBytes);
+    }
+    return true;
+}
+
+size_t parseSize(const std::string &text)
+{
+    // std::stoull skips leading whitespace and wraps a negative value around
+    size_t first = text.find_first_not_of(" \t\n\v\f\r");
+    if (first != std::string::npos && text[first] == '-')
+    {
+        throw std::invalid_argument("Invalid size: " + text);
+    }
+
+    size_t pos = 0;
+    unsigned long long value = std::stoull(text, &pos);
+    std::string suffix = text.substr(pos);
+
+    unsigned shift = 0;
+    if (suffix == "K" || suffix == "k")
+    {
+        shift = 10;
+    }
+    else if (suffix == "M" || suffix == "m")
+    {
+        shift = 20;
+    }
+    else if (suffix == "G" || suffix == "g")
+    {
+        shift = 30;
+    }
+    else if (!suffix.empty())
+    {
+        throw std::invalid_argument("Invalid size: " + text);
+    }
+
+    if (value > (std::numeric_limits<size_t>::max() >> shift))
+    {
+        throw std::invalid_argument("Size is too large: " + text);
+    }
+    return static_cast<size_t>(value) << shift;
+}
+
+} // namespace memory_budget
@@ -0,0 +1,226 @@
+/**
+ * @file metrics.cpp
+ * @brief Implementation of the metrics registry
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "metrics.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+
+/**
+ * @brief Returns the cell index of the calling thread
+ * @return Index below metrics::SHARDS, fixed for the thread lifetime
+ */
+size_t shardIndex() noexcept
+{
+    static std::atomic<size_t> next{0};
+    thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed) % metrics::SHARDS;
+    return index;
+}
+
+/**
+ * @brief Writes HELP and TYPE lines of a metric
+ * @param out Output stream
+ * @param name Metric name
+ * @param help Description
+ * @param type Prometheus metric type
+ */
+void writeHeader(std::ostream &out, const std::string &name, const std::string &help, const char *type)
+{
+    out << "# HELP " << name << ' ' << help << '\n';
+    out << "# TYPE " << name << ' ' << type << '\n';
+}
+
+} // namespace
+
+namespace metrics
+{
+
+void Counter::add(uint64_t n) noexcept
+{
+    cells[shardIndex()].value.fetch_add(n, std::memory_order_relaxed);
+}
+
+uint64_t Counter::value() const noexcept
+{
+    uint64_t sum = 0;
+    for (const auto &cell : cells)
+    {
+        sum += cell.value.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+void Gauge::set(int64_t v) noexcept
+{
+    current.store(v, std::memory_order_relaxed);
+}
+
+void Gauge::add(int64_t n) noexcept
+{
+    current.fetch_add(n, std::memory_order_relaxed);
+}
+
+int64_t Gauge::value() const noexcept
+{
+    return current.load(std::memory_order_relaxed);
+}
+
+Histogram::Histogram(std::vector<double> bounds) : bounds(std::move(bounds))
+{
+    if (!std::is_sorted(this->bounds.begin(), this->bounds.end()))
+    {
+        throw std::invalid_argument("Histogram bounds must be sorted");
+    }
+    for (auto &cell : cells)
+    {
+        // One more bucket for values above the last bound
+        cell.counts = std::make_unique<std::atomic<uint64_t>[]>(this->bounds.size() + 1);
+    }
+}
+
+void Histogram::observe(double v) noexcept
+{
+    size_t bucket = std::lower_bound(bounds.begin(), bounds.end(), v) - bounds.begin();
+    auto &cell = cells[shardIndex()];
+    cell.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    cell.sum.fetch_add(v, std::memory_order_relaxed);
+}
+
+HistogramSnapshot Histogram::snapshot() const
+{
+    HistogramSnapshot snapshot{.bounds = bounds, .counts = std::vector<uint64_t>(bounds.size() + 1), .sum = 0};
+    for (const auto &cell : cells)
+    {
+        for (size_t i = 0; i <= bounds.size(); ++i)
+        {
+            snapshot.counts[i] += cell.counts[i].load(std::memory_order_relaxed);
+        }
+        snapshot.sum += cell.sum.load(std::memory_order_relaxed);
+    }
+    for (size_t i = 1; i < snapshot.counts.size(); ++i)
+    {
+        snapshot.counts[i] += snapshot.counts[i - 1];
+    }
+    return snapshot;
+}
+
+Counter &Registry::counter(const std::string &name, const std::string &help)
+{
+    std::lock_guard lock(mutex);
+    if (auto *family = find(name); family != nullptr)
+    {
+        if (!family->counter)
+        {
+            throw std::invalid_argument("Metric " + name + " is not a counter");
+        }
+        return *family->counter;
+    }
+    families.push_back({.name = name, .help = help, .counter = std::make_unique<Counter>()});
+    return *families.back().counter;
+}
+
+Gauge &Registry::gauge(const std::string &name, const std::string &help)
+{
+    std::lock_guard lock(mutex);
+    if (auto *family = find(name); family != nullptr)
+    {
+        if (!family->gauge)
+        {
+            throw std::invalid_argument("Metric " + name + " is not a gauge");
+        }
+        return *family->gauge;
+    }
+    families.push_back({.name = name, .help = help, .gauge = std::make_unique<Gauge>()});
+    return *families.back().gauge;
+}
+
+Histogram &Registry::histogram(const std::string &name, const std::string &help, std::vector<double> bounds)
+{
+    std::lock_guard lock(mutex);
+    if (auto *family = find(name); family != nullptr)
+    {
+        if (!family->histogram)
+        {
+            throw std::invalid_argument("Metric " + name + " is not a histogram");
+        }
+        return *family->histogram;
+    }
+    families.push_back({.name = name, .help = help, .histogram = std::make_unique<Histogram>(std::move(bounds))});
+    return *families.back().histogram;
+}
+
+void Registry::write(std::ostream &out) const
+{
+    std::lock_guard lock(mutex);
+    for (const auto &family : families)
+    {
+        if (family.counter)
+        {
+            writeHeader(out, family.name, family.help, "counter");
+            out << family.name << ' ' << family.counter->value() << '\n';
+        }
+        else if (family.gauge)
+        {
+            writeHeader(out, family.name, family.help, "gauge");
+            out << family.name << ' ' << family.gauge->value() << '\n';
+        }
+        else
+        {
+            writeHeader(out, family.name, family.help, "histogram");
+            auto snapshot = family.histogram->snapshot();
+            for (size_t i = 0; i < snapshot.bounds.size(); ++i)
+            {
+                out << family.name << "_bucket{le=\"" << snapshot.bounds[i] << "\"} " << snapshot.counts[i] << '\n';
+            }
+            out << family.name << "_bucket{le=\"+Inf\"} " << snapshot.counts.back() << '\n';
+            auto precision = out.precision(std::numeric_limits<double>::max_digits10);
+            out << family.name << "_sum " << snapshot.sum << '\n';
+            out.precision(precision);
+            out << family.name << "_count " << snapshot.counts.back() << '\n';
+        }
+    }
+}
+
+Registry::Family *Registry::find(const std::string &name)
+{
+    auto it = std::find_if(families.begin(), families.end(), [&](const Family &f) { return f.name == name; });
+    return it == families.end() ? nullptr : &*it;
+}
+
+Registry &registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+const HatchMetrics &hatchMetrics()
+{
+    static const HatchMetrics instance{
+        .requests = registry().counter("hatch_requests_total", "Batch jobs and coalescer requests started"),
+        .segments = registry().counter("hatch_segments_total", "Hatch segments generated"),
+        .svgBytes = registry().counter("hatch_svg_bytes_total", "Bytes written to SVG output"),
+        .cacheHits = registry().counter("hatch_cache_hits_total", "Batch jobs served from the result cache"),
+        .cacheMisses = registry().counter("hatch_cache_misses_total", "Batch jobs not found in the result cache"),
+        .queueDepth = registry().gauge("hatch_queue_depth", "Batch jobs waiting for a worker"),
+        .jobSeconds = registry().histogram("hatch_job_duration_seconds", "Duration of batch jobs in seconds",
+                                           {0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1, 5, 10, 60}),
+        .formatQueueDepth =
+            registry().gauge("hatch_pipeline_format_queue_depth", "Segment chunks waiting for SVG formatting"),
+        .writeQueueDepth = registry().gauge("hatch_pipeline_write_queue_depth", "Text chunks waiting to be written"),
+        .formatStalls = registry().counter("hatch_pipeline_format_stalls_total",
+                                           "Segment chunks generation waited to hand over to formatting"),
+        .writeStalls = registry().counter("hatch_pipeline_write_stalls_total",
+                                          "Text chunks formatting waited to hand over to writing")};
+    return instance;
+}
+
+} // namespace metrics
@@ -0,0 +1,253 @@
+/**
+ * @file metrics_export.cpp
+ * @brief Implementation of metrics export, POSIX only
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "metrics_export.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+
+/// Poll timeout of background threads, bounds the stop latency
+constexpr int POLL_MS = 100;
+
+/// Write end of the SignalDump pipe, -1 without an instance
+std::atomic<int> dumpPipe{-1};
+
+/**
+ * @brief Signal handler, wakes the dump thread
+ * @param signal Received signal
+ */
+void onDumpSignal(int)
+{
+    int saved = errno;
+    if (int fd = dumpPipe.load(); fd >= 0)
+    {
+        char wake = 'd';
+        [[maybe_unused]] auto written = write(fd, &wake, 1);
+    }
+    errno = saved;
+}
+
+/**
+ * @brief Builds an error for a failed system call
+ * @param what Description of the operation
+ * @return Error with the errno message
+ */
+std::runtime_error systemError(const std::string &what)
+{
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+/**
+ * @brief Writes a whole buffer to a socket
+ * @param fd Connected socket
+ * @param text Bytes to send
+ */
+void sendAll(int fd, const std::string &text)
+{
+    for (size_t sent = 0; sent < text.size();)
+    {
+        auto n = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return;
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+} // namespace
+
+namespace metrics
+{
+
+void dump(const Registry &r, const std::filesystem::path &path)
+{
+    auto temp = path;
+    temp += ".tmp-" + std::to_string(getpid());
+    {
+        std::ofstream out(temp);
+        r.write(out);
+        out.close();
+        if (!out)
+        {
+            std::error_code ignored;
+            std::filesystem::remove(temp, ignored);
+            throw std::runtime_error("Failed to write metrics file: " + temp.string());
+        }
+    }
+    std::filesystem::rename(temp, path);
+}
+
+SocketServer::SocketServer(const Registry &r, std::filesystem::path socketPath)
+    : registry(r), path(std::move(socketPath))
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.native().size() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error("Metrics socket path is too long: " + path.string());
+    }
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    // A socket left by a previous run would make bind fail
+    std::error_code ignored;
+    if (std::filesystem::is_socket(path, ignored))
+    {
+        std::filesystem::remove(path, ignored);
+    }
+
+    listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0)
+    {
+        throw systemError("Failed to create metrics socket");
+    }
+    if (bind(listener, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(listener, 16) != 0)
+    {
+        auto error = systemError("Failed to serve metrics on " + path.string());
+        close(listener);
+        throw error;
+    }
+    thread = std::jthread([this](std::stop_token stop) { serve(stop); });
+}
+
+SocketServer::~SocketServer()
+{
+    thread.request_stop();
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+    close(listener);
+    std::error_code ignored;
+    std::filesystem::remove(path, ignored);
+}
+
+void SocketServer::serve(std::stop_token stop)
+{
+    while (!stop.stop_requested())
+    {
+        pollfd incoming{.fd = listener, .events = POLLIN, .revents = 0};
+        if (poll(&incoming, 1, POLL_MS) <= 0)
+        {
+            continue;
+        }
+        int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        // The request is read and ignored, every path gets the metrics
+        pollfd request{.fd = fd, .events = POLLIN, .revents = 0};
+        if (poll(&request, 1, POLL_MS) > 0)
+        {
+            char buffer[4096];
+            [[maybe_unused]] auto ignored = read(fd, buffer, sizeof(buffer));
+        }
+
+        std::ostringstream body;
+        registry.write(body);
+        std::string text = body.str();
+        sendAll(fd,
+                "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                    std::to_string(text.size()) + "\r\n\r\n" + text);
+        close(fd);
+    }
+}
+
+SignalDump::SignalDump(const Registry &r, std::filesystem::path dumpPath, int signal)
+    : registry(r), path(std::move(dumpPath)), signal(signal)
+{
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0)
+    {
+        throw systemError("Failed to create metrics dump pipe");
+    }
+    // The handler must never block, a full pipe already has a dump pending
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+    int expected = -1;
+    if (!dumpPipe.compare_exchange_strong(expected, fds[1]))
+    {
+        close(fds[0]);
+        close(fds[1]);
+        throw std::logic_error("Only one SignalDump may exist at a time");
+    }
+    pipeRead = fds[0];
+
+    struct sigaction action{};
+    action.sa_handler = onDumpSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if (sigaction(signal, &action, &previous) != 0)
+    {
+        auto error = systemError("Failed to install metrics dump handler");
+        close(dumpPipe.exchange(-1));
+        close(pipeRead);
+        throw error;
+    }
+
+    thread = std::jthread([this] {
+        for (char wake = 0;;)
+        {
+            auto n = read(pipeRead, &wake, 1);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0 || wake == 'q')
+            {
+                return;
+            }
+            try
+            {
+                dump(registry, path);
+            }
+            catch (const std::exception &)
+            {
+                // Monitoring must not stop the process, the next signal retries
+            }
+        }
+    });
+}
+
+SignalDump::~SignalDump()
+{
+    sigaction(signal, &previous, nullptr);
+    int fd = dumpPipe.exchange(-1);
+    char quit = 'q';
+    [[maybe_unused]] auto written = write(fd, &quit, 1);
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+    close(fd);
+    close(pipeRead);
+}
+
+} // namespace metrics
@@ -0,0 +1,260 @@
+/**
+ * @file pipeline.cpp
+ * @brief Implementation of the staged SVG output
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "pipeline.h"
+
+#include <array>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <utility>
+
+#include "metrics.h"
+
+namespace
+{
+
+/**
+ * @class ChunkStream
+ * @brief Stream buffer collecting text into strings handed over one by one
+ *
+ * The stream position counts all bytes ever written, so the SVG writer on
+ * top of it measures bytes and reports progress as on a file.
+ */
+class ChunkStream : public std::streambuf
+{
+  public:
+    ChunkStream()
+    {
+        setp(area.data(), area.data() + area.size());
+    }
+
+    /**
+     * @brief Takes the text written since the last call
+     * @return Collected text
+     */
+    std::string take()
+    {
+        sync();
+        written += text.size();
+        return std::exchange(text, {});
+    }
+
+  protected:
+    int_type overflow(int_type ch) override
+    {
+        sync();
+        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+        {
+            text.push_back(traits_type::to_char_type(ch));
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int sync() override
+    {
+        text.append(pbase(), pptr());
+        setp(area.data(), area.data() + area.size());
+        return 0;
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        // Only tellp() is supported
+        if (off != 0 || dir != std::ios_base::cur || (which & std::ios_base::out) == 0)
+        {
+            return pos_type(off_type(-1));
+        }
+        return pos_type(static_cast<off_type>(written + text.size() + static_cast<size_t>(pptr() - pbase())));
+    }
+
+  private:
+    std::array<char, 4096> area; ///< Put area
+    std::string text;            ///< Text flushed from the put area since the last take()
+    size_t written = 0;          ///< Bytes taken before text
+};
+
+} // namespace
+
+namespace pipeline
+{
+
+SvgPipeline::SvgPipeline(const std::filesystem::path &outFile, const svg::Bounds &bounds, size_t chunkSegments,
+                         progress::Reporter *progress)
+    : path(outFile), file(outFile), bounds(bounds), chunkSegments(std::max<size_t>(chunkSegments, 1)),
+      progress(progress), formatQueue(QUEUE_CHUNKS), writeQueue(QUEUE_CHUNKS)
+{
+    if (!file)
+    {
+        throw std::runtime_error("Failed to open file: " + path.string());
+    }
+    current.segments.reserve(this->chunkSegments);
+    writer = std::jthread([this] { write(); });
+    formatter = std::jthread([this] { format(); });
+}
+
+SvgPipeline::~SvgPipeline()
+{
+    if (formatter.joinable())
+    {
+        deliver();
+        formatQueue.close();
+        formatter = {};
+        writer = {};
+    }
+
+    const auto &metrics = metrics::hatchMetrics();
+    metrics.formatQueueDepth.add(-static_cast<int64_t>(formatQueue.size()));
+    metrics.writeQueueDepth.add(-static_cast<int64_t>(writeQueue.size()));
+    metrics.formatStalls.add(formatQueue.stalls());
+    metrics.writeStalls.add(writeQueue.stalls());
+}
+
+void SvgPipeline::push(const geometry::Segment &segment)
+{
+    current.segments.push_back({segment.a, segment.b});
+    if (current.segments.size() == chunkSegments)
+    {
+        handOver();
+    }
+}
+
+void SvgPipeline::finish(std::span<const geometry::Segment> contour)
+{
+    handOver();
+    current.format = svg::CONTOUR;
+    for (const auto &segment : contour)
+    {
+        current.segments.push_back({segment.a, segment.b});
+    }
+    handOver();
+    formatQueue.close();
+
+    formatter = {};
+    writer = {};
+    rethrow();
+}
+
+void SvgPipeline::handOver()
+{
+    if (!deliver())
+    {
+        rethrow();
+    }
+}
+
+bool SvgPipeline::deliver()
+{
+    if (current.segments.empty())
+    {
+        return true;
+    }
+    Chunk next;
+    next.segments.reserve(chunkSegments);
+    next.format = current.format;
+
+    metrics::hatchMetrics().formatQueueDepth.add(1);
+    if (!formatQueue.push(std::exchange(current, std::move(next))))
+    {
+        metrics::hatchMetrics().formatQueueDepth.add(-1);
+        return false;
+    }
+    return true;
+}
+
+void SvgPipeline::fail(std::exception_ptr failure)
+{
+    {
+        std::lock_guard lock(errorMutex);
+        if (!error)
+        {
+            error = failure;
+        }
+    }
+    formatQueue.abort();
+    writeQueue.abort();
+}
+
+void SvgPipeline::rethrow()
+{
+    std::lock_guard lock(errorMutex);
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void SvgPipeline::format()
+{
+    const auto &metrics = metrics::hatchMetrics();
+    auto handOff = [&](std::string text) {
+        if (text.empty())
+        {
+            return true;
+        }
+        metrics.writeQueueDepth.add(1);
+        if (!writeQueue.push(std::move(text)))
+        {
+            metrics.writeQueueDepth.add(-1);
+            return false;
+        }
+        return true;
+    };
+
+    try
+    {
+        ChunkStream buffer;
+        std::ostream out(&buffer);
+        {
+            svg::SVGWriter svgWriter(out, 400, 400);
+            svgWriter.setBounds(bounds);
+            svgWriter.setProgress(progress);
+            while (auto chunk = formatQueue.pop())
+            {
+                metrics.formatQueueDepth.add(-1);
+                for (const auto &view : chunk->segments)
+                {
+                    svgWriter.drawSegment(view.toSegment(), chunk->format);
+                }
+                if (!handOff(buffer.take()))
+                {
+                    return;
+                }
+            }
+        }
+        // The writer has added the closing tag on destruction
+        handOff(buffer.take());
+        writeQueue.close();
+    }
+    catch (...)
+    {
+        fail(std::current_exception());
+    }
+}
+
+void SvgPipeline::write()
+{
+    try
+    {
+        while (auto text = writeQueue.pop())
+        {
+            metrics::hatchMetrics().writeQueueDepth.add(-1);
+            file.write(text->data(), static_cast<std::streamsize>(text->size()));
+            if (!file)
+            {
+                throw std::runtime_error("Failed to write file: " + path.string());
+            }
+        }
+        file.flush();
+    }
+    catch (...)
+    {
+        fail(std::current_exception());
+    }
+}
+
+} // namespace pipeline
@@ -0,0 +1,70 @@
+/**
+ * @file process_memory.cpp
+ * @brief Implementation of /proc based memory queries
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "process_memory.h"
+
+#include <fstream>
+#include <string>
+
+#include <sys/resource.h>
+
+namespace
+{
+
+/**
+ * @brief Reads a kB field from /proc/self/status
+ * @param field Field name with colon, e.g. "VmHWM:"
+ * @return Field value in bytes, empty if not found
+ */
+std::optional<size_t> readStatusField(const std::string &field)
+{
+    std::ifstream status("/proc/self/status");
+    for (std::string line; std::getline(status, line);)
+    {
+        if (line.compare(0, field.size(), field) == 0)
+        {
+            // Format: "VmHWM:     1234 kB"
+            return std::stoull(line.substr(field.size())) * 1024;
+        }
+    }
+    return {};
+}
+
+} // namespace
+
+namespace process_memory
+{
+
+std::optional<size_t> residentBytes()
+{
+    return readStatusField("VmRSS:");
+}
+
+std::optional<size_t> peakResidentBytes()
+{
+    return readStatusField("VmHWM:");
+}
+
+std::optional<size_t> peakChildResidentBytes()
+{
+    rusage usage{};
+    if (getrusage(RUSAGE_CHILDREN, &usage) != 0)
+    {
+        return {};
+    }
+    // Linux reports ru_maxrss in kilobytes
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+}
+
+bool resetPeakResident()
+{
+    // Writing 5 to clear_refs resets the peak RSS value
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    return static_cast<bool>(clearRefs << "5" << std::flush);
+}
+
+} // namespace process_memory
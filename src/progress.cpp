@@ -0,0 +1,86 @@
+/**
+ * @file progress.cpp
+ * @brief Implementation of throttled progress reporting
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "progress.h"
+
+#include <utility>
+
+namespace progress
+{
+
+Reporter::Reporter(Callback callback, std::chrono::milliseconds interval)
+    : callback(std::move(callback)), interval(interval)
+{
+}
+
+void Reporter::expect(size_t lines) noexcept
+{
+    totalLines.fetch_add(lines, std::memory_order_relaxed);
+}
+
+void Reporter::hatched(size_t lines) noexcept
+{
+    hatchedLines.fetch_add(lines, std::memory_order_relaxed);
+    tick();
+}
+
+void Reporter::written(size_t lines, size_t bytes) noexcept
+{
+    writtenLines.fetch_add(lines, std::memory_order_relaxed);
+    writtenBytes.fetch_add(bytes, std::memory_order_relaxed);
+    tick();
+}
+
+void Reporter::flush() noexcept
+{
+    next.store(std::chrono::steady_clock::now().time_since_epoch().count() + interval.count(),
+               std::memory_order_relaxed);
+    report();
+}
+
+Snapshot Reporter::snapshot() const noexcept
+{
+    return {.hatchedLines = hatchedLines.load(std::memory_order_relaxed),
+            .totalLines = totalLines.load(std::memory_order_relaxed),
+            .writtenLines = writtenLines.load(std::memory_order_relaxed),
+            .writtenBytes = writtenBytes.load(std::memory_order_relaxed)};
+}
+
+void Reporter::tick() noexcept
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    auto due = next.load(std::memory_order_relaxed);
+    if (now < due)
+    {
+        return;
+    }
+
+    // Only the thread that moves the next call time reports this interval
+    if (next.compare_exchange_strong(due, now + interval.count(), std::memory_order_relaxed))
+    {
+        report();
+    }
+}
+
+void Reporter::report() noexcept
+{
+    if (!callback)
+    {
+        return;
+    }
+    std::lock_guard lock(callbackMutex);
+    try
+    {
+        callback(snapshot());
+    }
+    catch (...)
+    {
+        // Progress is informational, a failing receiver must not stop the work
+    }
+}
+
+} // namespace progress
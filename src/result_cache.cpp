@@ -0,0 +1,304 @@
+/**
+ * @file result_cache.cpp
+ * @brief Implementation of the persistent result cache
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "result_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+#ifndef HATCH_VERSION
+#define HATCH_VERSION "unknown"
+#endif
+
+namespace
+{
+
+/// Prefix of temporary files in the cache directory
+constexpr const char *TEMP_PREFIX = "tmp-";
+
+/// Age after which a temporary file or an entry without metadata is garbage
+constexpr auto STALE_AGE = std::chrono::hours(1);
+
+/**
+ * @brief Computes the 64-bit FNV-1a hash
+ * @param text Hashed bytes
+ * @return Hash value
+ */
+uint64_t fnv1a(const std::string &text) noexcept
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : text)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * @brief Clones a file sharing its data blocks
+ * @param from Source file
+ * @param to Destination file, created or truncated
+ * @return true if the file system made the clone
+ */
+bool reflink(const std::filesystem::path &from, const std::filesystem::path &to)
+{
+#if defined(__linux__) && defined(FICLONE)
+    int src = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+    if (src < 0)
+    {
+        return false;
+    }
+    int dst = open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool cloned = dst >= 0 && ioctl(dst, FICLONE, src) == 0;
+    if (dst >= 0)
+    {
+        close(dst);
+    }
+    close(src);
+    return cloned;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Copies a file, as a reflink if possible
+ * @param from Source file
+ * @param to Destination file, overwritten
+ * @throw std::filesystem::filesystem_error if the file cannot be copied
+ */
+void copyFile(const std::filesystem::path &from, const std::filesystem::path &to)
+{
+    if (!reflink(from, to))
+    {
+        std::filesystem::copy_file(from, to, std::filesystem::copy_options::overwrite_existing);
+    }
+}
+
+/**
+ * @brief Checks if a file was last written before the stale age
+ * @param path File to check
+ * @return true if the file is old or gone
+ */
+bool isStale(const std::filesystem::path &path)
+{
+    std::error_code ec;
+    auto time = std::filesystem::last_write_time(path, ec);
+    return ec || time < std::filesystem::file_time_type::clock::now() - STALE_AGE;
+}
+
+} // namespace
+
+namespace result_cache
+{
+
+std::string jobKey(const cmdline_parser::Config &job, const std::string &format)
+{
+    std::ostringstream key;
+    key << std::hexfloat;
+    key << "hatch-cache " << FORMAT_VERSION << '\n';
+    key << "version " << HATCH_VERSION << '\n';
+    key << "format " << format << '\n';
+    key << "points";
+    for (const auto &p : job.rect.points)
+    {
+        key << ' ' << p.x << ' ' << p.y;
+    }
+    key << "\nangle " << job.angle << '\n';
+    key << "step " << job.step << '\n';
+    return key.str();
+}
+
+Cache::Cache(std::filesystem::path directory, size_t maxBytes) : directory(std::move(directory)), maxBytes(maxBytes)
+{
+    std::filesystem::create_directories(this->directory);
+    evict();
+}
+
+std::optional<size_t> Cache::fetch(const std::string &key, const std::filesystem::path &out) const
+{
+    auto metaPath = entryPath(key, ".meta");
+    std::ifstream meta(metaPath);
+    if (!meta)
+    {
+        return std::nullopt;
+    }
+    std::string text((std::istreambuf_iterator<char>(meta)), std::istreambuf_iterator<char>());
+    meta.close();
+
+    // Another key with the same hash is a miss
+    if (text.compare(0, key.size(), key) != 0)
+    {
+        return std::nullopt;
+    }
+    std::istringstream tail(text.substr(key.size()));
+    std::string word;
+    size_t segments = 0;
+    if (!(tail >> word >> segments) || word != "segments")
+    {
+        return std::nullopt;
+    }
+
+    try
+    {
+        copyFile(entryPath(key, ".out"), out);
+    }
+    catch (const std::exception &)
+    {
+        return std::nullopt;
+    }
+
+    // The entry time is the eviction order
+    std::error_code ignored;
+    std::filesystem::last_write_time(metaPath, std::filesystem::file_time_type::clock::now(), ignored);
+    return segments;
+}
+
+void Cache::store(const std::string &key, const std::filesystem::path &file, size_t segments) const
+{
+    auto data = tempPath();
+    auto meta = tempPath();
+    uintmax_t bytes = 0;
+    try
+    {
+        copyFile(file, data);
+        {
+            std::ofstream out(meta);
+            out << key << "segments " << segments << '\n';
+            out.close();
+            if (!out)
+            {
+                throw std::runtime_error("Failed to write cache entry: " + meta.string());
+            }
+        }
+        // A replaced entry stays counted until the next scan, which merely comes earlier
+        bytes = std::filesystem::file_size(data) + std::filesystem::file_size(meta);
+        // Output first: an entry with metadata is always complete
+        std::filesystem::rename(data, entryPath(key, ".out"));
+        std::filesystem::rename(meta, entryPath(key, ".meta"));
+    }
+    catch (const std::exception &)
+    {
+        std::error_code ignored;
+        std::filesystem::remove(data, ignored);
+        std::filesystem::remove(meta, ignored);
+        return;
+    }
+    if (maxBytes != 0 && counted.fetch_add(bytes, std::memory_order_relaxed) + bytes > maxBytes)
+    {
+        evict();
+    }
+}
+
+void Cache::evict() const
+{
+    if (maxBytes == 0)
+    {
+        return;
+    }
+
+    struct Entry
+    {
+        std::filesystem::path meta;           ///< Metadata file
+        std::filesystem::file_time_type time; ///< Last use
+        uintmax_t bytes;                      ///< Size of both files
+    };
+    std::vector<Entry> entries;
+    uintmax_t total = 0;
+
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+    {
+        const auto &path = it->path();
+        auto name = path.filename().string();
+        std::error_code ignored;
+        if (name.rfind(TEMP_PREFIX, 0) == 0)
+        {
+            // Left by a store that was interrupted, a running one is younger
+            if (isStale(path))
+            {
+                std::filesystem::remove(path, ignored);
+            }
+        }
+        else if (path.extension() == ".out")
+        {
+            auto metaPath = std::filesystem::path(path).replace_extension(".meta");
+            if (!std::filesystem::exists(metaPath, ignored) && isStale(path))
+            {
+                std::filesystem::remove(path, ignored);
+            }
+        }
+        else if (path.extension() == ".meta")
+        {
+            auto outPath = std::filesystem::path(path).replace_extension(".out");
+            auto metaBytes = std::filesystem::file_size(path, ignored);
+            auto outBytes = std::filesystem::file_size(outPath, ignored);
+            auto time = std::filesystem::last_write_time(path, ignored);
+            if (metaBytes == static_cast<uintmax_t>(-1) || outBytes == static_cast<uintmax_t>(-1))
+            {
+                continue;
+            }
+            entries.push_back({path, time, metaBytes + outBytes});
+            total += metaBytes + outBytes;
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &l, const Entry &r) { return l.time < r.time; });
+    for (const auto &entry : entries)
+    {
+        if (total <= maxBytes)
+        {
+            break;
+        }
+        // Metadata first, the entry is a miss from then on
+        std::error_code ignored;
+        std::filesystem::remove(entry.meta, ignored);
+        std::filesystem::remove(std::filesystem::path(entry.meta).replace_extension(".out"), ignored);
+        total -= entry.bytes;
+    }
+    counted.store(total, std::memory_order_relaxed);
+}
+
+std::filesystem::path Cache::entryPath(const std::string &key, const char *extension) const
+{
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << fnv1a(key) << extension;
+    return directory / name.str();
+}
+
+std::filesystem::path Cache::tempPath() const
+{
+    // The process tag keeps concurrent processes apart, the serial keeps threads apart
+    static const unsigned long long tag = (static_cast<unsigned long long>(std::random_device{}()) << 32) ^
+                                          std::random_device{}();
+    static std::atomic<unsigned long long> serial{0};
+
+    std::ostringstream name;
+    name << TEMP_PREFIX << std::hex << tag << '-' << serial.fetch_add(1, std::memory_order_relaxed);
+    return directory / name.str();
+}
+
+} // namespace result_cache
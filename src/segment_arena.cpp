@@ -0,0 +1,162 @@
+/**
+ * @file segment_arena.cpp
+ * @brief Implementation of the huge-page backed segment buffer
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "segment_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+
+/**
+ * @brief Rounds up to a multiple of the chunk size
+ * @param bytes Byte count
+ * @return Rounded byte count
+ */
+size_t roundToChunk(size_t bytes)
+{
+    constexpr size_t chunk = geometry::SegmentArena::CHUNK_BYTES;
+    return (bytes + chunk - 1) / chunk * chunk;
+}
+
+} // namespace
+
+namespace geometry
+{
+
+static_assert(std::is_trivially_copyable_v<Segment> && std::is_trivially_destructible_v<Segment>,
+              "SegmentArena stores segments as raw memory");
+
+SegmentArena::SegmentArena(size_t maxSegments) : maxCount(maxSegments)
+{
+    if (maxSegments > (std::numeric_limits<size_t>::max() - 2 * CHUNK_BYTES) / sizeof(Segment))
+    {
+        throw std::bad_alloc();
+    }
+    reservedBytes = roundToChunk(std::max<size_t>(maxSegments, 1) * sizeof(Segment));
+
+#ifdef __linux__
+    // Reserve one extra chunk to align the usable range to the huge page size
+    mappingBytes = reservedBytes + CHUNK_BYTES;
+    mapping = mmap(nullptr, mappingBytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping != MAP_FAILED)
+    {
+        auto address = reinterpret_cast<uintptr_t>(mapping);
+        base = reinterpret_cast<std::byte *>((address + CHUNK_BYTES - 1) / CHUNK_BYTES * CHUNK_BYTES);
+#ifdef MADV_HUGEPAGE
+        advised = madvise(base, reservedBytes, MADV_HUGEPAGE) == 0;
+#endif
+        return;
+    }
+    mapping = nullptr;
+#endif
+
+    // No mmap: the whole capacity is committed up front
+    heap = true;
+    base = static_cast<std::byte *>(std::aligned_alloc(CHUNK_BYTES, reservedBytes));
+    if (base == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    committed = reservedBytes;
+}
+
+SegmentArena::~SegmentArena()
+{
+    if (heap)
+    {
+        std::free(base);
+    }
+#ifdef __linux__
+    else if (mapping != nullptr)
+    {
+        munmap(mapping, mappingBytes);
+    }
+#endif
+}
+
+void SegmentArena::grow()
+{
+    if (committed >= reservedBytes)
+    {
+        throw std::length_error("SegmentArena capacity exceeded");
+    }
+#ifdef __linux__
+    // Commit in place, already written segments are not moved
+    if (mprotect(base + committed, CHUNK_BYTES, PROT_READ | PROT_WRITE) != 0)
+    {
+        throw std::bad_alloc();
+    }
+#endif
+    committed += CHUNK_BYTES;
+}
+
+void SegmentArena::push_back(const Segment &s)
+{
+    if (count == maxCount)
+    {
+        throw std::length_error("SegmentArena capacity exceeded");
+    }
+    while ((count + 1) * sizeof(Segment) > committed)
+    {
+        grow();
+    }
+    new (base + count * sizeof(Segment)) Segment(s);
+    ++count;
+}
+
+void SegmentArena::clear() noexcept
+{
+    count = 0;
+}
+
+size_t SegmentArena::size() const noexcept
+{
+    return count;
+}
+
+size_t SegmentArena::capacity() const noexcept
+{
+    return maxCount;
+}
+
+size_t SegmentArena::committedBytes() const noexcept
+{
+    return committed;
+}
+
+bool SegmentArena::hugePages() const noexcept
+{
+    return advised;
+}
+
+std::span<const Segment> SegmentArena::segments() const noexcept
+{
+    return {reinterpret_cast<const Segment *>(base), count};
+}
+
+RunStatus generateHatch(const Rectangle &rect, double angle, double step, SegmentArena &out,
+                        const Cancellation &cancel, const HatchLimits &limits)
+{
+    if (checkHatch(rect, angle, step, limits) > out.capacity() - out.size())
+    {
+        throw std::length_error("Hatch does not fit into SegmentArena");
+    }
+    return generateHatch(rect, angle, step, [&out](const Segment &s) { out.push_back(s); }, limits, cancel);
+}
+
+} // namespace geometry
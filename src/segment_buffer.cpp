@@ -0,0 +1,344 @@
+/**
+ * @file segment_buffer.cpp
+ * @brief Implementation of the structure-of-arrays segment container
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "segment_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpu_dispatch.h"
+
+namespace
+{
+
+/**
+ * @brief Rounds a segment count up to a multiple of SIMD lanes
+ * @param n Segment count
+ * @return Padded count
+ * @throw std::length_error if the padded count overflows
+ */
+size_t padded(size_t n)
+{
+    constexpr size_t lanes = geometry::SegmentBuffer::LANES;
+    if (n > std::numeric_limits<size_t>::max() - (lanes - 1))
+    {
+        throw std::length_error("SegmentBuffer: " + std::to_string(n) + " segments can't be padded");
+    }
+    return (n + lanes - 1) / lanes * lanes;
+}
+
+/// Segments below which bulk passes stay on the calling thread
+constexpr size_t PARALLEL_MIN_SEGMENTS = size_t(1) << 20;
+
+/**
+ * @brief Returns number of chunks a bulk pass is split into
+ * @param n Segment count
+ * @return At least one chunk, at most one per hardware thread
+ */
+size_t chunkCount(size_t n) noexcept
+{
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    return std::clamp<size_t>(n / PARALLEL_MIN_SEGMENTS, 1, threads);
+}
+
+/**
+ * @brief Returns segments per chunk, a multiple of SIMD lanes
+ * @param n Segment count
+ * @return Chunk size
+ */
+size_t chunkSize(size_t n) noexcept
+{
+    return std::max(padded((n + chunkCount(n) - 1) / chunkCount(n)), geometry::SegmentBuffer::LANES);
+}
+
+/**
+ * @brief Runs a kernel over lane-aligned chunks of [0, n), in parallel for big n
+ * @param n Number of elements
+ * @param kernel Callable taking (begin, end)
+ *
+ * If a thread cannot be started its chunk runs on the calling thread.
+ */
+template <typename Kernel> void forChunks(size_t n, Kernel kernel) noexcept
+{
+    size_t size = chunkSize(n);
+    std::vector<std::jthread> workers;
+    for (size_t begin = size; begin < n; begin += size)
+    {
+        size_t end = std::min(begin + size, n);
+        try
+        {
+            workers.emplace_back([=, &kernel] { kernel(begin, end); });
+        }
+        catch (const std::exception &)
+        {
+            kernel(begin, end);
+        }
+    }
+    kernel(0, std::min(size, n));
+}
+
+/**
+ * @brief Gives a zero bound a definite sign
+ * @param bound Minimum or maximum of some values
+ * @return The bound, +0 if it is zero
+ *
+ * Which of +0 and -0 a min/max reduction keeps depends on the order values
+ * are visited in, and thus on the kernel variant and the chunking.
+ */
+double definite(double bound) noexcept
+{
+    return bound == 0 ? 0.0 : bound;
+}
+
+} // namespace
+
+namespace geometry
+{
+
+SegmentBuffer::SegmentBuffer(std::pmr::memory_resource *mr) noexcept : resource(mr)
+{
+}
+
+SegmentBuffer::SegmentBuffer(const SegmentBuffer &other) : resource(other.resource)
+{
+    append(other);
+}
+
+SegmentBuffer::SegmentBuffer(SegmentBuffer &&other) noexcept
+    : resource(other.resource), x1Column(other.x1Column), y1Column(other.y1Column), x2Column(other.x2Column),
+      y2Column(other.y2Column), count(other.count), cap(other.cap)
+{
+    other.x1Column = other.y1Column = other.x2Column = other.y2Column = nullptr;
+    other.count = other.cap = 0;
+}
+
+SegmentBuffer &SegmentBuffer::operator=(const SegmentBuffer &other)
+{
+    if (this != &other)
+    {
+        clear();
+        append(other);
+    }
+    return *this;
+}
+
+SegmentBuffer &SegmentBuffer::operator=(SegmentBuffer &&other)
+{
+    if (this == &other)
+    {
+        return *this;
+    }
+    // Columns can only be taken over from the same memory resource
+    if (resource != other.resource && !resource->is_equal(*other.resource))
+    {
+        clear();
+        append(other);
+        return *this;
+    }
+    reallocate(0);
+    std::swap(x1Column, other.x1Column);
+    std::swap(y1Column, other.y1Column);
+    std::swap(x2Column, other.x2Column);
+    std::swap(y2Column, other.y2Column);
+    std::swap(count, other.count);
+    std::swap(cap, other.cap);
+    return *this;
+}
+
+SegmentBuffer::~SegmentBuffer()
+{
+    reallocate(0);
+}
+
+size_t SegmentBuffer::bytesFor(size_t n)
+{
+    if (n > max_size())
+    {
+        throw std::length_error("SegmentBuffer: " + std::to_string(n) + " segments don't fit in size_t bytes");
+    }
+    return padded(n) * 4 * sizeof(double);
+}
+
+size_t SegmentBuffer::max_size() noexcept
+{
+    // A multiple of LANES, so it is its own padded count
+    return std::numeric_limits<size_t>::max() / (4 * sizeof(double)) / LANES * LANES;
+}
+
+void SegmentBuffer::reallocate(size_t newCap)
+{
+    double *block = nullptr;
+    if (newCap != 0)
+    {
+        // One block for the four columns, each column starts at an aligned offset
+        block = static_cast<double *>(resource->allocate(bytesFor(newCap), ALIGNMENT));
+        size_t keep = std::min(count, newCap);
+        // The zeroed lanes after the last kept segment are copied too
+        for (size_t c = 0; c < 4; ++c)
+        {
+            const double *from = c == 0 ? x1Column : c == 1 ? y1Column : c == 2 ? x2Column : y2Column;
+            if (keep != 0)
+            {
+                std::memcpy(block + c * newCap, from, padded(keep) * sizeof(double));
+            }
+        }
+        count = keep;
+    }
+    else
+    {
+        count = 0;
+    }
+
+    if (x1Column != nullptr)
+    {
+        resource->deallocate(x1Column, bytesFor(cap), ALIGNMENT);
+    }
+
+    x1Column = block;
+    y1Column = block ? block + newCap : nullptr;
+    x2Column = block ? block + 2 * newCap : nullptr;
+    y2Column = block ? block + 3 * newCap : nullptr;
+    cap = newCap;
+}
+
+void SegmentBuffer::zeroLanes(size_t begin, size_t end) noexcept
+{
+    if (begin >= end)
+    {
+        return;
+    }
+    for (double *column : {x1Column, y1Column, x2Column, y2Column})
+    {
+        std::memset(column + begin, 0, (end - begin) * sizeof(double));
+    }
+}
+
+void SegmentBuffer::reserve(size_t n)
+{
+    if (n > max_size())
+    {
+        throw std::length_error("SegmentBuffer: " + std::to_string(n) + " segments don't fit in size_t bytes");
+    }
+    if (n > cap)
+    {
+        reallocate(padded(n));
+    }
+}
+
+void SegmentBuffer::push_back(const Segment &s)
+{
+    if (count == cap)
+    {
+        reserve(std::max(LANES, cap > max_size() / 2 ? cap + LANES : cap * 2));
+    }
+    if (count % LANES == 0)
+    {
+        zeroLanes(count, count + LANES);
+    }
+    x1Column[count] = s.a.x;
+    y1Column[count] = s.a.y;
+    x2Column[count] = s.b.x;
+    y2Column[count] = s.b.y;
+    ++count;
+}
+
+void SegmentBuffer::append(std::span<const Segment> segments)
+{
+    reserve(count + segments.size());
+    for (const auto &s : segments)
+    {
+        push_back(s);
+    }
+}
+
+void SegmentBuffer::append(const SegmentBuffer &other)
+{
+    size_t n = other.count;
+    reserve(count + n);
+    if (n != 0)
+    {
+        std::memcpy(x1Column + count, other.x1Column, n * sizeof(double));
+        std::memcpy(y1Column + count, other.y1Column, n * sizeof(double));
+        std::memcpy(x2Column + count, other.x2Column, n * sizeof(double));
+        std::memcpy(y2Column + count, other.y2Column, n * sizeof(double));
+    }
+    count += n;
+    zeroLanes(count, padded(count));
+}
+
+void SegmentBuffer::clear() noexcept
+{
+    count = 0;
+}
+
+size_t SegmentBuffer::size() const noexcept
+{
+    return count;
+}
+
+bool SegmentBuffer::empty() const noexcept
+{
+    return count == 0;
+}
+
+size_t SegmentBuffer::capacity() const noexcept
+{
+    return cap;
+}
+
+void SegmentBuffer::transform(double tx, double ty, double sx, double sy, bool flipY) noexcept
+{
+    // Mirroring as ty - y instead of scaling by -sy keeps +0 on the axis
+    double my = flipY ? -1.0 : 1.0;
+
+    // Padding lanes may be transformed too, kernels run up to padded(count)
+    auto transformColumn = cpu_dispatch::kernels().transformColumn;
+    forChunks(padded(count), [&](size_t begin, size_t end) {
+        transformColumn(x1Column, begin, end, 1.0, tx, sx);
+        transformColumn(x2Column, begin, end, 1.0, tx, sx);
+        transformColumn(y1Column, begin, end, my, ty, sy);
+        transformColumn(y2Column, begin, end, my, ty, sy);
+    });
+}
+
+BoundingBox SegmentBuffer::bbox() const
+{
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    std::vector<BoundingBox> parts(chunkCount(count), BoundingBox{{inf, inf}, {-inf, -inf}});
+    auto columnRange = cpu_dispatch::kernels().columnRange;
+    forChunks(count, [&](size_t begin, size_t end) {
+        auto x = columnRange(x1Column, x2Column, begin, end);
+        auto y = columnRange(y1Column, y2Column, begin, end);
+        parts[begin / chunkSize(count)] = {{x.min, y.min}, {x.max, y.max}};
+    });
+
+    BoundingBox box{{inf, inf}, {-inf, -inf}};
+    for (const auto &part : parts)
+    {
+        box.min.x = std::min(box.min.x, part.min.x);
+        box.min.y = std::min(box.min.y, part.min.y);
+        box.max.x = std::max(box.max.x, part.max.x);
+        box.max.y = std::max(box.max.y, part.max.y);
+    }
+    return {{definite(box.min.x), definite(box.min.y)}, {definite(box.max.x), definite(box.max.y)}};
+}
+
+RunStatus generateHatch(const Rectangle &rect, double angle, double step, SegmentBuffer &out,
+                        const Cancellation &cancel, const HatchLimits &limits)
+{
+    size_t bound = checkHatch(rect, angle, step, limits);
+    reserveSegments(bound, 4 * sizeof(double), SegmentBuffer::max_size() - out.size(),
+                    [&] { out.reserve(out.size() + bound); });
+    return generateHatch(rect, angle, step, [&out](const Segment &s) { out.push_back(s); }, limits, cancel);
+}
+
+} // namespace geometry
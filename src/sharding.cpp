@@ -0,0 +1,110 @@
+/**
+ * @file sharding.cpp
+ * @brief Implementation of forked shard workers
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "sharding.h"
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+
+/**
+ * @brief Waits for a child process
+ * @param pid Child to wait for
+ * @return How the child ended
+ */
+sharding::ShardExit waitShard(pid_t pid)
+{
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0)
+    {
+        if (errno != EINTR)
+        {
+            return {.exitCode = 1, .signal = 0};
+        }
+    }
+    if (WIFSIGNALED(status))
+    {
+        return {.exitCode = 1, .signal = WTERMSIG(status)};
+    }
+    return {.exitCode = WEXITSTATUS(status), .signal = 0};
+}
+
+} // namespace
+
+namespace sharding
+{
+
+std::string ShardExit::describe() const
+{
+    if (signal != 0)
+    {
+        return "worker terminated by signal " + std::to_string(signal);
+    }
+    if (exitCode != 0)
+    {
+        return "worker exited with status " + std::to_string(exitCode);
+    }
+    return {};
+}
+
+std::vector<ShardExit> forkShards(size_t count, const std::function<int(size_t shard)> &worker)
+{
+    // Buffered output would otherwise be written by every child again
+    std::cout.flush();
+    std::cerr.flush();
+
+    std::vector<pid_t> children;
+    children.reserve(count);
+    for (size_t shard = 0; shard < count; ++shard)
+    {
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            auto error = std::runtime_error(std::string("Failed to start worker process: ") + std::strerror(errno));
+            for (pid_t child : children)
+            {
+                waitShard(child);
+            }
+            throw error;
+        }
+        if (pid == 0)
+        {
+            int status = 1;
+            try
+            {
+                status = worker(shard);
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << e.what() << '\n';
+            }
+            std::cout.flush();
+            std::cerr.flush();
+            _exit(status);
+        }
+        children.push_back(pid);
+    }
+
+    std::vector<ShardExit> exits;
+    exits.reserve(count);
+    for (pid_t child : children)
+    {
+        exits.push_back(waitShard(child));
+    }
+    return exits;
+}
+
+} // namespace sharding
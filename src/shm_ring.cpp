@@ -0,0 +1,332 @@
+/**
+ * @file shm_ring.cpp
+ * @brief Implementation of the shared-memory segment ring
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "shm_ring.h"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+
+/// Longest single sleep, bounds how late a stall or a missed wake-up is noticed
+constexpr auto WAIT_SLICE = std::chrono::milliseconds(10);
+
+static_assert(sizeof(geometry::SegmentView) == 32, "Records must be four doubles");
+static_assert(sizeof(shm_ring::Header) <= shm_ring::HEADER_BYTES);
+static_assert(offsetof(shm_ring::Header, head) == 64 && offsetof(shm_ring::Header, tail) == 128,
+              "Header layout is documented in shm_ring.h");
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "Shared atomics must not use a process-local lock");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Futex words must be plain 32-bit integers");
+
+/**
+ * @brief Builds an error for a failed system call
+ * @param what Description of the operation
+ * @return Error with the errno message
+ */
+std::runtime_error systemError(const std::string &what)
+{
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+/**
+ * @brief Returns a valid shared memory object name
+ * @param name Name given by the user
+ * @return Name starting with '/'
+ */
+std::string objectName(const std::string &name)
+{
+    if (name.empty() || name.find('/', 1) != std::string::npos)
+    {
+        throw std::invalid_argument("Invalid shared memory name: " + name);
+    }
+    return name.front() == '/' ? name : '/' + name;
+}
+
+/**
+ * @brief Sleeps while a futex word holds a value
+ * @param word Shared futex word
+ * @param expected Value seen before the last check of the ring
+ */
+void futexWait(std::atomic<uint32_t> &word, uint32_t expected) noexcept
+{
+#ifdef __linux__
+    timespec slice{.tv_sec = 0, .tv_nsec = std::chrono::nanoseconds(WAIT_SLICE).count()};
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, expected, &slice, nullptr, 0);
+#else
+    if (word.load() == expected)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+#endif
+}
+
+/**
+ * @brief Wakes a sleeper on a futex word, in any process
+ * @param word Shared futex word
+ */
+void futexWake(std::atomic<uint32_t> &word) noexcept
+{
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+/**
+ * @brief Bumps a sequence and wakes its sleeper if there is one
+ * @param sequence Futex word of the other side
+ * @param waiting Waiting flag of the other side
+ *
+ * Both operations are sequentially consistent: either the sleeper sees the
+ * new sequence before sleeping or its flag is seen here.
+ */
+void notify(std::atomic<uint32_t> &sequence, const std::atomic<uint32_t> &waiting) noexcept
+{
+    sequence.fetch_add(1);
+    if (waiting.load() != 0)
+    {
+        futexWake(sequence);
+    }
+}
+
+/**
+ * @brief Maps a shared memory object
+ * @param fd Open object
+ * @param bytes Size to map
+ * @return Start of the mapping
+ */
+void *mapShared(int fd, size_t bytes)
+{
+    void *address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+    {
+        throw systemError("Failed to map shared memory");
+    }
+    return address;
+}
+
+} // namespace
+
+namespace shm_ring
+{
+
+Producer::Producer(const std::string &name, size_t capacity, std::chrono::milliseconds stallTimeout)
+    : name(objectName(name)), timeout(stallTimeout)
+{
+    capacity = std::bit_ceil(std::max(capacity, PUBLISH_BATCH));
+    mappedBytes = HEADER_BYTES + capacity * sizeof(geometry::SegmentView);
+
+    // An object left by a crashed run would make the exclusive create fail
+    shm_unlink(this->name.c_str());
+    int fd = shm_open(this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+    {
+        throw systemError("Failed to create shared memory " + this->name);
+    }
+    void *address = nullptr;
+    try
+    {
+        if (ftruncate(fd, static_cast<off_t>(mappedBytes)) != 0)
+        {
+            throw systemError("Failed to size shared memory " + this->name);
+        }
+        address = mapShared(fd, mappedBytes);
+    }
+    catch (...)
+    {
+        ::close(fd);
+        shm_unlink(this->name.c_str());
+        throw;
+    }
+    ::close(fd);
+
+    // The object is zero filled, the atomics start at zero
+    header = new (address) Header{};
+    std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+    header->version = VERSION;
+    header->recordBytes = sizeof(geometry::SegmentView);
+    header->capacity = capacity;
+    records = reinterpret_cast<geometry::SegmentView *>(static_cast<char *>(address) + HEADER_BYTES);
+    freeUntil = capacity;
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+Producer::~Producer()
+{
+    if (header->closed.load(std::memory_order_relaxed) == 0)
+    {
+        close(geometry::CANCELLED);
+    }
+    munmap(header, mappedBytes);
+    shm_unlink(name.c_str());
+}
+
+void Producer::push(const geometry::Segment &s)
+{
+    if (written == freeUntil)
+    {
+        flush();
+        waitForSpace();
+    }
+    records[written & (header->capacity - 1)] = {s.a, s.b};
+    if (++written - published >= PUBLISH_BATCH)
+    {
+        flush();
+    }
+}
+
+void Producer::flush() noexcept
+{
+    if (written == published)
+    {
+        return;
+    }
+    published = written;
+    header->head.store(published, std::memory_order_release);
+    notify(header->dataSequence, header->consumerWaiting);
+}
+
+void Producer::close(geometry::RunStatus status) noexcept
+{
+    flush();
+    header->status.store(status, std::memory_order_relaxed);
+    header->closed.store(1, std::memory_order_release);
+    // Always wake: a consumer that already saw the flag clear may be asleep
+    header->dataSequence.fetch_add(1);
+    futexWake(header->dataSequence);
+}
+
+void Producer::waitForSpace()
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;)
+    {
+        freeUntil = header->tail.load(std::memory_order_acquire) + header->capacity;
+        if (written < freeUntil)
+        {
+            return;
+        }
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            throw std::runtime_error("Shared memory consumer stalled on " + name);
+        }
+        header->producerWaiting.store(1);
+        uint32_t sequence = header->spaceSequence.load();
+        if (header->tail.load(std::memory_order_acquire) + header->capacity == freeUntil)
+        {
+            futexWait(header->spaceSequence, sequence);
+        }
+        header->producerWaiting.store(0, std::memory_order_relaxed);
+    }
+}
+
+Consumer::Consumer(const std::string &name)
+{
+    auto object = objectName(name);
+    int fd = shm_open(object.c_str(), O_RDWR, 0);
+    if (fd < 0)
+    {
+        throw systemError("Failed to open shared memory " + object);
+    }
+    void *address = nullptr;
+    try
+    {
+        struct stat info{};
+        if (fstat(fd, &info) != 0)
+        {
+            throw systemError("Failed to inspect shared memory " + object);
+        }
+        if (static_cast<size_t>(info.st_size) < HEADER_BYTES)
+        {
+            throw std::runtime_error("Shared memory " + object + " is not a hatch ring");
+        }
+        mappedBytes = static_cast<size_t>(info.st_size);
+        address = mapShared(fd, mappedBytes);
+    }
+    catch (...)
+    {
+        close(fd);
+        throw;
+    }
+    close(fd);
+
+    header = static_cast<Header *>(address);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION ||
+        header->recordBytes != sizeof(geometry::SegmentView) || !std::has_single_bit(header->capacity) ||
+        HEADER_BYTES + header->capacity * sizeof(geometry::SegmentView) != mappedBytes)
+    {
+        munmap(address, mappedBytes);
+        throw std::runtime_error("Shared memory " + object + " is not a hatch ring of version " +
+                                 std::to_string(VERSION));
+    }
+    records = reinterpret_cast<geometry::SegmentView *>(static_cast<char *>(address) + HEADER_BYTES);
+    read = header->tail.load(std::memory_order_relaxed);
+}
+
+Consumer::~Consumer()
+{
+    munmap(header, mappedBytes);
+}
+
+std::span<const geometry::SegmentView> Consumer::wait()
+{
+    for (;;)
+    {
+        // closed is read first: after seeing it, head is final
+        bool closed = header->closed.load(std::memory_order_acquire) != 0;
+        uint64_t head = header->head.load(std::memory_order_acquire);
+        if (head != read)
+        {
+            size_t slot = read & (header->capacity - 1);
+            return {records + slot, static_cast<size_t>(std::min<uint64_t>(head - read, header->capacity - slot))};
+        }
+        if (closed)
+        {
+            return {};
+        }
+        header->consumerWaiting.store(1);
+        uint32_t sequence = header->dataSequence.load();
+        if (header->head.load(std::memory_order_acquire) == read && header->closed.load() == 0)
+        {
+            futexWait(header->dataSequence, sequence);
+        }
+        header->consumerWaiting.store(0, std::memory_order_relaxed);
+    }
+}
+
+void Consumer::release(size_t n) noexcept
+{
+    read += n;
+    header->tail.store(read, std::memory_order_release);
+    notify(header->spaceSequence, header->producerWaiting);
+}
+
+geometry::RunStatus Consumer::status() const noexcept
+{
+    return static_cast<geometry::RunStatus>(header->status.load(std::memory_order_relaxed));
+}
+
+} // namespace shm_ring
@@ -0,0 +1,329 @@
+/**
+ * @file spill_sink.cpp
+ * @brief Implementation of the disk spilling segment sink
+ * @author Alsu Khabibulina
+ * @date 2025
+ */
+
+#include "spill_sink.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+namespace
+{
+
+/// Segments of the smallest memory part and read block
+constexpr size_t MIN_BLOCK = 256;
+
+static_assert(std::is_trivially_copyable_v<geometry::SegmentView>, "SpillSink writes segments as raw records");
+
+/**
+ * @class ChunkReader
+ * @brief Reads records of one chunk file block by block
+ */
+class ChunkReader
+{
+  public:
+    /**
+     * @brief Opens a chunk file
+     * @param path Chunk file
+     * @param blockSize Records read at once
+     * @throw std::runtime_error if the file cannot be opened
+     */
+    ChunkReader(const std::filesystem::path &path, size_t blockSize)
+        : path(path), in(path, std::ios::binary), block(blockSize)
+    {
+        if (!in)
+        {
+            throw std::runtime_error("Failed to open spill file: " + path.string());
+        }
+    }
+
+    /**
+     * @brief Reads the next record
+     * @param s Receives the record
+     * @return false at the end of the file
+     * @throw std::runtime_error if the file cannot be read
+     */
+    bool next(geometry::SegmentView &s)
+    {
+        if (pos == end)
+        {
+            in.read(reinterpret_cast<char *>(block.data()), std::streamsize(block.size() * sizeof(s)));
+            auto bytes = static_cast<size_t>(in.gcount());
+            if (in.bad() || bytes % sizeof(s) != 0)
+            {
+                throw std::runtime_error("Failed to read spill file: " + path.string());
+            }
+            pos = 0;
+            end = bytes / sizeof(s);
+            if (end == 0)
+            {
+                return false;
+            }
+        }
+        s = block[pos++];
+        return true;
+    }
+
+  private:
+    std::filesystem::path path;               ///< Chunk file, for error messages
+    std::ifstream in;                         ///< Chunk stream
+    std::vector<geometry::SegmentView> block; ///< Records read so far
+    size_t pos = 0;                           ///< Next record in the block
+    size_t end = 0;                           ///< Records in the block
+};
+
+/**
+ * @struct Head
+ * @brief Smallest unread record of a merge source
+ */
+struct Head
+{
+    geometry::SegmentView segment; ///< Record
+    size_t source;                 ///< Index of its source
+};
+
+/**
+ * @brief Writes records to a new chunk file
+ * @param path Chunk file
+ * @param fill Called with a function writing an array of records
+ * @throw std::runtime_error if the file cannot be written, the file is then removed
+ */
+template <typename Fill> void writeChunk(const std::filesystem::path &path, Fill fill)
+{
+    try
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            throw std::runtime_error("Failed to create spill file: " + path.string());
+        }
+        fill([&out](const geometry::SegmentView *records, size_t n) {
+            out.write(reinterpret_cast<const char *>(records), std::streamsize(n * sizeof(*records)));
+        });
+        out.close();
+        if (!out)
+        {
+            throw std::runtime_error("Failed to write spill file: " + path.string());
+        }
+    }
+    catch (...)
+    {
+        std::error_code ignored;
+        std::filesystem::remove(path, ignored);
+        throw;
+    }
+}
+
+} // namespace
+
+namespace geometry
+{
+
+SpillSink::SpillSink(size_t maxBytes, std::filesystem::path directory, SegmentOrder order)
+    : directory(directory.empty() ? std::filesystem::temp_directory_path() : std::move(directory)),
+      order(std::move(order)), capacity(std::max(MIN_BLOCK, maxBytes / 2 / RECORD_BYTES)),
+      readBytes(std::max(MIN_BLOCK * RECORD_BYTES, maxBytes / 2))
+{
+}
+
+SpillSink::~SpillSink()
+{
+    for (const auto &path : chunks)
+    {
+        std::error_code ignored;
+        std::filesystem::remove(path, ignored);
+    }
+}
+
+void SpillSink::push_back(const Segment &s)
+{
+    if (memory.size() == capacity)
+    {
+        spill();
+    }
+    // Grow by hand, a doubling vector would overshoot the memory part
+    if (memory.size() == memory.capacity())
+    {
+        memory.reserve(std::min(capacity, std::max(MIN_BLOCK, 2 * memory.capacity())));
+    }
+    memory.push_back({s.a, s.b});
+    ++count;
+}
+
+void SpillSink::merge(const SegmentSink &sink)
+{
+    reduceChunks();
+    if (order)
+    {
+        std::stable_sort(memory.begin(), memory.end(), order);
+    }
+    mergeChunks(0, chunks.size(), true, [&sink](const SegmentView &s) { sink(s.toSegment()); });
+}
+
+size_t SpillSink::size() const noexcept
+{
+    return count;
+}
+
+size_t SpillSink::spilledChunks() const noexcept
+{
+    return chunks.size();
+}
+
+size_t SpillSink::spilledBytes() const noexcept
+{
+    return (count - memory.size()) * RECORD_BYTES;
+}
+
+void SpillSink::spill()
+{
+    if (order)
+    {
+        std::stable_sort(memory.begin(), memory.end(), order);
+    }
+    auto path = newChunkPath();
+    writeChunk(path, [this](const auto &write) { write(memory.data(), memory.size()); });
+    chunks.push_back(path);
+    memory.clear();
+}
+
+void SpillSink::reduceChunks()
+{
+    while (chunks.size() > MERGE_FAN_IN)
+    {
+        std::vector<std::filesystem::path> merged;
+        try
+        {
+            for (size_t first = 0; first < chunks.size(); first += MERGE_FAN_IN)
+            {
+                size_t last = std::min(first + MERGE_FAN_IN, chunks.size());
+                auto path = newChunkPath();
+                writeChunk(path, [&](const auto &write) {
+                    mergeChunks(first, last, false, [&write](const SegmentView &s) { write(&s, 1); });
+                });
+                merged.push_back(path);
+            }
+        }
+        catch (...)
+        {
+            for (const auto &path : merged)
+            {
+                std::error_code ignored;
+                std::filesystem::remove(path, ignored);
+            }
+            throw;
+        }
+
+        for (const auto &path : chunks)
+        {
+            std::error_code ignored;
+            std::filesystem::remove(path, ignored);
+        }
+        chunks = std::move(merged);
+    }
+}
+
+void SpillSink::mergeChunks(size_t first, size_t last, bool withMemory,
+                            const std::function<void(const SegmentView &)> &sink) const
+{
+    size_t blockSize = std::max(MIN_BLOCK, readBytes / RECORD_BYTES / std::max<size_t>(last - first, 1));
+    std::vector<ChunkReader> readers;
+    readers.reserve(last - first);
+    for (size_t i = first; i < last; ++i)
+    {
+        readers.emplace_back(chunks[i], blockSize);
+    }
+
+    // Sources are the chunks in generation order, then the memory part
+    size_t sources = readers.size() + (withMemory ? 1 : 0);
+    size_t memoryPos = 0;
+    auto pull = [&](size_t source, SegmentView &s) {
+        if (source < readers.size())
+        {
+            return readers[source].next(s);
+        }
+        if (memoryPos == memory.size())
+        {
+            return false;
+        }
+        s = memory[memoryPos++];
+        return true;
+    };
+
+    SegmentView s;
+    if (!order)
+    {
+        for (size_t source = 0; source < sources; ++source)
+        {
+            while (pull(source, s))
+            {
+                sink(s);
+            }
+        }
+        return;
+    }
+
+    // Ties go to the earlier source, which keeps equal segments in generation order
+    auto after = [this](const Head &l, const Head &r) {
+        if (order(r.segment, l.segment))
+        {
+            return true;
+        }
+        return !order(l.segment, r.segment) && l.source > r.source;
+    };
+    std::priority_queue<Head, std::vector<Head>, decltype(after)> heads(after);
+    for (size_t source = 0; source < sources; ++source)
+    {
+        if (pull(source, s))
+        {
+            heads.push({s, source});
+        }
+    }
+    while (!heads.empty())
+    {
+        auto head = heads.top();
+        heads.pop();
+        sink(head.segment);
+        if (pull(head.source, s))
+        {
+            heads.push({s, head.source});
+        }
+    }
+}
+
+std::filesystem::path SpillSink::newChunkPath() const
+{
+    // The process tag keeps concurrent processes apart, the serial keeps sinks and chunks apart
+    static const unsigned long long tag = (static_cast<unsigned long long>(std::random_device{}()) << 32) ^
+                                          std::random_device{}();
+    static std::atomic<unsigned long long> serial{0};
+
+    std::filesystem::path path;
+    do
+    {
+        std::ostringstream name;
+        name << "hatch-spill-" << std::hex << tag << '-' << serial.fetch_add(1, std::memory_order_relaxed) << ".bin";
+        path = directory / name.str();
+    } while (std::filesystem::exists(path));
+    return path;
+}
+
+RunStatus generateHatch(const Rectangle &rect, double angle, double step, SpillSink &out, const HatchLimits &limits,
+                        const Cancellation &cancel, progress::Reporter *progress)
+{
+    return generateHatch(rect, angle, step, [&out](const Segment &s) { out.push_back(s); }, limits, cancel,
+                         progress);
+}
+
+} // namespace geometry
@@ -7,7 +7,9 @@
 
 #include "svg_writer.h"
 #include "geometry.h"
+#include "metrics.h"
 
+#include <algorithm>
 #include <limits>
 #include <ostream>
 #include <stdexcept>
@@ -47,15 +49,36 @@ std::ostream &writeSVGTail(std::ostream &out)
 namespace svg
 {
 
-SVGWriter::SVGWriter(const std::filesystem::path &outFilePath, double w, double h)
-    : outFile(outFilePath), width(w), height(h)
+Bounds boundsOf(const geometry::Rectangle &rect) noexcept
 {
-    if (!outFile)
+    Bounds b{rect.points[0].x, rect.points[0].y, rect.points[0].x, rect.points[0].y};
+    for (const auto &p : rect.points)
+    {
+        b.minX = std::min(b.minX, p.x);
+        b.minY = std::min(b.minY, p.y);
+        b.maxX = std::max(b.maxX, p.x);
+        b.maxY = std::max(b.maxY, p.y);
+    }
+    return b;
+}
+
+SVGWriter::SVGWriter(const std::filesystem::path &outFilePath, double w, double h, std::pmr::memory_resource *mr)
+    : ownedFile(outFilePath), outFile(ownedFile), resource(mr), formatSegments(mr), width(w), height(h)
+{
+    if (!ownedFile)
     {
         throw std::runtime_error("Failed to open file: " + outFilePath.string());
     }
 
     // Create output file and write SVG header
+    startPosition = std::max<std::streamoff>(outFile.tellp(), 0);
+    writeSVGHeader(outFile, w, h);
+}
+
+SVGWriter::SVGWriter(std::ostream &out, double w, double h, std::pmr::memory_resource *mr)
+    : outFile(out), resource(mr), formatSegments(mr), width(w), height(h)
+{
+    startPosition = std::max<std::streamoff>(outFile.tellp(), 0);
     writeSVGHeader(outFile, w, h);
 }
 
@@ -64,71 +87,188 @@ SVGWriter::~SVGWriter()
     // Render all segments and close SVG file
     draw();
     writeSVGTail(outFile);
+
+    if (reporter != nullptr)
+    {
+        reportWritten();
+    }
+    if (std::streamoff position = outFile.tellp(); position > startPosition)
+    {
+        metrics::hatchMetrics().svgBytes.add(static_cast<uint64_t>(position - startPosition));
+    }
 }
 
-void SVGWriter::drawSegments(std::vector<geometry::Segment> segments, LineFormat lf) noexcept
+void SVGWriter::drawSegments(std::span<const geometry::Segment> segments, LineFormat lf) noexcept
 {
-    formatSegments[lf].insert(formatSegments[lf].end(), segments.begin(), segments.end());
+    if (bounds.has_value())
+    {
+        for (const auto &segment : segments)
+        {
+            writeSegment(segment, lf);
+        }
+        return;
+    }
+    bufferOf(lf).append(segments);
 }
 
-void SVGWriter::draw()
+void SVGWriter::drawSegment(const geometry::Segment &segment, LineFormat lf) noexcept
 {
-    double minX = std::numeric_limits<double>::max();
-    double minY = std::numeric_limits<double>::max();
-    double maxX = std::numeric_limits<double>::min();
-    double maxY = std::numeric_limits<double>::min();
+    if (bounds.has_value())
+    {
+        writeSegment(segment, lf);
+        return;
+    }
+    bufferOf(lf).push_back(segment);
+}
 
-    // Calculate overall bounding box from all segments
-    for (const auto &pair : formatSegments)
+void SVGWriter::drawSegments(const geometry::SegmentBuffer &segments, LineFormat lf) noexcept
+{
+    if (bounds.has_value())
     {
-        for (const auto &segment : pair.second)
+        for (const auto &view : segments)
         {
-            minX = std::min(minX, segment.a.x);
-            minX = std::min(minX, segment.b.x);
-            minY = std::min(minY, segment.a.y);
-            minY = std::min(minY, segment.b.y);
-
-            maxX = std::max(maxX, segment.a.x);
-            maxX = std::max(maxX, segment.b.x);
-            maxY = std::max(maxY, segment.a.y);
-            maxY = std::max(maxY, segment.b.y);
+            writeSegment(view.toSegment(), lf);
         }
+        return;
+    }
+    bufferOf(lf).append(segments);
+}
+
+geometry::SegmentBuffer &SVGWriter::bufferOf(LineFormat lf)
+{
+    return formatSegments.try_emplace(lf, resource).first->second;
+}
+
+void SVGWriter::setBounds(const Bounds &b) noexcept
+{
+    bounds = b;
+    fitTo(b);
+}
+
+size_t SVGWriter::bufferedBytes() const noexcept
+{
+    size_t bytes = 0;
+    for (const auto &pair : formatSegments)
+    {
+        bytes += geometry::SegmentBuffer::bytesFor(pair.second.capacity());
     }
+    return bytes;
+}
 
-    double w = maxX - minX;
-    double h = maxY - minY;
+void SVGWriter::fitTo(const Bounds &b) noexcept
+{
+    double w = b.maxX - b.minX;
+    double h = b.maxY - b.minY;
 
     // Scale to fit canvas while maintaining aspect ratio
-    double scale = std::min(width / w, height / h);
+    scale = std::min(width / w, height / h);
+}
 
+void SVGWriter::writeSegment(const geometry::Segment &segment, LineFormat lf)
+{
+    // Scale and translate X coordinates
+    double ax = scale * (segment.a.x - bounds->minX);
+    double bx = scale * (segment.b.x - bounds->minX);
+
+    // Scale, translate, and invert Y axis (SVG has inverted Y)
+    double ay = scale * (-segment.a.y + bounds->maxY);
+    double by = scale * (-segment.b.y + bounds->maxY);
+
+    writeLine(ax, ay, bx, by, lf);
+}
+
+void SVGWriter::writeLine(double ax, double ay, double bx, double by, LineFormat lf)
+{
+    double strokeWidth = 1.5;
+    // Apply different stroke widths based on line format
+    switch (lf)
+    {
+    case CONTOUR:
+        strokeWidth = 2;
+        break;
+    case HATCH:
+        strokeWidth = 1;
+    }
+
+    outFile << "<line x1=\"" << ax << "\" y1=\"" << ay << "\" x2=\"" << bx << "\" y2=\"" << by
+            << "\" stroke=\"black\" stroke-width=\"" << strokeWidth << "\" />\n";
+
+    if (reporter != nullptr && ++unreportedLines == geometry::TIME_CHECK_INTERVAL)
+    {
+        reportWritten();
+    }
+}
+
+void SVGWriter::setProgress(progress::Reporter *progress) noexcept
+{
+    if (reporter != nullptr)
+    {
+        reportWritten();
+    }
+    reporter = progress;
+    unreportedLines = 0;
+    reportedBytes = std::max<std::streamoff>(outFile.tellp(), 0);
+}
+
+void SVGWriter::reportWritten() noexcept
+{
+    std::streamoff position = outFile.tellp();
+    size_t bytes = position > reportedBytes ? static_cast<size_t>(position - reportedBytes) : 0;
+    reportedBytes = std::max(position, reportedBytes);
+    reporter->written(unreportedLines, bytes);
+    unreportedLines = 0;
+}
+
+geometry::RunStatus SVGWriter::draw(const geometry::Cancellation &cancel)
+{
+    // Streaming mode has written everything already
+    if (bounds.has_value())
+    {
+        return geometry::COMPLETE;
+    }
+
+    double minX = std::numeric_limits<double>::max();
+    double minY = std::numeric_limits<double>::max();
+    double maxX = std::numeric_limits<double>::lowest();
+    double maxY = std::numeric_limits<double>::lowest();
+
+    // Calculate overall bounding box from all segments
     for (const auto &pair : formatSegments)
     {
-        double strokeWidth = 1.5;
-        // Apply different stroke widths based on line format
-        switch (pair.first)
-        {
-        case CONTOUR:
-            strokeWidth = 2;
-            break;
-        case HATCH:
-            strokeWidth = 1;
-        }
+        auto box = pair.second.bbox();
+        minX = std::min(minX, box.min.x);
+        minY = std::min(minY, box.min.y);
+        maxX = std::max(maxX, box.max.x);
+        maxY = std::max(maxY, box.max.y);
+    }
 
-        // Convert each segment to SVG line element
-        for (const auto &segment : pair.second)
-        {
-            // Scale and translate X coordinates
-            double ax = scale * (segment.a.x - minX);
-            double bx = scale * (segment.b.x - minX);
+    bounds = Bounds{minX, minY, maxX, maxY};
+    fitTo(bounds.value());
 
-            // Scale, translate, and invert Y axis (SVG has inverted Y)
-            double ay = scale * (-segment.a.y + maxY);
-            double by = scale * (-segment.b.y + maxY);
+    for (auto &pair : formatSegments)
+    {
+        auto &buffer = pair.second;
+
+        // Translate and scale in place, invert Y axis (SVG has inverted Y)
+        buffer.transform(-minX, maxY, scale, scale, true);
 
-            outFile << "<line x1=\"" << ax << "\" y1=\"" << ay << "\" x2=\"" << bx << "\" y2=\"" << by
-                    << "\" stroke=\"black\" stroke-width=\"" << strokeWidth << "\" />\n";
+        // Convert each segment to SVG line element
+        for (size_t i = 0; i < buffer.size(); ++i)
+        {
+            if (i % geometry::TIME_CHECK_INTERVAL == 0)
+            {
+                if (auto status = cancel.poll(); status != geometry::COMPLETE)
+                {
+                    formatSegments.clear();
+                    return status;
+                }
+            }
+            writeLine(buffer.x1()[i], buffer.y1()[i], buffer.x2()[i], buffer.y2()[i], pair.first);
         }
     }
+
+    formatSegments.clear();
+    return geometry::COMPLETE;
 }
 
 } // namespace svg